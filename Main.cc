@@ -29,6 +29,9 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "minisat/utils/Options.h"
 #include "minisat/core/Dimacs.h"
 #include "minisat/simp/SimpSolver.h"
+#include "cs/DimacsLoader.h"
+#include "cs/Snapshot.h"
+#include "cs/SolverDaemon.h"
 
 using namespace Minisat;
 
@@ -51,8 +54,19 @@ static void SIGINT_exit(int) {
     _exit(1); }
 
 
+// Write the empty clause if the formula was refuted, and flush the proof.
+static void finishProof(ProofWriter* proof, bool refuted)
+{
+    if (proof == NULL) return;
+    if (refuted) proof->addEmpty();
+    if (!proof->close())
+        printf("WARNING! Could not write the proof\n");
+}
+
+
 SimpSolver* makeSolver();
 lbool payload(Solver*);
+bool resume(Solver*, SnapshotReader&);
 void postSolve(Solver*, FILE*);
 
 //=================================================================================================
@@ -76,14 +90,43 @@ int main(int argc, char** argv)
         IntOption    cpu_lim("MAIN", "cpu-lim", "Limit on CPU time allowed in seconds.\n", 0, IntRange(0, INT32_MAX));
         IntOption    mem_lim("MAIN", "mem-lim", "Limit on memory usage in megabytes.\n", 0, IntRange(0, INT32_MAX));
         BoolOption   strictp("MAIN", "strict", "Validate DIMACS header during parsing.", false);
+        StringOption save_snapshot("MAIN", "save-snapshot", "If given, write the preprocessed instance to this file.");
+        StringOption load_snapshot("MAIN", "load-snapshot", "If given, read the preprocessed instance from this file instead of the input file.");
+        StringOption proof_path("MAIN", "proof", "If given, write a binary DRAT proof to this file (gzipped if it ends in '.gz').");
+        StringOption resume_from("MAIN", "resume", "If given, continue the run checkpointed in this file (see -checkpoint) instead of reading the input file.");
+        IntOption    parse_threads("MAIN", "parse-threads", "Threads for parsing plain DIMACS input (0=one per core).", 0, IntRange(0, 256));
+        StringOption daemon("MAIN", "daemon", "If given, serve queries on this Unix socket instead of solving one instance.");
+        IntOption    daemon_threads("MAIN", "daemon-threads", "Threads solving queries in -daemon mode (0=one per core).", 0, IntRange(0, 1024));
 
         parseOptions(argc, argv, true);
 
+        if (daemon){
+            if (mem_lim != 0) limitMemory(mem_lim);
+            SolverDaemon D((const char*)daemon, daemon_threads, makeSolver, payload);
+            D.pre          = pre;
+            D.strict       = strictp;
+            D.parseThreads = parse_threads;
+            return D.run() ? 0 : 1;
+        }
+
         std::unique_ptr<SimpSolver> pS(makeSolver());
         SimpSolver& S = *dynamic_cast<SimpSolver*>(pS.get());
 
         double initial_time = cpuTime();
 
+        // The proof is of the input formula, so it has to be attached before the clauses are read:
+        std::unique_ptr<ProofWriter> proof;
+        if (proof_path){
+            if (load_snapshot || resume_from){
+                printf("ERROR! -proof cannot be combined with -load-snapshot or -resume\n");
+                exit(1); }
+            proof.reset(new ProofWriter((const char*)proof_path));
+            if (!proof->ok()){
+                printf("ERROR! Could not open proof file: %s\n", (const char*)proof_path);
+                exit(1); }
+            S.proof = proof.get();
+        }
+
         if (!pre) S.eliminate(true);
 
         S.verbosity = verb;
@@ -97,21 +140,31 @@ int main(int argc, char** argv)
         if (cpu_lim != 0) limitTime(cpu_lim);
         if (mem_lim != 0) limitMemory(mem_lim);
 
-        if (argc == 1)
+        if (argc == 1 && !load_snapshot && !resume_from)
             printf("Reading from standard input... Use '--help' for help.\n");
 
-        gzFile in = (argc == 1) ? gzdopen(0, "rb") : gzopen(argv[1], "rb");
-        if (in == NULL) {
-            printf("ERROR! Could not open file: %s\n", argc == 1 ? "<stdin>" : argv[1]);
-            exit(1);
-        }
-        
         if (S.verbosity > 0){
             printf("============================[ Problem Statistics ]=============================\n");
             printf("|                                                                             |\n"); }
         
-        parse_DIMACS(in, S, (bool)strictp);
-        gzclose(in);
+        if (resume_from) {
+            SnapshotReader in((const char*)resume_from);
+            if (!resume(&S, in)) {
+                printf("ERROR! Could not read checkpoint: %s\n", (const char*)resume_from);
+                exit(1);
+            }
+        }
+        else if (load_snapshot) {
+            SnapshotReader in((const char*)load_snapshot);
+            if (!S.loadSnapshot(in)) {
+                printf("ERROR! Could not read snapshot: %s\n", (const char*)load_snapshot);
+                exit(1);
+            }
+        }
+        else if (!loadDimacs(argc == 1 ? NULL : argv[1], S, (bool)strictp, parse_threads)) {
+            printf("ERROR! Could not open file: %s\n", argc == 1 ? "<stdin>" : argv[1]);
+            exit(1);
+        }
         FILE* res = (argc >= 3) ? fopen(argv[2], "wb") : NULL;
 
         if (S.verbosity > 0){
@@ -126,13 +179,26 @@ int main(int argc, char** argv)
         // voluntarily:
         sigTerm(SIGINT_interrupt);
 
-        S.eliminate(true);
+        // A snapshot (or checkpoint) is already preprocessed:
+        if (!load_snapshot && !resume_from)
+            S.eliminate(true);
+
+        if (save_snapshot) {
+            SnapshotWriter out((const char*)save_snapshot);
+            S.saveSnapshot(out);
+            if (!out.close()) {
+                printf("ERROR! Could not write snapshot: %s\n", (const char*)save_snapshot);
+                exit(1);
+            }
+        }
+
         double simplified_time = cpuTime();
         if (S.verbosity > 0){
             printf("|  Simplification time:  %12.2f s                                       |\n", simplified_time - parsed_time);
             printf("|                                                                             |\n"); }
 
         if (!S.okay()){
+            finishProof(proof.get(), true);
             if (res != NULL) fprintf(res, "UNSAT\n"), fclose(res);
             if (S.verbosity > 0){
                 printf("===============================================================================\n");
@@ -154,6 +220,8 @@ int main(int argc, char** argv)
         if (dimacs && ret == l_Undef)
             S.toDimacs((const char*)dimacs);
 
+        finishProof(proof.get(), ret == l_False);
+
         if (S.verbosity > 0){
             S.printStats();
             printf("\n"); }
@@ -19,6 +19,7 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include "minisat/core/SolverTypes.h"
 #include "cs/CubifyingSolver.h"
+#include "cs/CubeConquer.h"
 
 Minisat::SimpSolver* makeSolver()
 {
@@ -30,12 +31,69 @@ Minisat::lbool payload(Minisat::Solver* S)
 	auto solver = dynamic_cast<Minisat::CubifyingSolver*>(S);
 	assert(solver != nullptr);
 
+	// These modes search without bootstrap(), which keeps cube search on one
+	// thread for the proof, and the clauses imported from other processes
+	// are not in the proof.
+	if (solver->proof != NULL && (solver->emitCubes > 0 || solver->servePort > 0 || !solver->connectTo.empty())) {
+		printf("ERROR! -proof cannot be combined with -emit-cubes, -serve or -connect\n");
+		exit(1);
+	}
+
+	if (solver->emitCubes > 0) {
+		if (solver->cubeOut.empty()) {
+			printf("ERROR! -emit-cubes needs -cube-out\n");
+			exit(1);
+		}
+		return solver->emitCubeSplit();
+	}
+	if (solver->servePort > 0) {
+		Minisat::CubeCoordinator coordinator(*solver, solver->servePort, solver->serveCubes, solver->conquerBudget);
+		return coordinator.run();
+	}
+	if (!solver->connectTo.empty()) {
+		Minisat::CubeClient client(*solver, solver->connectTo);
+		return client.run();
+	}
 	return solver->interleavedSolve();
 }
 
+bool resume(Minisat::Solver* S, Minisat::SnapshotReader& in)
+{
+	auto solver = dynamic_cast<Minisat::CubifyingSolver*>(S);
+	return solver->loadCheckpoint(in);
+}
+
 void postSolve(Minisat::Solver* S, FILE* f)
 {
 	auto solver = dynamic_cast<Minisat::CubifyingSolver*>(S);
 	solver->printStepStats();
 	printf("final mean score      : %-12f\n", solver->meanScore());
+	printf("cube index memory     : %.2f MB\n", solver->indexMemory() / (1024.0 * 1024.0));
+	printf("cube state memory     : %.2f MB\n", solver->cubeMemory() / (1024.0 * 1024.0));
+	if (solver->memoryPurges > 0) {
+		printf("cube memory purges    : %ld%s\n", solver->memoryPurges,
+			solver->cubifyDisabled ? " (cubification disabled)" : "");
+	}
+	if (solver->rescoreAfter > 0) {
+		printf("rescored cubes        : %-12ld\n", solver->cubeRescores);
+	}
+	if (solver->probeInterval > 0) {
+		printf("probe rounds          : %-12ld\n", solver->probeRounds);
+		printf("probed units          : %-12ld\n", solver->probeUnits);
+		printf("hyper-binary clauses  : %-12ld\n", solver->hyperBinaries);
+		printf("substituted variables : %-12ld\n", solver->substitutedVars);
+		printf("transitive binaries   : %-12ld\n", solver->transitiveRemoved);
+	}
+	if (solver->elimInterval > 0 || solver->elimUnits > 0) {
+		printf("elimination rounds    : %-12ld\n", solver->elimRounds);
+		printf("eliminated variables  : %-12ld\n", solver->elimVars);
+		printf("resolvents            : %-12ld\n", solver->elimResolvents);
+		printf("clauses removed       : %-12ld\n", solver->elimRemoved);
+	}
+	if (!solver->scoreCache.empty()) {
+		printf("cached cubes          : %-12d\n", solver->cachedCubes);
+		if (!solver->saveScoreCache()) {
+			printf("WARNING! Could not write score cache: %s\n", solver->scoreCache.c_str());
+		}
+	}
 }
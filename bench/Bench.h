@@ -0,0 +1,86 @@
+/****************************************************************************************[Bench.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef BenchH
+#define BenchH
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Shared pieces of cs_bench: a wall clock, and the results, which are
+// written out as one JSON document.
+namespace Bench
+{
+// Wall clock time in seconds, from an arbitrary origin.
+double now();
+
+// One measured operation of a microbenchmark, e.g. "CubeQueue.push" for n
+// cubes of the given width.
+struct MicroResult
+{
+	std::string name;
+	size_t n;
+	int width;
+	uint64_t ops;
+	double seconds;
+};
+
+// Cubification of every clause of one instance (see MacroBench.cc). The
+// counters are totals over the repetitions.
+struct MacroResult
+{
+	std::string instance;
+	int vars;
+	int clauses;
+	int reps;
+	uint64_t cubifications;
+	uint64_t propagations;
+	uint64_t implicants;
+	uint64_t cubes;
+	double seconds;
+};
+
+struct Results
+{
+	std::vector<MicroResult> micro;
+	std::vector<MacroResult> macro;
+};
+
+// Run the microbenchmarks for sizes 10^4, 10^5, ... up to maxSize, and
+// widths 2 to 8. First checks the Cube kernels against the portable ones;
+// returns false if they disagree.
+bool runMicro(Results&, size_t maxSize, int seed);
+
+// Check that a stale cube, re-scored after another was refuted to a unit,
+// is picked rather than re-scored again. Returns false, with a message, if
+// not.
+bool checkRescore();
+
+// Run the macro benchmark on each instance, reps times. Returns false if an
+// instance could not be read.
+bool runMacro(Results&, const std::vector<std::string>& instances, int reps);
+
+// Write the results as JSON.
+void writeJson(FILE*, const Results&);
+}
+
+#endif
@@ -0,0 +1,186 @@
+/**********************************************************************************[MacroBench.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "cs/CubifyingSolver.h"
+#include "cs/DimacsLoader.h"
+#include "Bench.h"
+
+namespace Bench
+{
+namespace
+{
+// Gives the benchmark access to the cubification kernel.
+//
+// Every clause is cubified once, from the same state: right after
+// elimination, at decision level 0. The conflicting subcubes that are found
+// are not acted upon.
+class KernelSolver : public Minisat::CubifyingSolver
+{
+public:
+	bool load(const std::string& path);
+
+	// Cubify every clause, adding to the counters of the result.
+	void run(MacroResult&);
+};
+
+bool KernelSolver::load(const std::string& path)
+{
+	verbosity = 0;
+	if (!Minisat::loadDimacs(path.c_str(), *this, false, 1)) return false;
+
+	eliminate(true);
+	if (okay()) bootstrap();
+	return true;
+}
+
+void KernelSolver::run(MacroResult& result)
+{
+	result.vars = nVars();
+	result.clauses = nClauses();
+	if (!okay()) return;
+
+	const uint64_t props0 = propagations;
+	const uint64_t implicants0 = scoredImplicants;
+
+	double t0 = now();
+	for (int i = 0; i < clauses.size(); ++i) {
+		Cube root;
+		Minisat::lbool status;
+		if (!prepareCubify(i, root, status)) continue;
+
+		cubifyInternal(i, root);
+		result.cubifications++;
+	}
+	double t1 = now();
+
+	result.seconds += t1 - t0;
+	result.propagations += propagations - props0;
+	result.implicants += scoredImplicants - implicants0;
+	result.cubes += cq.size();
+}
+
+// A queue of two stale cubes, where re-scoring the best one refutes it to a
+// unit. The unit implies a chain of literals, so the epoch moves on by more
+// than rescoreAfter while pickCube() runs; the other cube must then come
+// out with a score of the new epoch, rather than be re-scored forever.
+class RescoreSolver : public Minisat::CubifyingSolver
+{
+public:
+	RescoreSolver();
+
+	// Pick a cube; returns whether one was picked, and how many re-scores
+	// that took.
+	bool pick(uint64_t& rescores);
+};
+
+RescoreSolver::RescoreSolver()
+{
+	using Minisat::mkLit;
+	verbosity = 0;
+	rescoreAfter = 5;
+	k_t = 0.0;
+	eliminate(true);
+	for (int v = 0; v < 16; ++v) newVar();
+
+	// Five units, to age the cubes pushed below.
+	for (int v = 0; v < 5; ++v) addClause(mkLit(v));
+
+	// a = 5 fails, and its negation implies 6..11.
+	addClause(~mkLit(5), mkLit(12));
+	addClause(~mkLit(5), ~mkLit(12));
+	addClause(mkLit(5), mkLit(6));
+	for (int v = 6; v < 11; ++v) addClause(~mkLit(v), mkLit(v + 1));
+
+	// d = 13 implies 14 and 15.
+	addClause(~mkLit(13), mkLit(14));
+	addClause(~mkLit(13), mkLit(15));
+	bootstrap();
+
+	Cube a, d;
+	a.push(mkLit(5));
+	d.push(mkLit(13));
+	cq.setEpoch(0);
+	cq.push(a, 10.0, -1);
+	cq.push(d, 5.0, -1);
+}
+
+bool RescoreSolver::pick(uint64_t& rescores)
+{
+	Cube cube;
+	const bool picked = pickCube(cube);
+	rescores = cubeRescores;
+	return picked;
+}
+}
+
+bool checkRescore()
+{
+	// The solver is left to the thread if pickCube() does not return.
+	std::atomic<bool> done(false);
+	bool picked = false;
+	uint64_t rescores = 0;
+	RescoreSolver* S = new RescoreSolver();
+	std::thread t([&]() {
+		picked = S->pick(rescores);
+		done = true;
+	});
+
+	for (int k = 0; k < 100 && !done; ++k) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	if (!done) {
+		fprintf(stderr, "ERROR! pickCube() keeps re-scoring a cube after a unit was learnt\n");
+		t.detach();
+		return false;
+	}
+	t.join();
+	delete S;
+
+	if (!picked || rescores != 2) {
+		fprintf(stderr, "ERROR! pickCube() made %d re-scores after a unit was learnt, instead of 2\n", (int)rescores);
+		return false;
+	}
+	return true;
+}
+
+bool runMacro(Results& results, const std::vector<std::string>& instances, int reps)
+{
+	for (const auto& path : instances) {
+		MacroResult result = { path, 0, 0, reps, 0, 0, 0, 0, 0.0 };
+
+		// A fresh solver for every repetition, since the cube queue affects
+		// the paths that are walked.
+		for (int r = 0; r < reps; ++r) {
+			KernelSolver S;
+			if (!S.load(path)) {
+				fprintf(stderr, "ERROR! Could not open file: %s\n", path.c_str());
+				return false;
+			}
+			S.run(result);
+		}
+		results.macro.push_back(result);
+	}
+	return true;
+}
+
+}
@@ -0,0 +1,496 @@
+/**********************************************************************************[Main_batch.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "minisat/utils/Options.h"
+#include "minisat/utils/System.h"
+#include "cs/CubifyingSolver.h"
+#include "cs/DimacsLoader.h"
+
+using namespace Minisat;
+
+// Runs minisat_cubing on a list of instances, at every point of a grid of
+// options, and writes the results as the JSON of tools/sattools/timed_run.py.
+//
+// Each run is a child forked from this process, which never builds a solver
+// of its own: the child is pinned to a core, limited with setrlimit(), and
+// then reads the instance and solves it, with its output discarded. Its
+// statistics come back through a pipe, and its CPU time and peak memory from
+// wait4(), as soon as it exits.
+namespace
+{
+// Exit codes of a run, besides 10 (SAT) and 20 (UNSAT). A parse error exits
+// with 3, as in minisat_cubing.
+const int ExitIndet = 0;
+const int ExitError = 1;
+const int ExitMemout = 2;
+
+// Seconds that a run has to stop after its time limit, before it is killed.
+const int GraceTime = 5;
+
+// The options of this program, as opposed to those passed on to the runs.
+const std::set<std::string> batchOptions = {
+	"jobs", "timeout", "mem-lim", "pin", "grid-k_c", "grid-k_t", "grid-max-cubify", "seeds",
+};
+
+// One axis of the grid: a solver option, and the values it takes.
+struct Axis
+{
+	std::string name;
+	std::vector<std::string> values;
+};
+
+// A run of the solver on one instance, at one point of the grid.
+struct Job
+{
+	std::string instance;
+
+	// The options of the grid point, e.g. ("k_c", "2").
+	std::vector<std::pair<std::string, std::string>> params;
+
+	// While running.
+	pid_t pid = 0;
+	int slot = -1;
+	int cpu = -1;
+	int pipe = -1;
+	double start = 0.0;
+	double elapsed = 0.0;
+
+	// Once done: OK, TIMEOUT, MEMOUT or ERROR, and the JSON of the run, once done.
+	std::string result;
+	std::string record;
+};
+
+double now()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+std::string quoted(const std::string& s)
+{
+	std::string q = "\"";
+	for (char c : s) {
+		if (c == '"' || c == '\\') q += '\\';
+		q += c;
+	}
+	return q + "\"";
+}
+
+// The name of the option in a command line argument, e.g. "pin" for
+// "-no-pin", or "" if it is not an option.
+std::string optionName(const char* arg)
+{
+	if (arg[0] != '-') return "";
+	std::string s = arg + 1;
+	s = s.substr(0, s.find('='));
+	if (s.compare(0, 3, "no-") == 0 && batchOptions.count(s.substr(3)) > 0) {
+		return s.substr(3);
+	}
+	return s;
+}
+
+// Parse one option as if given on the command line. Unknown options and bad
+// values exit with an error, as usual.
+void setOption(const std::string& arg)
+{
+	std::vector<char> a(arg.begin(), arg.end());
+	a.push_back('\0');
+	char* argv[] = { (char*)"", a.data(), nullptr };
+	int argc = 2;
+	parseOptions(argc, argv, true);
+}
+
+std::vector<std::string> splitList(const char* s)
+{
+	std::vector<std::string> v;
+	if (s == nullptr) return v;
+
+	std::string item;
+	for (const char* p = s; ; ++p) {
+		if (*p == ',' || *p == '\0') {
+			if (!item.empty()) v.push_back(item);
+			item.clear();
+			if (*p == '\0') break;
+		}
+		else if (*p != ' ') {
+			item += *p;
+		}
+	}
+	return v;
+}
+
+// One path per line; empty lines and lines starting with '#' are skipped.
+bool readInstances(const char* path, std::vector<std::string>& instances)
+{
+	FILE* f = fopen(path, "r");
+	if (f == nullptr) return false;
+
+	char line[4096];
+	while (fgets(line, sizeof(line), f) != nullptr) {
+		std::string s = line;
+		while (!s.empty() && isspace((unsigned char)s.back())) s.pop_back();
+		if (!s.empty() && s[0] != '#') instances.push_back(s);
+	}
+	fclose(f);
+	return true;
+}
+
+// The cores that this process may run on.
+std::vector<int> allowedCpus()
+{
+	std::vector<int> cpus;
+	cpu_set_t set;
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int c = 0; c < CPU_SETSIZE; ++c) {
+			if (CPU_ISSET(c, &set)) cpus.push_back(c);
+		}
+	}
+	return cpus;
+}
+
+// The solver of the child, for the signal handler.
+CubifyingSolver* running = nullptr;
+volatile sig_atomic_t timedOut = 0;
+
+// At the time limit (SIGXCPU or SIGALRM), ask the solver to stop, so that
+// its statistics are still written. If it has not stopped GraceTime seconds
+// later, give up on them.
+void onLimit(int sig)
+{
+	if (!timedOut) {
+		timedOut = 1;
+		if (running != nullptr) running->interrupt();
+		alarm(GraceTime);
+	}
+	else if (sig == SIGALRM) {
+		_exit(ExitIndet);
+	}
+}
+
+// The child of a run. Writes the members of its JSON record to out.
+[[noreturn]] void runJob(const Job& job, int out, int timeout, int memLim)
+{
+	if (job.cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(job.cpu, &set);
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+	if (timeout > 0) {
+		rlimit rl;
+		rl.rlim_cur = timeout;
+		rl.rlim_max = timeout + GraceTime + 1;
+		setrlimit(RLIMIT_CPU, &rl);
+		signal(SIGXCPU, onLimit);
+		signal(SIGALRM, onLimit);
+		alarm(timeout);
+	}
+	if (memLim > 0) limitMemory(memLim);
+
+	// The solver reads its options when it is constructed.
+	for (const auto& p : job.params) {
+		setOption("-" + p.first + "=" + p.second);
+	}
+	if (freopen("/dev/null", "w", stdout) == nullptr) _exit(ExitError);
+
+	FILE* f = fdopen(out, "w");
+	int code = ExitError;
+	try {
+		// The process exits right after, so the solver is never freed.
+		CubifyingSolver* S = new CubifyingSolver();
+		S->verbosity = 0;
+		running = S;
+
+		double t0 = cpuTime();
+		if (!loadDimacs(job.instance.c_str(), *S, false, 1)) {
+			fprintf(f, "\"error\":\"could not open the instance\"");
+			fclose(f);
+			_exit(ExitError);
+		}
+		int vars = S->nVars();
+		int clauses = S->nClauses();
+		double t1 = cpuTime();
+
+		S->eliminate(true);
+		lbool ret = S->okay() ? S->interleavedSolve() : l_False;
+		double t2 = cpuTime();
+
+		double mean = S->meanScore();
+		fprintf(f, "\"status\":\"%s\",\"vars\":%d,\"clauses\":%d,\"parse_time\":%.6f,\"solve_time\":%.6f,\"stats\":{",
+			(ret == l_True) ? "sat" : (ret == l_False) ? "unsat" : "indet", vars, clauses, t1 - t0, t2 - t1);
+		S->writeStepStats(f);
+		fprintf(f, ",\"mean_score\":%g,\"index_memory\":%zu,\"cube_memory\":%zu,\"memory_purges\":%" PRIu64
+			",\"cube_rescores\":%" PRIu64 ",\"probe_rounds\":%" PRIu64 ",\"probe_units\":%" PRIu64
+			",\"hyper_binaries\":%" PRIu64 ",\"substituted_vars\":%" PRIu64 ",\"transitive_removed\":%" PRIu64
+			",\"elim_rounds\":%" PRIu64 ",\"elim_vars\":%" PRIu64 ",\"elim_resolvents\":%" PRIu64 ",\"elim_removed\":%" PRIu64 "}",
+			std::isfinite(mean) ? mean : 0.0, S->indexMemory(), S->cubeMemory(),
+			(uint64_t)S->memoryPurges, (uint64_t)S->cubeRescores, (uint64_t)S->probeRounds, (uint64_t)S->probeUnits,
+			(uint64_t)S->hyperBinaries, (uint64_t)S->substitutedVars, (uint64_t)S->transitiveRemoved,
+			(uint64_t)S->elimRounds, (uint64_t)S->elimVars, (uint64_t)S->elimResolvents, (uint64_t)S->elimRemoved);
+
+		code = (ret == l_True) ? 10 : (ret == l_False) ? 20 : ExitIndet;
+	}
+	catch (OutOfMemoryException&) {
+		code = ExitMemout;
+	}
+	catch (std::bad_alloc&) {
+		code = ExitMemout;
+	}
+	fclose(f);
+	_exit(code);
+}
+
+// Fork the child of the job.
+bool startJob(Job& job, int timeout, int memLim)
+{
+	int fds[2];
+	if (pipe(fds) != 0) return false;
+
+	// Whatever is buffered would otherwise be written by the child, too.
+	fflush(stdout);
+	job.start = now();
+	job.pid = fork();
+	if (job.pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	if (job.pid == 0) {
+		close(fds[0]);
+		runJob(job, fds[1], timeout, memLim);
+	}
+	close(fds[1]);
+	job.pipe = fds[0];
+	return true;
+}
+
+// Make the JSON record of the job, whose child has exited.
+void finishJob(Job& job, int status, const rusage& ru, const std::string& solver, int timeout, const std::vector<std::string>& extra)
+{
+	job.elapsed = now() - job.start;
+
+	// What the record of timed_run.py would say.
+	int code = -1;
+	const char* result = "ERROR";
+	if (WIFEXITED(status)) {
+		code = WEXITSTATUS(status);
+		if (code == 10 || code == 20) result = "OK";
+		else if (code == ExitIndet) result = "TIMEOUT";
+		else if (code == ExitMemout) result = "MEMOUT";
+	}
+	else if (WIFSIGNALED(status)) {
+		code = -WTERMSIG(status);
+		if (WTERMSIG(status) == SIGXCPU || WTERMSIG(status) == SIGKILL) result = "TIMEOUT";
+	}
+	if (timeout > 0 && job.elapsed > timeout && strcmp(result, "OK") == 0) result = "TIMEOUT";
+	job.result = result;
+
+	// The child has exited, so this reads until the end. What it writes fits
+	// in the pipe, so it never waited for this.
+	std::string members;
+	char buf[4096];
+	ssize_t n;
+	while ((n = read(job.pipe, buf, sizeof(buf))) != 0) {
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		members.append(buf, n);
+	}
+	close(job.pipe);
+	job.pipe = -1;
+
+	std::string& r = job.record;
+	char num[256];
+
+	r = "{\"command_line\": [" + quoted(solver);
+	for (const auto& arg : extra) r += ", " + quoted(arg);
+	for (const auto& p : job.params) r += ", " + quoted("-" + p.first + "=" + p.second);
+	r += ", " + quoted(job.instance) + "]";
+
+	double cpuTime = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + 1e-6 * (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+	snprintf(num, sizeof(num), ", \"elapsed_time\": %.6f, \"return_code\": %d, \"result\": \"%s\", \"cpu_time\": %.6f, \"max_rss_mb\": %.2f, \"cpu\": %d",
+		job.elapsed, code, result, cpuTime, ru.ru_maxrss / 1024.0, job.cpu);
+	r += num;
+
+	r += ", \"instance\": " + quoted(job.instance) + ", \"params\": {";
+	for (size_t i = 0; i < job.params.size(); ++i) {
+		snprintf(num, sizeof(num), "%s%s: %g", (i > 0) ? ", " : "", quoted(job.params[i].first).c_str(), strtod(job.params[i].second.c_str(), nullptr));
+		r += num;
+	}
+	r += "}";
+	if (!members.empty()) r += ", " + members;
+	r += "}";
+}
+
+// Write the finished runs, in job order, replacing the file only once
+// complete.
+bool writeResults(const char* path, int timeout, const std::vector<Job>& jobs)
+{
+	std::string tmp = std::string(path) + ".tmp";
+	FILE* f = fopen(tmp.c_str(), "w");
+	if (f == nullptr) return false;
+
+	fprintf(f, "{\"timeout\": %d, \"runs\": [", timeout);
+	bool first = true;
+	for (const auto& job : jobs) {
+		if (job.record.empty()) continue;
+		fprintf(f, "%s\n  %s", first ? "" : ",", job.record.c_str());
+		first = false;
+	}
+	fprintf(f, "\n]}\n");
+	return (fclose(f) == 0) && (rename(tmp.c_str(), path) == 0);
+}
+}
+
+int main(int argc, char** argv)
+{
+	setUsageHelp("USAGE: %s [options] <instance-list> <output-file>\n\n  where the instance list has the path of a DIMACS file on each line, and other options are passed to every run.\n");
+
+	IntOption    jobs("BATCH", "jobs", "Runs at the same time (0=one per core).", 0, IntRange(0, 1024));
+	IntOption    timeout("BATCH", "timeout", "Limit on the CPU and wall-clock time of each run, in seconds (0=none).", 0, IntRange(0, INT32_MAX));
+	IntOption    mem_lim("BATCH", "mem-lim", "Limit on the memory of each run, in megabytes (0=none).", 0, IntRange(0, INT32_MAX));
+	BoolOption   pin("BATCH", "pin", "Pin each run to a core of its own.", true);
+	StringOption grid_k_c("BATCH", "grid-k_c", "Values of -k_c to run with, separated by commas.");
+	StringOption grid_k_t("BATCH", "grid-k_t", "Values of -k_t to run with, separated by commas.");
+	StringOption grid_max_cubify("BATCH", "grid-max-cubify", "Values of -max-cubify to run with, separated by commas.");
+	StringOption seeds("BATCH", "seeds", "Values of -rnd-seed to run with, separated by commas.");
+
+	// The solver options, for the command lines of the records.
+	std::vector<std::string> extra;
+	for (int i = 1; i < argc; ++i) {
+		std::string name = optionName(argv[i]);
+		if (!name.empty() && batchOptions.count(name) == 0) extra.push_back(argv[i]);
+	}
+
+	parseOptions(argc, argv, true);
+	if (argc != 3) {
+		fprintf(stderr, "ERROR! Give the instance list and the output file. Use '--help' for help.\n");
+		exit(1);
+	}
+
+	std::vector<std::string> instances;
+	if (!readInstances(argv[1], instances)) {
+		fprintf(stderr, "ERROR! Could not open file: %s\n", argv[1]);
+		exit(1);
+	}
+
+	std::vector<Axis> grid = {
+		{ "k_c", splitList(grid_k_c) },
+		{ "k_t", splitList(grid_k_t) },
+		{ "max-cubify", splitList(grid_max_cubify) },
+		{ "rnd-seed", splitList(seeds) },
+	};
+
+	// Check the values now, rather than in every run.
+	for (const auto& axis : grid) {
+		for (const auto& value : axis.values) {
+			setOption("-" + axis.name + "=" + value);
+		}
+	}
+
+	std::vector<Job> all;
+	for (const auto& instance : instances) {
+		std::vector<std::vector<std::pair<std::string, std::string>>> points(1);
+		for (const auto& axis : grid) {
+			if (axis.values.empty()) continue;
+			std::vector<std::vector<std::pair<std::string, std::string>>> next;
+			for (const auto& point : points) {
+				for (const auto& value : axis.values) {
+					next.push_back(point);
+					next.back().emplace_back(axis.name, value);
+				}
+			}
+			points.swap(next);
+		}
+		for (const auto& point : points) {
+			all.emplace_back();
+			all.back().instance = instance;
+			all.back().params = point;
+		}
+	}
+
+	std::vector<int> cpus = allowedCpus();
+	int slots = (jobs > 0) ? (int)jobs : std::max((int)cpus.size(), 1);
+	std::vector<bool> busy(slots, false);
+
+	size_t next = 0;
+	size_t done = 0;
+	int active = 0;
+	while (done < all.size()) {
+		while (active < slots && next < all.size()) {
+			Job& job = all[next++];
+			job.slot = (int)(std::find(busy.begin(), busy.end(), false) - busy.begin());
+			job.cpu = (pin && !cpus.empty()) ? cpus[job.slot % cpus.size()] : -1;
+			if (!startJob(job, timeout, mem_lim)) {
+				fprintf(stderr, "ERROR! Could not start a run: %s\n", strerror(errno));
+				exit(1);
+			}
+			busy[job.slot] = true;
+			active++;
+		}
+
+		int status;
+		rusage ru;
+		pid_t pid = wait4(-1, &status, 0, &ru);
+		if (pid < 0) {
+			if (errno == EINTR) continue;
+			fprintf(stderr, "ERROR! Could not wait for a run: %s\n", strerror(errno));
+			exit(1);
+		}
+
+		for (auto& job : all) {
+			if (job.pid != pid || !job.record.empty()) continue;
+			finishJob(job, status, ru, "minisat_cubing", timeout, extra);
+			busy[job.slot] = false;
+			active--;
+			done++;
+
+			printf("[%zu/%zu] %s", done, all.size(), job.instance.c_str());
+			for (const auto& p : job.params) printf(" -%s=%s", p.first.c_str(), p.second.c_str());
+			printf(": %s, %.2f s\n", job.result.c_str(), job.elapsed);
+			fflush(stdout);
+			break;
+		}
+		if (!writeResults(argv[2], timeout, all)) {
+			fprintf(stderr, "ERROR! Could not write file: %s\n", argv[2]);
+			exit(1);
+		}
+	}
+
+	return 0;
+}
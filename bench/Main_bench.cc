@@ -0,0 +1,128 @@
+/**********************************************************************************[Main_bench.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <cstdlib>
+
+#include "minisat/utils/Options.h"
+#include "Bench.h"
+
+using namespace Minisat;
+
+namespace Bench
+{
+// The instances of the macro benchmark, unless others are given.
+static const char* defaultInstances[] = {
+	"bench/instances/php8.cnf",
+	"bench/instances/r150_0.cnf",
+	"bench/instances/r250_0.cnf",
+	"bench/instances/sat300.cnf",
+};
+
+double now()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void writeString(FILE* f, const std::string& s)
+{
+	fputc('"', f);
+	for (char c : s) {
+		if (c == '"' || c == '\\') fputc('\\', f);
+		fputc(c, f);
+	}
+	fputc('"', f);
+}
+
+static double ratio(double x, double y)
+{
+	return (y > 0) ? x / y : 0.0;
+}
+
+void writeJson(FILE* f, const Results& results)
+{
+	fprintf(f, "{\n  \"micro\": [");
+	for (size_t k = 0; k < results.micro.size(); ++k) {
+		const auto& r = results.micro[k];
+		fprintf(f, "%s\n    {\"name\": ", (k > 0) ? "," : "");
+		writeString(f, r.name);
+		fprintf(f, ", \"n\": %zu, \"width\": %d, \"ops\": %llu, \"seconds\": %.6f, \"ns_per_op\": %.2f}",
+			r.n, r.width, (unsigned long long)r.ops, r.seconds, ratio(r.seconds * 1e9, r.ops));
+	}
+	fprintf(f, "\n  ],\n  \"macro\": [");
+	for (size_t k = 0; k < results.macro.size(); ++k) {
+		const auto& r = results.macro[k];
+		fprintf(f, "%s\n    {\"instance\": ", (k > 0) ? "," : "");
+		writeString(f, r.instance);
+		fprintf(f, ", \"vars\": %d, \"clauses\": %d, \"reps\": %d, \"cubifications\": %llu"
+			", \"propagations\": %llu, \"implicants\": %llu, \"cubes\": %llu, \"seconds\": %.6f"
+			", \"props_per_sec\": %.0f, \"ns_per_implicant\": %.2f}",
+			r.vars, r.clauses, r.reps, (unsigned long long)r.cubifications,
+			(unsigned long long)r.propagations, (unsigned long long)r.implicants,
+			(unsigned long long)r.cubes, r.seconds,
+			ratio(r.propagations, r.seconds), ratio(r.seconds * 1e9, r.implicants));
+	}
+	fprintf(f, "\n  ]\n}\n");
+}
+}
+
+int main(int argc, char** argv)
+{
+	setUsageHelp("USAGE: %s [options] [instances...]\n\n  where the instances are DIMACS files for the macro benchmark (by default, the ones in bench/instances).\n");
+
+	BoolOption   micro("BENCH", "micro", "Run the microbenchmarks.", true);
+	BoolOption   macro("BENCH", "macro", "Run the macro benchmark.", true);
+	IntOption    max_size("BENCH", "max-size", "Largest number of cubes (or clauses) in the microbenchmarks.", 1000000, IntRange(10000, INT32_MAX));
+	IntOption    reps("BENCH", "reps", "Repetitions of the macro benchmark per instance.", 20, IntRange(1, INT32_MAX));
+	IntOption    seed("BENCH", "seed", "Seed for the random data of the microbenchmarks.", 1, IntRange(0, INT32_MAX));
+	StringOption out("BENCH", "out", "Write the results to this file, rather than to standard output.");
+
+	parseOptions(argc, argv, true);
+
+	std::vector<std::string> instances;
+	for (int i = 1; i < argc; ++i) {
+		instances.push_back(argv[i]);
+	}
+	if (instances.empty()) {
+		for (auto path : Bench::defaultInstances) {
+			instances.push_back(path);
+		}
+	}
+
+	Bench::Results results;
+	if (!Bench::checkRescore()) {
+		exit(1);
+	}
+	if (micro && !Bench::runMicro(results, (size_t)(int)max_size, seed)) {
+		exit(1);
+	}
+	if (macro && !Bench::runMacro(results, instances, reps)) {
+		exit(1);
+	}
+
+	FILE* f = (out == NULL) ? stdout : fopen(out, "w");
+	if (f == NULL) {
+		fprintf(stderr, "ERROR! Could not open file: %s\n", (const char*)out);
+		exit(1);
+	}
+	Bench::writeJson(f, results);
+	if (f != stdout) fclose(f);
+
+	return 0;
+}
@@ -0,0 +1,352 @@
+/**********************************************************************************[MicroBench.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <unordered_set>
+
+#include "cs/Bimap.h"
+#include "cs/Cube.h"
+#include "cs/CubeIndex.h"
+#include "cs/CubeKernels.h"
+#include "cs/CubeQueue.h"
+#include "Bench.h"
+
+using Minisat::mkLit;
+
+namespace Bench
+{
+namespace
+{
+// Variables the random cubes are drawn from. Large enough that cubes of
+// width 2 are mostly distinct even at 10^7 cubes.
+const int NumVars = 1 << 16;
+
+// Keeps the compiler from optimising away results that are never used.
+volatile size_t sink;
+
+// The literals of n random cubes of the given width, back to back. No cube
+// has the same variable twice.
+std::vector<Lit> randomCubes(std::mt19937& rng, size_t n, int width)
+{
+	std::uniform_int_distribution<int> var(0, NumVars - 1);
+	std::vector<Lit> lits(n * width);
+
+	for (size_t k = 0; k < n; ++k) {
+		Lit* c = &lits[k * width];
+		for (int l = 0; l < width; ++l) {
+			int v;
+			do {
+				v = var(rng);
+			} while (std::any_of(c, c + l, [v](Lit x) { return Minisat::var(x) == v; }));
+			c[l] = mkLit(v, rng() & 1);
+		}
+	}
+	return lits;
+}
+
+// The cubes of randomCubes(), without duplicates.
+std::vector<Cube> makeCubes(const std::vector<Lit>& lits, size_t n, int width)
+{
+	std::unordered_set<Cube> seen;
+	std::vector<Cube> cubes;
+	cubes.reserve(n);
+	for (size_t k = 0; k < n; ++k) {
+		Cube cube(&lits[k * width], &lits[(k + 1) * width]);
+		if (seen.insert(cube).second) {
+			cubes.push_back(cube);
+		}
+	}
+	return cubes;
+}
+
+// Times f(), which does ops operations, and records it.
+template<class F>
+void measure(Results& results, const char* name, size_t n, int width, uint64_t ops, F f)
+{
+	double t0 = now();
+	f();
+	double t1 = now();
+	results.micro.push_back({ name, n, width, ops, t1 - t0 });
+}
+
+// Checks the set operations of Cube, which run on the kernels of
+// CubeKernels.h, against the portable kernels. Cubes are drawn from few
+// variables, so that they overlap, and up to twice as wide as the inline
+// storage. Returns false, with a message, on the first disagreement.
+bool checkCubeKernels(std::mt19937& rng, bool avx2)
+{
+	using namespace CubeKernels;
+	select(avx2);
+
+	const int maxWidth = 2 * Cube::InlineSize;
+	std::uniform_int_distribution<int> var(0, maxWidth + 4);
+	std::uniform_int_distribution<int> width(0, maxWidth);
+
+	auto randomCube = [&]() {
+		Cube cube;
+		for (int w = width(rng); (int)cube.size() < w;) {
+			cube.push(mkLit(var(rng), rng() & 1));
+		}
+		return cube;
+	};
+
+	for (int k = 0; k < 100000; ++k) {
+		Cube a = randomCube();
+		Cube b = (k & 1) ? randomCube() : a;
+
+		// Pop some literals of b, or add some, so that it is a subcube or a
+		// supercube of a every now and then.
+		if (k & 2) {
+			while (b.size() > 0 && (rng() & 1)) b.pop(b[rng() % b.size()]);
+		}
+		else {
+			while (rng() & 1) b.push(mkLit(var(rng), rng() & 1));
+		}
+
+		const Lit L = mkLit(var(rng), rng() & 1);
+		const bool ok =
+			a.contains(L) == Scalar::contains(a.begin(), a.size(), L) &&
+			(a == b) == (a.size() == b.size() && Scalar::equal(a.begin(), b.begin(), a.size())) &&
+			a.subsetOf(b) == Scalar::subsetOf(a.begin(), a.size(), b.begin(), b.size()) &&
+			b.startsWith(a) == (a.size() <= b.size() && Scalar::equal(a.begin(), b.begin(), a.size()));
+		if (!ok) {
+			fprintf(stderr, "ERROR! Cube kernels (avx2=%d) disagree with the portable ones at cubes of %zu and %zu literals\n",
+				(int)avx2, a.size(), b.size());
+			select(true);
+			return false;
+		}
+	}
+
+	select(true);
+	return true;
+}
+
+void benchCubes(Results& results, std::mt19937& rng, size_t n, int width)
+{
+	const auto lits = randomCubes(rng, n, width);
+	const auto other = randomCubes(rng, n, width);
+
+	// Building cubes literal by literal, as in cubification.
+	measure(results, "Cube.push", n, width, n * width, [&]() {
+		size_t total = 0;
+		for (size_t k = 0; k < n; ++k) {
+			Cube cube(&lits[k * width], &lits[(k + 1) * width]);
+			total += cube.hash();
+		}
+		sink = total;
+	});
+
+	const auto cubes = makeCubes(lits, n, width);
+	const auto absent = makeCubes(other, n, width);
+
+	// The set operations, between each cube and the next one.
+	measure(results, "Cube.contains", n, width, cubes.size(), [&]() {
+		size_t total = 0;
+		for (size_t k = 1; k < cubes.size(); ++k) {
+			total += cubes[k].contains(cubes[k - 1][0]);
+		}
+		sink = total;
+	});
+
+	measure(results, "Cube.subsetOf", n, width, cubes.size(), [&]() {
+		size_t total = 0;
+		for (size_t k = 1; k < cubes.size(); ++k) {
+			total += cubes[k - 1].subsetOf(cubes[k]);
+		}
+		sink = total;
+	});
+
+	// Visit the cubes in random order for lookups and removals. (For the
+	// lookups that miss, the order does not matter.)
+	const size_t m = std::min(cubes.size(), absent.size());
+	std::vector<size_t> order(m);
+	for (size_t k = 0; k < m; ++k) order[k] = k;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	{
+		// Large enough that no cube is evicted.
+		std::unique_ptr<CubeQueue> cq(new CubeQueue(cubes.size() + 1));
+		std::uniform_real_distribution<double> score(1.0, 100.0);
+
+		measure(results, "CubeQueue.push", n, width, cubes.size(), [&]() {
+			for (size_t k = 0; k < cubes.size(); ++k) {
+				cq->push(cubes[k], score(rng), (int)k);
+			}
+		});
+
+		const size_t peeks = std::min(cubes.size(), (size_t)1000000);
+		measure(results, "CubeQueue.peekBest", n, width, peeks, [&]() {
+			size_t total = 0;
+			for (size_t k = 0; k < peeks; ++k) {
+				total += cq->peekBest((int)(k & 7)).size();
+			}
+			sink = total;
+		});
+
+		// Half of the lookups hit, half miss.
+		measure(results, "CubeQueue.contains", n, width, m, [&]() {
+			size_t total = 0;
+			for (size_t k = 0; k < m; ++k) {
+				total += cq->contains((k & 1) ? absent[k] : cubes[order[k]]);
+			}
+			sink = total;
+		});
+
+		measure(results, "CubeQueue.pop", n, width, m, [&]() {
+			for (size_t k = 0; k < m; ++k) {
+				cq->pop(cubes[order[k]]);
+			}
+		});
+	}
+
+	{
+		std::unique_ptr<CubeIndex> ci(new CubeIndex());
+
+		measure(results, "CubeIndex.push", n, width, cubes.size(), [&]() {
+			for (size_t k = 0; k < cubes.size(); ++k) {
+				ci->push(cubes[k]);
+			}
+		});
+
+		measure(results, "CubeIndex.contains", n, width, m, [&]() {
+			size_t total = 0;
+			for (size_t k = 0; k < m; ++k) {
+				total += ci->contains((k & 1) ? absent[k] : cubes[order[k]]);
+			}
+			sink = total;
+		});
+
+		measure(results, "CubeIndex.pop", n, width, m, [&]() {
+			for (size_t k = 0; k < m; ++k) {
+				ci->pop(cubes[order[k]]);
+			}
+		});
+	}
+}
+
+// Churn like that of the solver between simplifications: clauses dropped
+// as in CubifyingSolverBase::dropClause(), the clause vector compacted as in
+// Solver::removeSatisfied(), new clauses learnt, and the persistent indices
+// renumbered as in CubifyingSolver::garbageCollect().
+void benchBimap(Results& results, std::mt19937& rng, size_t n)
+{
+	const int rounds = 10;
+
+	Bimap bi;
+	int size = 0;
+	measure(results, "Bimap.add", n, 0, n, [&]() {
+		for (size_t k = 0; k < n; ++k) {
+			bi.add(size++);
+		}
+	});
+
+	uint64_t swaps = 0, drops = 0, moves = 0, adds = 0;
+	double swapTime = 0.0, dropTime = 0.0, moveTime = 0.0, addTime = 0.0, compactTime = 0.0;
+
+	for (int r = 0; r < rounds; ++r) {
+		std::vector<int> picks(size / 10);
+		for (auto& i : picks) i = rng() % size;
+
+		double t0 = now();
+		for (size_t k = 0; k + 1 < picks.size(); k += 2) {
+			bi.swap(picks[k], picks[k + 1]);
+		}
+		double t1 = now();
+		swaps += picks.size() / 2;
+		swapTime += t1 - t0;
+
+		// Drop a twentieth of the clauses, each by swapping it with the last.
+		const int dropped = size / 20;
+		t0 = now();
+		for (int k = 0; k < dropped; ++k) {
+			const int i = picks[k] % size;
+			const int j = size - 1;
+			if (i != j) bi.swap(i, j);
+			bi.drop(j);
+			size--;
+		}
+		t1 = now();
+		drops += dropped;
+		dropTime += t1 - t0;
+
+		// Remove a tenth of the clauses as satisfied, moving the rest down.
+		std::vector<bool> satisfied(size);
+		for (int i = 0; i < size; ++i) satisfied[i] = (rng() % 10 == 0);
+		t0 = now();
+		int j = 0;
+		for (int i = 0; i < size; ++i) {
+			if (satisfied[i]) {
+				bi.remove(i);
+			}
+			else {
+				bi.move(i, j++);
+			}
+		}
+		bi.truncate(j);
+		t1 = now();
+		moves += size;
+		moveTime += t1 - t0;
+		size = j;
+
+		// Learn back about as many clauses as were removed.
+		const int learnt = (int)n - size;
+		t0 = now();
+		for (int k = 0; k < learnt; ++k) {
+			bi.add(size++);
+		}
+		t1 = now();
+		adds += learnt;
+		addTime += t1 - t0;
+
+		t0 = now();
+		if (bi.dead() >= size) {
+			sink = bi.compact().size();
+		}
+		t1 = now();
+		compactTime += t1 - t0;
+	}
+
+	results.micro.push_back({ "Bimap.swap", n, 0, swaps, swapTime });
+	results.micro.push_back({ "Bimap.drop", n, 0, drops, dropTime });
+	results.micro.push_back({ "Bimap.move", n, 0, moves, moveTime });
+	results.micro.push_back({ "Bimap.churnAdd", n, 0, adds, addTime });
+	results.micro.push_back({ "Bimap.compact", n, 0, (uint64_t)rounds, compactTime });
+}
+}
+
+bool runMicro(Results& results, size_t maxSize, int seed)
+{
+	std::mt19937 rng(seed);
+
+	if (!checkCubeKernels(rng, false) || !checkCubeKernels(rng, true)) {
+		return false;
+	}
+
+	for (size_t n = 10000; n <= maxSize; n *= 10) {
+		for (int width = 2; width <= 8; ++width) {
+			benchCubes(results, rng, n, width);
+		}
+		benchBimap(results, rng, n);
+	}
+	return true;
+}
+
+}
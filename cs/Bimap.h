@@ -22,7 +22,6 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include <cassert>
 #include <vector>
-#include <unordered_map>
 
 // Bidirectional int-to-int map.
 //
@@ -35,6 +34,10 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 // quickly locate it via this map, even if the clause has since moved (which
 // can happen e.g. due to simplification steps, where satisfied clauses are
 // removed).
+//
+// Persistent indices are handed out by a counter, so both directions are
+// dense vectors, with -1 marking a missing entry. Indices of clauses that no
+// longer exist are only reclaimed by compact().
 class Bimap
 {
 public:
@@ -51,12 +54,14 @@ public:
 	// Swap the transient index i with transient index j.
 	void swap(int i, int j);
 
-	// Indicate that the clause with transient index i will get transient
-	// index j at the next buffer flip.
-	void will_move(int i, int j);
-
-	// Enact a buffer flip.
-	void flip_buffer();
+	// In-place compaction of the clause vector, as in Solver::removeSatisfied
+	// and Solver::relocAll. Going through the clauses in order:
+	//   - move(i, j) when the clause at i moves to j (where j <= i);
+	//   - remove(i) when the clause at i is removed instead;
+	//   - truncate(n) at the end, when n clauses remain.
+	void move(int i, int j);
+	void remove(int i);
+	void truncate(int n);
 
 	// Return the transient index associated with the persistent index j.
 	int fw(int j) const;
@@ -64,18 +69,45 @@ public:
 	// Return the persistent index associated with the transient index i.
 	int bw(int i) const;
 
+	// Number of persistent indices handed out so far, and the number of those
+	// for clauses that no longer exist.
+	int size() const;
+	int dead() const;
+
+	// Renumber the persistent indices of existing clauses to 0, 1, 2, ...,
+	// keeping their order. Returns the old-to-new mapping (-1 for indices of
+	// clauses that no longer exist).
+	std::vector<int> compact();
+
+	// Replace the contents (e.g. when loading a snapshot): bw[i] is the
+	// persistent index for the transient index i, and n persistent indices
+	// have been handed out.
+	void assign(const std::vector<int>& bw, int n);
+
+	// A set of persistent indices of existing clauses, e.g. of the ones
+	// waiting for cubification. A clause leaves the set when it is dropped,
+	// so that the number of marked clauses is always up to date.
+	void mark(int j);
+	void unmark(int j);
+	bool marked(int j) const;
+	int nMarked() const;
+
+	// Bytes in use by the map.
+	size_t memoryUsage() const;
+
 private:
 	int next_free_index = 0;
+	int live = 0;
 
-	// Persistent-to-transient index map. Any clause that does not occur in
-	// this map no longer exists in the set.
-	std::unordered_map<int, int> ptt;
+	// Marked persistent indices (see mark()), and their number.
+	std::vector<char> marks;
+	int n_marked = 0;
 
-	// Transient-to-persistent index map.
-	std::vector<int> ttp;
+	// Persistent-to-transient index map. -1 for clauses that no longer exist.
+	std::vector<int> ptt;
 
-	// Transient-to-persistent index map (pending buffer flip).
-	std::vector<int> ttp_next;
+	// Transient-to-persistent index map. -1 for unmapped positions.
+	std::vector<int> ttp;
 };
 
 // Implementation below
@@ -88,12 +120,12 @@ inline int Bimap::add(int i)
 
 	int j = next_free_index++;
 
-	ptt[j] = i;
+	ptt.push_back(i);
 	if (ttp.size() <= i) {
 		ttp.resize(i + 1, -1);
 	}
 	ttp[i] = j;
-	ttp[i] = j;
+	live++;
 
 	return j;
 }
@@ -105,8 +137,10 @@ inline void Bimap::drop(int i)
 	assert(ttp[i] >= 0);
 #endif
 
-	ptt.erase(ttp[i]);
+	unmark(ttp[i]);
+	ptt[ttp[i]] = -1;
 	ttp[i] = -1;
+	live--;
 }
 
 inline void Bimap::swap(int i, int j)
@@ -126,33 +160,46 @@ inline void Bimap::swap(int i, int j)
 	ttp[j] = ir;
 }
 
-inline void Bimap::will_move(int i, int j)
+inline void Bimap::move(int i, int j)
 {
 #ifndef NO_CS_ASSERTS
-	assert(ttp.size() > i);
-	assert(ttp[i] >= 0);
+	assert(j <= i);
 #endif
 
-	if (ttp_next.size() <= j) {
-		ttp_next.resize(j + 1, -1);
+	if (i == j) return;
+
+	int r = bw(i);
+	if (ttp.size() <= j) {
+		ttp.resize(j + 1, -1);
+	}
+	ttp[j] = r;
+	if (r >= 0) {
+		ptt[r] = j;
+		ttp[i] = -1;
 	}
-	ttp_next[j] = ttp[i];
 }
 
-inline void Bimap::flip_buffer()
+inline void Bimap::remove(int i)
 {
-	ttp.swap(ttp_next);
-	ttp_next.clear();
-	ptt.clear();
-	for (int i = 0; i < ttp.size(); ++i) {
-		ptt[ttp[i]] = i;
+	if (bw(i) >= 0) {
+		drop(i);
+	}
+}
+
+inline void Bimap::truncate(int n)
+{
+	for (int i = n; i < ttp.size(); ++i) {
+		remove(i);
+	}
+	if (ttp.size() > n) {
+		ttp.resize(n);
 	}
 }
 
 inline int Bimap::fw(int j) const
 {
-	if (ptt.count(j) == 0) return -1;
-	return ptt.at(j);
+	if (j < 0 || ptt.size() <= j) return -1;
+	return ptt[j];
 }
 
 inline int Bimap::bw(int i) const
@@ -161,4 +208,96 @@ inline int Bimap::bw(int i) const
 	return ttp[i];
 }
 
+inline int Bimap::size() const
+{
+	return next_free_index;
+}
+
+inline int Bimap::dead() const
+{
+	return next_free_index - live;
+}
+
+inline std::vector<int> Bimap::compact()
+{
+	std::vector<int> remap(ptt.size(), -1);
+
+	int k = 0;
+	for (int j = 0; j < ptt.size(); ++j) {
+		if (ptt[j] < 0) continue;
+		remap[j] = k;
+		ptt[k] = ptt[j];
+		ttp[ptt[k]] = k;
+		if (k < marks.size()) {
+			marks[k] = (j < marks.size()) ? marks[j] : 0;
+		}
+		k++;
+	}
+	ptt.resize(k);
+	if (marks.size() > k) {
+		marks.resize(k);
+	}
+	next_free_index = k;
+
+	return remap;
+}
+
+inline void Bimap::assign(const std::vector<int>& bw, int n)
+{
+	next_free_index = n;
+	live = 0;
+	ptt.assign(n, -1);
+	ttp = bw;
+	marks.clear();
+	n_marked = 0;
+
+	for (int i = 0; i < ttp.size(); ++i) {
+		if (ttp[i] < 0) continue;
+#ifndef NO_CS_ASSERTS
+		assert(ttp[i] < n);
+		assert(ptt[ttp[i]] == -1);
+#endif
+		ptt[ttp[i]] = i;
+		live++;
+	}
+}
+
+inline void Bimap::mark(int j)
+{
+#ifndef NO_CS_ASSERTS
+	assert(fw(j) >= 0);
+#endif
+
+	if (marks.size() <= j) {
+		marks.resize(j + 1, 0);
+	}
+	if (!marks[j]) {
+		marks[j] = 1;
+		n_marked++;
+	}
+}
+
+inline void Bimap::unmark(int j)
+{
+	if (j < marks.size() && marks[j]) {
+		marks[j] = 0;
+		n_marked--;
+	}
+}
+
+inline bool Bimap::marked(int j) const
+{
+	return j >= 0 && j < marks.size() && marks[j];
+}
+
+inline int Bimap::nMarked() const
+{
+	return n_marked;
+}
+
+inline size_t Bimap::memoryUsage() const
+{
+	return (ptt.capacity() + ttp.capacity()) * sizeof(int) + marks.capacity();
+}
+
 #endif
@@ -0,0 +1,104 @@
+/***********************************************************************************[ClauseRing.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef ClauseRingH
+#define ClauseRingH
+
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+#include "minisat/core/SolverTypes.h"
+
+// Bounded queue of clauses, passed from one thread to another.
+//
+// The ring is lock-free, but only for a single producer and a single
+// consumer: exactly one thread may push(), and exactly one thread may pop().
+// A push to a full ring fails, and the clause is not recorded; the caller is
+// expected to count it as dropped.
+//
+// The slots are reused, so after warming up, no memory is allocated for
+// clauses shorter than the ones seen so far.
+class ClauseRing
+{
+public:
+	// Capacity is rounded up to the nearest power of two.
+	ClauseRing(size_t capacity=1024);
+
+	// Producer: add a clause. Returns false if the ring is full.
+	bool push(const Minisat::Lit* lits, int size);
+	bool push(const std::vector<Minisat::Lit>& lits);
+
+	// Consumer: remove the oldest clause, writing it to the argument. Returns
+	// false if the ring is empty.
+	bool pop(std::vector<Minisat::Lit>& lits);
+
+private:
+	size_t mask;
+	std::vector<std::vector<Minisat::Lit>> slots;
+
+	// Next slot to pop (written by the consumer only).
+	alignas(64) std::atomic<size_t> head;
+
+	// Next slot to push (written by the producer only).
+	alignas(64) std::atomic<size_t> tail;
+};
+
+// Implementation below
+
+inline ClauseRing::ClauseRing(size_t capacity) : head(0), tail(0)
+{
+	size_t n = 1;
+	while (n < capacity) n *= 2;
+
+	mask = n - 1;
+	slots.resize(n);
+}
+
+inline bool ClauseRing::push(const Minisat::Lit* lits, int size)
+{
+	const size_t t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) > mask) {
+		return false;
+	}
+
+	slots[t & mask].assign(lits, lits + size);
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+inline bool ClauseRing::push(const std::vector<Minisat::Lit>& lits)
+{
+	return push(lits.data(), lits.size());
+}
+
+inline bool ClauseRing::pop(std::vector<Minisat::Lit>& lits)
+{
+	const size_t h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	const auto& slot = slots[h & mask];
+	lits.assign(slot.begin(), slot.end());
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+#endif
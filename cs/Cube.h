@@ -20,15 +20,28 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef CubeH
 #define CubeH
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include "minisat/core/SolverTypes.h"
+#include "CubeKernels.h"
 using Minisat::Lit;
 
 // A conjunction of literals.
+//
+// Up to InlineSize literals are stored inside the object itself, so that the
+// short cubes built during cubification never touch the heap. Wider cubes
+// fall back to a std::vector. Cubes that are kept around for long are better
+// stored in a CubeArena.
+//
+// The set operations run on the kernels of CubeKernels.h.
 struct Cube
 {
+	static const size_t InlineSize = 8;
+
 	Cube();
 	Cube(std::initializer_list<Lit>);
+	Cube(const Lit* begin, const Lit* end);
     ~Cube();
 
 	size_t size() const;
@@ -52,6 +65,9 @@ struct Cube
 
     size_t hash() const;
 
+	// Hash of the literals [begin, end), as used by hash().
+	static size_t hash(const Lit* begin, const Lit* end);
+
 public:
 	// Populates v with the negation of this cube.
     void invert(Minisat::vec<Lit>& v) const;
@@ -60,48 +76,76 @@ public:
 	static Cube inverted(const Minisat::Clause& C);
 
 private:
-	// Literals in this clause. This is kept in sorted order.
-	std::vector<Lit> literals;
+	Lit* data();
+
+	// Number of literals in this cube.
+	uint32_t n;
+
+	// Literals in this cube, if there are at most InlineSize of them. This is
+	// kept in sorted order, and the unused slots hold lit_Undef.
+	Lit small[InlineSize];
+
+	// Literals in this cube, if there are more than InlineSize of them. This
+	// is kept in sorted order.
+	std::vector<Lit> large;
 };
 
-// specialization for std::hash
-inline size_t Cube::hash() const
+inline size_t Cube::hash(const Lit* begin, const Lit* end)
 {
     size_t x = 0;
-    for (auto L : literals) {
+    for (auto it = begin; it != end; ++it) {
         x = (x << 27) | (x >> (sizeof(size_t) * 8 - 19));
-		x ^= Minisat::toInt(L);
+		x ^= Minisat::toInt(*it);
     }
     return x;
 }
 
+inline size_t Cube::hash() const
+{
+	return hash(begin(), end());
+}
+
+// specialization for std::hash
 namespace std {
     template<> struct hash<Cube> {
         size_t operator()(const Cube& cube) const { return cube.hash(); }
     };
 }
 
-inline Cube::Cube()
+inline Cube::Cube() : n(0)
 {
+	std::fill(small, small + InlineSize, Minisat::lit_Undef);
 }
 
-inline Cube::Cube(std::initializer_list<Lit> il)
+inline Cube::Cube(std::initializer_list<Lit> il) : Cube()
 {
 	for (auto L : il) push(L);
 }
 
+inline Cube::Cube(const Lit* begin, const Lit* end) : Cube()
+{
+	for (auto it = begin; it != end; ++it) push(*it);
+}
+
 inline Cube::~Cube()
 {
 }
 
 inline size_t Cube::size() const
 {
-	return literals.size();
+	return n;
+}
+
+inline Lit* Cube::data()
+{
+	return (n <= InlineSize) ? small : large.data();
 }
 
 inline void Cube::clear()
 {
-    literals.clear();
+	std::fill(small, small + InlineSize, Minisat::lit_Undef);
+	large.clear();
+	n = 0;
 }
 
 inline void Cube::push(Lit L)
@@ -109,10 +153,21 @@ inline void Cube::push(Lit L)
     // If the literal is already contained, do nothing.
     if (contains(L)) return;
 
+	// Spill over to the heap, if the inline storage is full.
+	if (n < InlineSize) {
+		small[n] = L;
+	}
+	else {
+		if (n == InlineSize) {
+			large.assign(small, small + InlineSize);
+		}
+		large.push_back(L);
+	}
+	n++;
+
     // Bubble insert the literal.
-    const size_t N = literals.size();
-    literals.push_back(L);
-    for (size_t i = N; i > 0; --i)
+	Lit* literals = data();
+    for (size_t i = n - 1; i > 0; --i)
     {
         if (literals[i] < literals[i - 1]) {
             std::swap(literals[i-1], literals[i]);
@@ -126,18 +181,30 @@ inline void Cube::push(Lit L)
 inline void Cube::pop(Lit L)
 {
     size_t i = 0;
-    const size_t N = literals.size();
+	Lit* literals = data();
 
-    while (i < N)
+    while (i < n)
     {
         if (literals[i] == L)
         {
-            while (i < (N - 1))
+            while (i < (n - 1))
             {
                 literals[i] = literals[i + 1];
 				++i;
             }
-            literals.resize(N - 1);
+			n--;
+
+			// Move back to the inline storage, if the literals fit there.
+			if (n == InlineSize) {
+				std::copy(large.begin(), large.begin() + InlineSize, small);
+				large.clear();
+			}
+			else if (n > InlineSize) {
+				large.pop_back();
+			}
+			else {
+				small[n] = Minisat::lit_Undef;
+			}
             return;
         }
         ++i;
@@ -146,81 +213,75 @@ inline void Cube::pop(Lit L)
 
 inline bool Cube::operator==(const Cube& other) const
 {
-    return literals == other.literals;
+	if (n != other.n) return false;
+	if (n <= InlineSize) return CubeKernels::equal8(small, other.small);
+	return CubeKernels::wide.equal(large.data(), other.large.data(), n);
 }
 
 inline bool Cube::operator!=(const Cube& other) const
 {
-    return literals != other.literals;
+    return !(*this == other);
 }
 
 inline bool Cube::operator<(const Cube& other) const
 {
-	return literals < other.literals;
+	return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
 }
 
 inline Cube Cube::operator+(const Cube& other) const
 {
-    Cube ret;
-    ret.literals = literals;
-    for (size_t i = 0; i < other.literals.size(); ++i) {
-        ret.push(other.literals[i]);
+    Cube ret = *this;
+    for (auto L : other) {
+        ret.push(L);
     }
     return ret;
 }
 
 inline void Cube::invert(Minisat::vec<Lit>& clause) const
 {
-    for (size_t i = 0; i < literals.size(); ++i) {
-		clause.push(~literals[i]);
+    for (auto L : *this) {
+		clause.push(~L);
 	}
 }
 
-inline Lit Cube::operator[](size_t n) const
+inline Lit Cube::operator[](size_t i) const
 {
-    return literals[n];
+    return begin()[i];
 }
 
 inline const Lit* Cube::begin() const
 {
-    return literals.data();
+    return (n <= InlineSize) ? small : large.data();
 }
 
 inline const Lit* Cube::end() const
 {
-    return literals.data() + literals.size();
+    return begin() + n;
 }
 
 inline bool Cube::contains(const Minisat::Lit L) const
 {
-    for (size_t i = 0; i < literals.size(); ++i) {
-        if (L == literals[i]) return true;
-    }
-    return false;
+	if (n <= InlineSize) return CubeKernels::contains8(small, n, L);
+	return CubeKernels::wide.contains(large.data(), n, L);
 }
 
 inline bool Cube::subsetOf(const Cube& other) const
 {
-    for (size_t i = 0; i < literals.size(); ++i) {
-        if (!other.contains(literals[i])) {
-            return false;
-        }
-    }
-    return true;
+	if (other.n <= InlineSize) return CubeKernels::subsetOf8(begin(), n, other.small, other.n);
+	return CubeKernels::subsetOfSorted(begin(), n, other.begin(), other.n);
 }
 
 inline bool Cube::startsWith(const Cube& other) const
 {
     if (other.size() > size()) return false;
-    for (int i = 0; i < other.size(); ++i) {
-        if (other[i] != literals[i]) return false;
-    }
-    return true;
+	if (n <= InlineSize) return CubeKernels::prefix8(small, other.small, other.n);
+	return CubeKernels::wide.equal(begin(), other.begin(), other.n);
 }
 
 inline bool Cube::sane() const
 {
-    for (size_t i = 0; i < literals.size() - 1; ++i) {
+	const Lit* literals = begin();
+    for (size_t i = 0; i + 1 < n; ++i) {
 		auto A = literals[i];
 		auto B = literals[i + 1];
 		if (!(A < B)) return false;
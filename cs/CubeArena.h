@@ -0,0 +1,147 @@
+/************************************************************************************[CubeArena.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubeArenaH
+#define CubeArenaH
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "Cube.h"
+
+// Contiguous storage for the literals of many cubes.
+//
+// A cube interned here is referred to by an (offset, length) handle, which
+// costs no allocation of its own. Released cubes leave holes, which are only
+// reclaimed once the owner rebuilds the arena (interning the live cubes into
+// a fresh one); see shouldCompact().
+class CubeArena
+{
+public:
+	struct Ref
+	{
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	// Store the cube, returning its handle.
+	Ref intern(const Cube&);
+	Ref intern(const Lit* begin, const Lit* end);
+
+	// Mark the cube as no longer used.
+	void release(Ref);
+
+	// The literals of the cube, in cube order.
+	const Lit* begin(Ref) const;
+	const Lit* end(Ref) const;
+
+	// A copy of the cube.
+	Cube get(Ref) const;
+
+	// Does the handle refer to a cube equal to the given one?
+	bool equals(Ref, const Cube&) const;
+
+	// Number of literals stored, and the number of those that are released.
+	size_t size() const;
+	size_t wasted() const;
+
+	// Is enough of the arena released to make rebuilding it worthwhile?
+	bool shouldCompact() const;
+
+	// Bytes in use by the arena.
+	size_t memoryUsage() const;
+
+	void clear();
+
+private:
+	std::vector<Lit> lits;
+	size_t released = 0;
+};
+
+// Implementation below
+
+inline CubeArena::Ref CubeArena::intern(const Cube& cube)
+{
+	return intern(cube.begin(), cube.end());
+}
+
+inline CubeArena::Ref CubeArena::intern(const Lit* begin, const Lit* end)
+{
+	Ref ref = { (uint32_t)lits.size(), (uint32_t)(end - begin) };
+	lits.insert(lits.end(), begin, end);
+	return ref;
+}
+
+inline void CubeArena::release(Ref ref)
+{
+#ifndef NO_CS_ASSERTS
+	assert(ref.offset + ref.size <= lits.size());
+#endif
+
+	released += ref.size;
+}
+
+inline const Lit* CubeArena::begin(Ref ref) const
+{
+	return lits.data() + ref.offset;
+}
+
+inline const Lit* CubeArena::end(Ref ref) const
+{
+	return lits.data() + ref.offset + ref.size;
+}
+
+inline Cube CubeArena::get(Ref ref) const
+{
+	return Cube(begin(ref), end(ref));
+}
+
+inline bool CubeArena::equals(Ref ref, const Cube& cube) const
+{
+	return (ref.size == cube.size()) && std::equal(cube.begin(), cube.end(), begin(ref));
+}
+
+inline size_t CubeArena::size() const
+{
+	return lits.size();
+}
+
+inline size_t CubeArena::wasted() const
+{
+	return released;
+}
+
+inline bool CubeArena::shouldCompact() const
+{
+	return (released >= 4096) && (2 * released >= lits.size());
+}
+
+inline size_t CubeArena::memoryUsage() const
+{
+	return lits.capacity() * sizeof(Lit);
+}
+
+inline void CubeArena::clear()
+{
+	lits.clear();
+	released = 0;
+}
+
+#endif
@@ -0,0 +1,144 @@
+/**********************************************************************************[CubeBarrier.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubeBarrierH
+#define CubeBarrierH
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Synchronisation point between the master and the cube workers, for the
+// deterministic mode (see CubifyingSolverBase::deterministic).
+//
+// Each worker runs for a fixed number of conflicts, then arrives and waits.
+// Once every worker still running has arrived, the master may exchange
+// clauses with them, and then releases them for the next epoch. A worker
+// that finishes its run leaves instead of arriving.
+class CubeBarrier
+{
+public:
+	// Master: begin a run of n workers.
+	void start(int n);
+
+	// Worker: wait for the master at the end of an epoch. Returns false if
+	// the worker is to stop.
+	bool arrive();
+
+	// Worker: the run is over; the worker no longer takes part.
+	void leave();
+
+	// Master: wait until every worker still running has arrived. Returns
+	// false if none is left.
+	bool wait();
+
+	// Master: let the workers that arrived go on, or stop them.
+	void release(bool stop);
+
+private:
+	std::mutex mutex;
+	std::condition_variable cv;
+	int running = 0;
+	int arrived = 0;
+	uint64_t epoch = 0;
+	bool stopping = false;
+};
+
+// Wakes the master when a cube worker has exported clauses or finished its
+// run, in the default mode, so that the master relays the clauses as they
+// come instead of polling for them.
+class CubeSignal
+{
+public:
+	// Worker: there is something for the master.
+	void notify();
+
+	// Master: wait until notified since the last wait, or for at most the
+	// given time.
+	void wait(std::chrono::milliseconds timeout);
+
+private:
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool notified = false;
+};
+
+// Implementation below
+
+inline void CubeBarrier::start(int n)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	running = n;
+	arrived = 0;
+	stopping = false;
+}
+
+inline bool CubeBarrier::arrive()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	const uint64_t e = epoch;
+	if (++arrived == running) {
+		cv.notify_all();
+	}
+	cv.wait(lock, [this, e]() { return epoch != e; });
+	return !stopping;
+}
+
+inline void CubeBarrier::leave()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (--running == arrived) {
+		cv.notify_all();
+	}
+}
+
+inline bool CubeBarrier::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	cv.wait(lock, [this]() { return arrived == running; });
+	return running > 0;
+}
+
+inline void CubeBarrier::release(bool stop)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stopping = stop;
+	arrived = 0;
+	epoch++;
+	cv.notify_all();
+}
+
+inline void CubeSignal::notify()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		notified = true;
+	}
+	cv.notify_one();
+}
+
+inline void CubeSignal::wait(std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	cv.wait_for(lock, timeout, [this]() { return notified; });
+	notified = false;
+}
+
+#endif
@@ -0,0 +1,588 @@
+/*********************************************************************************[CubeConquer.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "CubeConquer.h"
+
+namespace Minisat
+{
+namespace
+{
+double wallTime()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+int toDimacs(Lit L)
+{
+	return sign(L) ? -(var(L) + 1) : (var(L) + 1);
+}
+
+Lit fromDimacs(int x)
+{
+	return (x > 0) ? mkLit(x - 1) : ~mkLit(-x - 1);
+}
+
+void appendLits(std::string& line, const Cube& cube)
+{
+	for (auto L : cube) {
+		line += ' ';
+		line += std::to_string(toDimacs(L));
+	}
+	line += " 0";
+}
+
+// Read literals up to the terminating 0. Returns false if the list is cut
+// short or refers to unknown variables.
+bool readLits(std::istringstream& in, int nVars, std::vector<Lit>& lits)
+{
+	lits.clear();
+	int x;
+	while (in >> x) {
+		if (x == 0) return true;
+		if (abs(x) > nVars) return false;
+		lits.push_back(fromDimacs(x));
+	}
+	return false;
+}
+}
+
+CubeCoordinator::CubeCoordinator(CubifyingSolver& S, int port, int initialCubes, int budget)
+	: S(S)
+	, port(port)
+	, initialCubes(initialCubes)
+	, budget(budget)
+{
+}
+
+CubeClient::CubeClient(CubifyingSolver& S, const std::string& address)
+	: S(S)
+	, address(address)
+{
+}
+
+#ifndef _WIN32
+
+//=================================================================================================
+// LineSocket
+
+LineSocket::LineSocket(int fd) : socket(fd)
+{
+}
+
+LineSocket::~LineSocket()
+{
+	close(socket);
+}
+
+int LineSocket::fd() const
+{
+	return socket;
+}
+
+bool LineSocket::send(const std::string& text)
+{
+	size_t done = 0;
+	while (done < text.size()) {
+		ssize_t n = ::send(socket, text.data() + done, text.size() - done, MSG_NOSIGNAL);
+		if (n <= 0) return false;
+		done += n;
+	}
+	return true;
+}
+
+bool LineSocket::receive()
+{
+	char chunk[65536];
+	ssize_t n = recv(socket, chunk, sizeof(chunk), 0);
+	if (n <= 0) return false;
+
+	input.append(chunk, n);
+	return true;
+}
+
+bool LineSocket::nextLine(std::string& line)
+{
+	size_t end = input.find('\n');
+	if (end == std::string::npos) return false;
+
+	line.assign(input, 0, end);
+	input.erase(0, end + 1);
+	return true;
+}
+
+bool LineSocket::readLine(std::string& line)
+{
+	while (!nextLine(line)) {
+		if (!receive()) return false;
+	}
+	return true;
+}
+
+bool LineSocket::readBytes(size_t n, std::string& bytes)
+{
+	while (input.size() < n) {
+		if (!receive()) return false;
+	}
+	bytes.assign(input, 0, n);
+	input.erase(0, n);
+	return true;
+}
+
+//=================================================================================================
+// CubeCoordinator
+
+lbool CubeCoordinator::run()
+{
+	// The workers only read and simplify the problem; cubification changes
+	// it further (but only adds implied clauses).
+	problem = S.problemHash();
+
+	std::vector<Cube> leaves;
+	lbool status;
+	if (!S.cubifyAndSplit(initialCubes, leaves, status)) {
+		return status;
+	}
+
+	// The root is the whole search space; the leaves are its children.
+	addNode(Cube(), -1);
+	for (const auto& leaf : leaves) {
+		pending.push_back(addNode(leaf, 0));
+	}
+	nodes[0].split = true;
+	nodes[0].open = leaves.size();
+
+	int server = ::socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+	setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (server < 0 || bind(server, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(server, 64) != 0) {
+		printf("ERROR! Could not listen on port %d\n", port);
+		exit(1);
+	}
+
+	if (S.verbosity > 0) {
+		printf("Serving %d cubes on port %d\n", (int)leaves.size(), port);
+	}
+
+	std::vector<pollfd> fds;
+	while (result == l_Undef && !S.outOfBudget()) {
+		fds.assign(1, { server, POLLIN, 0 });
+		for (auto& w : workers) {
+			fds.push_back({ w.socket->fd(), POLLIN, 0 });
+		}
+		if (poll(fds.data(), fds.size(), 1000) < 0) continue;
+
+		// The workers that were polled are the first ones; new connections
+		// are added after them.
+		const size_t polled = workers.size();
+		if (fds[0].revents & POLLIN) {
+			int fd = accept(server, NULL, NULL);
+			if (fd >= 0) {
+				workers.emplace_back();
+				workers.back().socket.reset(new LineSocket(fd));
+			}
+		}
+
+		for (size_t k = 0; k < polled && result == l_Undef; ++k) {
+			auto& w = workers[k];
+			if (!(fds[k + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+			bool alive = w.socket->receive();
+			std::string line;
+			while (alive && result == l_Undef && w.socket->nextLine(line)) {
+				alive = handle(w, line);
+			}
+			if (!alive) disconnect(w);
+		}
+
+		// Sending a cube may find a worker gone as well.
+		if (result == l_Undef) dispatch();
+
+		// Forget the workers that have disconnected.
+		size_t j = 0;
+		for (size_t k = 0; k < workers.size(); ++k) {
+			if (workers[k].socket) {
+				if (j != k) workers[j] = std::move(workers[k]);
+				j++;
+			}
+		}
+		workers.resize(j);
+	}
+
+	const char* done = (result == l_True) ? "DONE SAT\n" : (result == l_False) ? "DONE UNSAT\n" : "DONE UNKNOWN\n";
+	for (auto& w : workers) {
+		w.socket->send(done);
+	}
+	workers.clear();
+	::close(server);
+
+	return result;
+}
+
+int CubeCoordinator::addNode(const Cube& cube, int parent)
+{
+	nodes.emplace_back();
+	nodes.back().cube = cube;
+	nodes.back().parent = parent;
+	return nodes.size() - 1;
+}
+
+bool CubeCoordinator::isClosed(int n) const
+{
+	for (; n >= 0; n = nodes[n].parent) {
+		if (nodes[n].closed) return true;
+	}
+	return false;
+}
+
+bool CubeCoordinator::refute(int n)
+{
+	while (!nodes[n].closed) {
+		nodes[n].closed = true;
+
+		const int p = nodes[n].parent;
+		if (p < 0) return false;
+		if (--nodes[p].open > 0) break;
+		n = p;
+	}
+	return true;
+}
+
+void CubeCoordinator::split(int n, Lit L)
+{
+	Cube first = nodes[n].cube;
+	Cube second = nodes[n].cube;
+	first.push(L);
+	second.push(~L);
+
+	nodes[n].split = true;
+	nodes[n].open = 2;
+
+	// Depth first, so that the cubes in flight stay few.
+	const int b = addNode(second, n);
+	const int a = addNode(first, n);
+	pending.push_front(b);
+	pending.push_front(a);
+}
+
+void CubeCoordinator::dispatch()
+{
+	for (auto& w : workers) {
+		if (!w.greeted || !w.idle) continue;
+
+		// Skip the cubes that have been refuted or split meanwhile.
+		while (!pending.empty() && (nodes[pending.front()].split || isClosed(pending.front()))) {
+			pending.pop_front();
+		}
+
+		// Steal: split the cube that has been searched for the longest.
+		if (pending.empty()) {
+			int victim = -1;
+			for (size_t n = 0; n < nodes.size(); ++n) {
+				const auto& node = nodes[n];
+				if (node.runners == 0 || node.split || isClosed(n)) continue;
+				if (victim < 0 || node.started < nodes[victim].started) victim = n;
+			}
+			if (victim < 0) return;
+
+			Lit L = S.pickSplitLiteral(nodes[victim].cube);
+			if (L == lit_Undef) return;
+			split(victim, L);
+		}
+
+		const int n = pending.front();
+		pending.pop_front();
+
+		std::string text;
+		for (; w.learnt < learnt.size(); ++w.learnt) {
+			text += learnt[w.learnt];
+		}
+		text += "CUBE " + std::to_string(n) + " " + std::to_string(budget);
+		appendLits(text, nodes[n].cube);
+		text += '\n';
+
+		if (nodes[n].runners++ == 0) nodes[n].started = wallTime();
+		w.node = n;
+		w.idle = false;
+
+		if (!w.socket->send(text)) disconnect(w);
+	}
+}
+
+bool CubeCoordinator::handle(Worker& w, const std::string& line)
+{
+	std::istringstream in(line);
+	std::string command;
+	in >> command;
+
+	if (command == "HELLO") {
+		unsigned long long hash = 0;
+		in >> hash;
+		if (hash != problem) {
+			w.socket->send("BYE\n");
+			return false;
+		}
+		w.greeted = true;
+		return w.socket->send("OK\n");
+	}
+	if (!w.greeted) return false;
+
+	if (command == "GET") {
+		w.idle = true;
+		return true;
+	}
+
+	// The rest are reports on the cube of the worker.
+	int n = -1;
+	in >> n;
+	if (n < 0 || n != w.node) return false;
+	nodes[n].runners--;
+	w.node = -1;
+
+	std::vector<Lit> lits;
+	if (command == "SAT") {
+		if (!readLits(in, S.nVars(), lits)) return false;
+
+		S.model.clear();
+		S.model.growTo(S.nVars(), l_Undef);
+		for (auto L : lits) {
+			S.model[var(L)] = lbool(!sign(L));
+		}
+		result = l_True;
+	}
+	else if (command == "UNSAT") {
+		if (!readLits(in, S.nVars(), lits)) return false;
+		if (lits.empty()) {
+			result = l_False;
+			return true;
+		}
+
+		// Pass the negation of the reduced cube on to every worker.
+		Cube reduced;
+		std::string text = "LEARN";
+		for (auto L : lits) {
+			reduced.push(L);
+			text += ' ';
+			text += std::to_string(toDimacs(~L));
+		}
+		learnt.push_back(text + " 0\n");
+
+		if (!refute(n)) result = l_False;
+
+		// Any other cube that contains the reduced cube is refuted as well.
+		for (size_t m = 0; m < nodes.size() && result == l_Undef; ++m) {
+			if (nodes[m].split || isClosed(m) || !reduced.subsetOf(nodes[m].cube)) continue;
+			if (!refute(m)) result = l_False;
+		}
+	}
+	else if (command == "SPLIT") {
+		int x = 0;
+		in >> x;
+		if (abs(x) > S.nVars()) return false;
+		if (nodes[n].split || isClosed(n)) return true;
+
+		Lit L = (x == 0) ? lit_Undef : fromDimacs(x);
+		if (L == lit_Undef || nodes[n].cube.contains(L) || nodes[n].cube.contains(~L)) {
+			// Nothing to split on; try again later.
+			if (nodes[n].runners == 0) pending.push_back(n);
+		}
+		else {
+			split(n, L);
+		}
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+void CubeCoordinator::disconnect(Worker& w)
+{
+	// Someone else has to search the cube.
+	if (w.node >= 0) {
+		const int n = w.node;
+		if (--nodes[n].runners == 0 && !nodes[n].split && !isClosed(n)) {
+			pending.push_front(n);
+		}
+		w.node = -1;
+	}
+	w.socket.reset();
+	w.greeted = false;
+	w.idle = false;
+}
+
+//=================================================================================================
+// CubeClient
+
+lbool CubeClient::run()
+{
+	size_t colon = address.rfind(':');
+	if (colon == std::string::npos) {
+		printf("ERROR! Expected host:port, got: %s\n", address.c_str());
+		exit(1);
+	}
+	const std::string host = address.substr(0, colon);
+	const std::string service = address.substr(colon + 1);
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* found = nullptr;
+	int fd = -1;
+	if (getaddrinfo(host.c_str(), service.c_str(), &hints, &found) == 0) {
+		for (addrinfo* a = found; a != nullptr && fd < 0; a = a->ai_next) {
+			fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+			if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+				close(fd);
+				fd = -1;
+			}
+		}
+		freeaddrinfo(found);
+	}
+	if (fd < 0) {
+		printf("ERROR! Could not connect to %s\n", address.c_str());
+		exit(1);
+	}
+
+	LineSocket socket(fd);
+	std::string line;
+	if (!socket.send("HELLO " + std::to_string((unsigned long long)S.problemHash()) + "\n")
+		|| !socket.readLine(line) || line != "OK") {
+		printf("ERROR! The coordinator at %s has a different problem\n", address.c_str());
+		exit(1);
+	}
+
+	std::vector<Lit> lits;
+	vec<Lit> clause;
+	vec<Lit> assumps;
+	while (socket.send("GET\n")) {
+		// Take the new clauses, up to the next cube.
+		for (;;) {
+			if (!socket.readLine(line)) return l_Undef;
+
+			std::istringstream in(line);
+			std::string command;
+			in >> command;
+
+			if (command == "DONE") {
+				std::string status;
+				in >> status;
+				if (status == "UNSAT") return l_False;
+				if (status == "SAT" && foundModel) return l_True;
+				return l_Undef;
+			}
+			else if (command == "LEARN") {
+				if (!readLits(in, S.nVars(), lits)) return l_Undef;
+				clause.clear();
+				for (auto L : lits) clause.push(L);
+				S.addClause(clause);
+			}
+			else if (command == "CUBE") {
+				int n, conflicts;
+				in >> n >> conflicts;
+				if (!readLits(in, S.nVars(), lits)) return l_Undef;
+
+				Cube cube;
+				assumps.clear();
+				for (auto L : lits) {
+					cube.push(L);
+					assumps.push(L);
+				}
+
+				S.setConfBudget(conflicts);
+				lbool status = S.solveLimited(assumps);
+				S.budgetOff();
+
+				std::string report;
+				if (status == l_True) {
+					foundModel = true;
+					report = "SAT " + std::to_string(n);
+					for (int v = 0; v < S.model.size(); ++v) {
+						if (S.model[v] == l_Undef) continue;
+						report += ' ';
+						report += std::to_string((S.model[v] == l_True) ? v + 1 : -(v + 1));
+					}
+					report += " 0";
+				}
+				else if (status == l_False) {
+					Cube reduced;
+					for (int k = 0; k < S.conflict.size(); ++k) {
+						reduced.push(~S.conflict[k]);
+					}
+					report = "UNSAT " + std::to_string(n);
+					appendLits(report, reduced);
+				}
+				else if (S.outOfBudget()) {
+					// Interrupted.
+					return l_Undef;
+				}
+				else {
+					Lit L = S.pickSplitLiteral(cube);
+					report = "SPLIT " + std::to_string(n) + " " + std::to_string((L == lit_Undef) ? 0 : toDimacs(L));
+				}
+
+				if (!socket.send(report + "\n")) return l_Undef;
+				break;
+			}
+			else {
+				return l_Undef;
+			}
+		}
+	}
+	return l_Undef;
+}
+
+#else
+
+LineSocket::~LineSocket()
+{
+}
+
+lbool CubeCoordinator::run()
+{
+	printf("ERROR! Distributed solving is not supported on this platform\n");
+	exit(1);
+}
+
+lbool CubeClient::run()
+{
+	printf("ERROR! Distributed solving is not supported on this platform\n");
+	exit(1);
+}
+
+#endif
+
+} // namespace Minisat
@@ -0,0 +1,201 @@
+/**********************************************************************************[CubeConquer.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubeConquerH
+#define CubeConquerH
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CubifyingSolver.h"
+#include "Cube.h"
+
+namespace Minisat
+{
+// Distributed cube-and-conquer over TCP.
+//
+// The coordinator and the workers are all minisat_cubing processes that
+// read the same problem with the same options, so that they agree on the
+// simplified problem (this is checked with CubifyingSolver::problemHash()).
+// The coordinator cubifies, splits the search space into cubes (as in
+// -emit-cubes), and hands the cubes out. Each worker searches under one cube
+// at a time, for a limited number of conflicts, and reports back:
+//   - SAT, with a model: the problem is solved;
+//   - UNSAT, with the reduced cube (the assumptions in the final conflict):
+//     the negation of the reduced cube is sent to every worker as a clause;
+//   - timed out, with a literal to split on: the cube is replaced by the two
+//     halves.
+// A worker that asks for work while there is none steals: the coordinator
+// splits the outstanding cube that has run the longest, and hands out one
+// of the halves. The problem is UNSAT once every cube is refuted, either by
+// itself or by both of its halves.
+//
+// The protocol is line-based text; literals are in DIMACS form, and lists of
+// literals end with 0.
+//   worker: HELLO <hash>            coordinator: OK | BYE
+//   worker: GET                     coordinator: LEARN <lits> 0 (any number)
+//                                                CUBE <id> <budget> <lits> 0
+//                                              | DONE SAT | DONE UNSAT
+//   worker: SAT <id> <model> 0
+//   worker: UNSAT <id> <reduced> 0
+//   worker: SPLIT <id> <lit>
+//
+// Only available on POSIX systems.
+
+// A connected socket, with buffered line input.
+class LineSocket
+{
+public:
+	explicit LineSocket(int fd);
+	~LineSocket();
+
+	LineSocket(const LineSocket&) = delete;
+	LineSocket& operator=(const LineSocket&) = delete;
+
+	int fd() const;
+
+	// Send all of the text. Returns false if the connection is lost.
+	bool send(const std::string&);
+
+	// Read what is available (blocking until something is). Returns false
+	// if the connection is closed.
+	bool receive();
+
+	// Take the next complete line out of the buffer, if there is one.
+	bool nextLine(std::string&);
+
+	// Read until there is a complete line. Returns false if the connection
+	// is closed first.
+	bool readLine(std::string&);
+
+	// Read exactly n bytes (after the lines taken so far). Returns false if
+	// the connection is closed first.
+	bool readBytes(size_t n, std::string&);
+
+private:
+	int socket;
+	std::string input;
+};
+
+// The coordinator side: serves the cubes to workers on a TCP port.
+class CubeCoordinator
+{
+public:
+	CubeCoordinator(CubifyingSolver& S, int port, int initialCubes, int budget);
+
+	// Split the problem, then serve the cubes until the problem is solved or
+	// the solver is interrupted. On SAT, the model from the worker is left in
+	// S.model.
+	lbool run();
+
+protected:
+	// A part of the search space.
+	struct Node
+	{
+		Cube cube;
+		int parent;
+
+		// Children that have not been refuted yet.
+		int open = 0;
+
+		bool split = false;
+		bool closed = false;
+
+		// Workers searching under the cube, and when the first one started.
+		int runners = 0;
+		double started = 0.0;
+	};
+
+	struct Worker
+	{
+		std::unique_ptr<LineSocket> socket;
+		bool greeted = false;
+		bool idle = false;
+
+		// The node being searched, or -1.
+		int node = -1;
+
+		// Clauses not yet sent to this worker.
+		size_t learnt = 0;
+	};
+
+	int addNode(const Cube&, int parent);
+
+	// Has the node, or any node above it, been refuted?
+	bool isClosed(int n) const;
+
+	// Mark the node as refuted, and its parent too, if it was the last open
+	// child. Returns false once the root is refuted.
+	bool refute(int n);
+
+	// Replace the node with its two halves, split on L.
+	void split(int n, Lit L);
+
+	// Give work to the idle workers, stealing if needed.
+	void dispatch();
+
+	// Handle one line from worker w. Returns false if the connection is to
+	// be dropped.
+	bool handle(Worker& w, const std::string& line);
+
+	void disconnect(Worker& w);
+
+	CubifyingSolver& S;
+
+	// Fingerprint of the problem, before cubification.
+	uint64_t problem = 0;
+
+	int port;
+	int initialCubes;
+	int budget;
+
+	std::vector<Node> nodes;
+	std::deque<int> pending;
+	std::vector<Worker> workers;
+
+	// Negations of reduced cubes, as LEARN lines.
+	std::vector<std::string> learnt;
+
+	lbool result = l_Undef;
+};
+
+// The worker side: connects to a coordinator, and searches under the cubes
+// it receives.
+class CubeClient
+{
+public:
+	// The address is like "host:port".
+	CubeClient(CubifyingSolver& S, const std::string& address);
+
+	// Work until the coordinator is done. Returns the result that the
+	// coordinator reports, except that a worker only reports SAT if it found
+	// the model itself.
+	lbool run();
+
+protected:
+	CubifyingSolver& S;
+	std::string address;
+	bool foundModel = false;
+};
+
+} // namespace Minisat
+
+#endif
@@ -20,86 +20,169 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef CubeIndexH
 #define CubeIndexH
 
-#include <unordered_map>
-#include <unordered_set>
-#include <memory>
+#include <vector>
 
 #include "Cube.h"
+#include "CubeArena.h"
+#include "CubeTable.h"
 
 // Intended as a compact and fast set implementation for cubes.
+//
+// The cubes are interned in a CubeArena, and looked up by the hash of the
+// full (sorted) cube through a flat CubeTable. The table only keeps a 32-bit
+// fingerprint of each hash, so a matching fingerprint is verified against the
+// literals in the arena.
 class CubeIndex
 {
 public:
     CubeIndex();
 
-	// Add/remove a cube to the set. Callers from outside should ignore the
-	// depth argument.
-	void push(const Cube&, size_t depth=0);
-	void pop(const Cube&, size_t depth=0);
+	// Add/remove a cube to the set. The cube must not be empty.
+	void push(const Cube&);
+	void pop(const Cube&);
 
-	bool contains(const Cube&, size_t depth=0) const;
+	bool contains(const Cube&) const;
+
+	// Number of cubes in the set.
+	size_t size() const;
+
+	// Bytes in use by the set.
+	size_t memoryUsage() const;
+
+	// Rebuild the set to release the memory held by popped cubes.
+	void shrink();
+
+	// The cubes in the set, in no particular order.
+	void dump(std::vector<Cube>&) const;
+
+protected:
+	// Returns the id of the cube, or -1 if it is not in the set.
+	int find(const Cube&) const;
+
+	// Rebuild the arena, if enough of it is taken up by popped cubes.
+	void maybeCompact();
 
 protected:
-	// Child marks (if the mark is true, that cube exists).
-    std::unique_ptr<std::unordered_set<int>> marks;
+	// Literals of the cubes.
+	CubeArena arena;
+
+	// Cubes by id. Popped ids have an empty cube, and are recycled through
+	// freeIds.
+	std::vector<CubeArena::Ref> cubes;
+	std::vector<int> freeIds;
 
-	// Child cube indices.
-    std::unique_ptr<std::unordered_map<int, CubeIndex>> children;
+	// Map like: cube -> id
+	CubeTable ids;
 };
 
 // IMPLEMENTATION
 
 inline CubeIndex::CubeIndex()
 {
-    marks.reset(new std::unordered_set<int>());
-    children.reset(new std::unordered_map<int, CubeIndex>());
 }
 
-inline void CubeIndex::push(const Cube& cube, size_t depth)
+inline void CubeIndex::push(const Cube& cube)
 {
 #ifndef NO_CS_ASSERTS
-	assert(depth < cube.size());
+	assert(cube.size() > 0);
 #endif
 
-	auto x = cube[depth].x;
-	if (cube.size() == (depth + 1)) {
-		marks->insert(x);
+	if (find(cube) >= 0) return;
+
+	int id;
+	if (freeIds.empty()) {
+		id = cubes.size();
+		cubes.emplace_back();
 	}
 	else {
-		(*children)[x].push(cube, depth + 1);
+		id = freeIds.back();
+		freeIds.pop_back();
 	}
+
+	cubes[id] = arena.intern(cube);
+	ids.insert(cube.hash(), id);
 }
 
-inline void CubeIndex::pop(const Cube& cube, size_t depth)
+inline void CubeIndex::pop(const Cube& cube)
 {
 #ifndef NO_CS_ASSERTS
-	assert(depth < cube.size());
+	assert(cube.size() > 0);
 #endif
 
-	auto x = cube[depth].x;
-	if (cube.size() == (depth + 1)) {
-		marks->erase(x);
-	}
-	else {
-		(*children)[x].pop(cube, depth + 1);
-	}
+	int id = ids.erase(cube.hash(), [&](int j) { return arena.equals(cubes[j], cube); });
+	if (id < 0) return;
+
+	arena.release(cubes[id]);
+	cubes[id] = { 0, 0 };
+	freeIds.push_back(id);
+
+	maybeCompact();
 }
 
-inline bool CubeIndex::contains(const Cube& cube, size_t depth) const
+inline bool CubeIndex::contains(const Cube& cube) const
 {
 #ifndef NO_CS_ASSERTS
-	assert(depth < cube.size());
+	assert(cube.size() > 0);
 #endif
 
-	auto x = cube[depth].x;
-	if (cube.size() == (depth + 1)) {
-		return marks->count(x) > 0;
+	return find(cube) >= 0;
+}
+
+inline size_t CubeIndex::size() const
+{
+	return ids.size();
+}
+
+inline size_t CubeIndex::memoryUsage() const
+{
+	return arena.memoryUsage()
+		+ ids.memoryUsage()
+		+ cubes.capacity() * sizeof(CubeArena::Ref)
+		+ freeIds.capacity() * sizeof(int);
+}
+
+inline void CubeIndex::shrink()
+{
+	std::vector<CubeArena::Ref> freshCubes;
+	freshCubes.reserve(size());
+	CubeArena freshArena;
+	CubeTable freshIds;
+	for (const auto& ref : cubes) {
+		if (ref.size == 0) continue;
+
+		const Cube cube = arena.get(ref);
+		freshIds.insert(cube.hash(), freshCubes.size());
+		freshCubes.push_back(freshArena.intern(cube));
 	}
-	else {
-		auto it = children->find(x);
-		if (it == children->end()) return false;
-		return it->second.contains(cube, depth + 1);
+
+	cubes.swap(freshCubes);
+	freeIds = std::vector<int>();
+	arena = std::move(freshArena);
+	ids = std::move(freshIds);
+}
+
+inline void CubeIndex::dump(std::vector<Cube>& out) const
+{
+	for (const auto& ref : cubes) {
+		if (ref.size > 0) out.push_back(arena.get(ref));
+	}
+}
+
+inline int CubeIndex::find(const Cube& cube) const
+{
+	return ids.find(cube.hash(), [&](int j) { return arena.equals(cubes[j], cube); });
+}
+
+inline void CubeIndex::maybeCompact()
+{
+	if (!arena.shouldCompact()) return;
+
+	CubeArena fresh;
+	for (auto& ref : cubes) {
+		if (ref.size == 0) continue;
+		ref = fresh.intern(arena.begin(ref), arena.end(ref));
 	}
+	arena = std::move(fresh);
 }
 
 #endif
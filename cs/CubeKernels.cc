@@ -0,0 +1,111 @@
+/*********************************************************************************[CubeKernels.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include "CubeKernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CS_CUBE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace CubeKernels
+{
+bool Scalar::contains(const Lit* a, size_t n, Lit L)
+{
+	for (size_t i = 0; i < n; ++i) {
+		if (a[i] == L) return true;
+	}
+	return false;
+}
+
+bool Scalar::equal(const Lit* a, const Lit* b, size_t n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		if (a[i] != b[i]) return false;
+	}
+	return true;
+}
+
+bool Scalar::subsetOf(const Lit* a, size_t n, const Lit* b, size_t m)
+{
+	for (size_t i = 0; i < n; ++i) {
+		if (!contains(b, m, a[i])) return false;
+	}
+	return true;
+}
+
+bool subsetOfSorted(const Lit* a, size_t n, const Lit* b, size_t m)
+{
+	size_t j = 0;
+	for (size_t i = 0; i < n; ++i) {
+		while (j < m && b[j] < a[i]) ++j;
+		if (j == m || b[j] != a[i]) return false;
+		++j;
+	}
+	return true;
+}
+
+#ifdef CS_CUBE_AVX2
+namespace
+{
+__attribute__((target("avx2")))
+bool containsAvx2(const Lit* a, size_t n, Lit L)
+{
+	const __m256i x = _mm256_set1_epi32(Minisat::toInt(L));
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(v, x)) != 0) return true;
+	}
+	return Scalar::contains(a + i, n - i, L);
+}
+
+__attribute__((target("avx2")))
+bool equalAvx2(const Lit* a, const Lit* b, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		__m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(v, w)) != ~0u) return false;
+	}
+	return Scalar::equal(a + i, b + i, n - i);
+}
+}
+#endif
+
+Wide wide = { Scalar::contains, Scalar::equal };
+
+bool select(bool avx2)
+{
+	wide = { Scalar::contains, Scalar::equal };
+#ifdef CS_CUBE_AVX2
+	if (avx2 && __builtin_cpu_supports("avx2")) {
+		wide = { containsAvx2, equalAvx2 };
+		return true;
+	}
+#endif
+	return false;
+}
+
+namespace
+{
+const bool selected = select(true);
+}
+}
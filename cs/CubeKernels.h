@@ -0,0 +1,151 @@
+/**********************************************************************************[CubeKernels.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubeKernelsH
+#define CubeKernelsH
+
+#include <cstddef>
+#include <cstdint>
+#include "minisat/core/SolverTypes.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CS_CUBE_SSE2
+#include <emmintrin.h>
+#endif
+
+// The set operations of Cube, on sorted arrays of literals.
+//
+// Cubes of up to eight literals keep them in eight inline slots, padded with
+// lit_Undef, so the kernels for those (the "8" ones) compare all the slots
+// at once. SSE2 is part of x86-64, so these are compiled in directly. Wider
+// cubes go through kernels picked at startup: AVX2 where the CPU has it,
+// otherwise the portable ones. The portable kernels of namespace Scalar are
+// the reference that the others must agree with.
+namespace CubeKernels
+{
+using Minisat::Lit;
+
+namespace Scalar
+{
+bool contains(const Lit* a, size_t n, Lit L);
+bool equal(const Lit* a, const Lit* b, size_t n);
+bool subsetOf(const Lit* a, size_t n, const Lit* b, size_t m);
+}
+
+// Is every literal of a among those of b? Both must be sorted; one pass over
+// each, instead of Scalar::subsetOf(), which scans b for each literal of a.
+bool subsetOfSorted(const Lit* a, size_t n, const Lit* b, size_t m);
+
+// Kernels for cubes wider than eight literals; set by select().
+struct Wide
+{
+	bool (*contains)(const Lit* a, size_t n, Lit L);
+	bool (*equal)(const Lit* a, const Lit* b, size_t n);
+};
+extern Wide wide;
+
+// Use the AVX2 kernels if allowed and supported, the portable ones
+// otherwise. Runs at startup with avx2 = true. Returns whether AVX2 is used.
+bool select(bool avx2);
+
+// Is L among the first n of the slots a[0..7]?
+bool contains8(const Lit* a, size_t n, Lit L);
+
+// Are the slots a[0..7] and b[0..7] the same?
+bool equal8(const Lit* a, const Lit* b);
+
+// Are the first n of the slots a[0..7] the same as those of b[0..7]?
+bool prefix8(const Lit* a, const Lit* b, size_t n);
+
+// Is every one of the first n slots of a among the first m slots of b?
+bool subsetOf8(const Lit* a, size_t n, const Lit* b, size_t m);
+
+// Implementation below
+
+#ifdef CS_CUBE_SSE2
+// One bit per byte of the slots a[0..7] equal to x.
+inline uint32_t match8(const Lit* a, __m128i x)
+{
+	const __m128i* p = reinterpret_cast<const __m128i*>(a);
+	uint32_t lo = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128(p), x));
+	uint32_t hi = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128(p + 1), x));
+	return lo | (hi << 16);
+}
+
+// One bit per byte of the slots where a[0..7] and b[0..7] agree.
+inline uint32_t agree8(const Lit* a, const Lit* b)
+{
+	const __m128i* p = reinterpret_cast<const __m128i*>(a);
+	const __m128i* q = reinterpret_cast<const __m128i*>(b);
+	uint32_t lo = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128(p), _mm_loadu_si128(q)));
+	uint32_t hi = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128(p + 1), _mm_loadu_si128(q + 1)));
+	return lo | (hi << 16);
+}
+
+// The bytes of the first n slots.
+inline uint32_t slots8(size_t n)
+{
+	return (n >= 8) ? ~0u : (1u << (4 * n)) - 1;
+}
+#endif
+
+inline bool contains8(const Lit* a, size_t n, Lit L)
+{
+#ifdef CS_CUBE_SSE2
+	return (match8(a, _mm_set1_epi32(Minisat::toInt(L))) & slots8(n)) != 0;
+#else
+	return Scalar::contains(a, n, L);
+#endif
+}
+
+inline bool equal8(const Lit* a, const Lit* b)
+{
+#ifdef CS_CUBE_SSE2
+	return agree8(a, b) == ~0u;
+#else
+	return Scalar::equal(a, b, 8);
+#endif
+}
+
+inline bool prefix8(const Lit* a, const Lit* b, size_t n)
+{
+#ifdef CS_CUBE_SSE2
+	const uint32_t mask = slots8(n);
+	return (agree8(a, b) & mask) == mask;
+#else
+	return Scalar::equal(a, b, n);
+#endif
+}
+
+inline bool subsetOf8(const Lit* a, size_t n, const Lit* b, size_t m)
+{
+#ifdef CS_CUBE_SSE2
+	if (n > m) return false;
+	const uint32_t mask = slots8(m);
+	for (size_t i = 0; i < n; ++i) {
+		if ((match8(b, _mm_set1_epi32(Minisat::toInt(a[i]))) & mask) == 0) return false;
+	}
+	return true;
+#else
+	return Scalar::subsetOf(a, n, b, m);
+#endif
+}
+}
+
+#endif
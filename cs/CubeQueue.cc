@@ -20,20 +20,40 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <algorithm>
 #include "CubeQueue.h"
 
-CubeQueue::CubeQueue(size_t budget) : budget(budget)
+CubeQueue::CubeQueue(size_t budget) :
+	budget(budget),
+	best(BestFirst{ &entries }),
+	worst(WorstFirst{ &entries })
 {
 }
 
 void CubeQueue::push(const Cube& cube, double score, int i)
 {
     if (!contains(cube)) {
-        if ((implicants.size() + 1) >= budget) {
-            auto back = peekWorst();
-            pop(back);
+        if ((ids.size() + 1) >= budget) {
+            pop(peekWorst());
         }
 
-        implicants[cube] = { score, { i } };
-        scorewise[score].push_back(cube);
+		int id;
+		if (freeIds.empty()) {
+			id = entries.size();
+			entries.emplace_back();
+		}
+		else {
+			id = freeIds.back();
+			freeIds.pop_back();
+		}
+
+		Entry& e = entries[id];
+		e.cube = arena.intern(cube);
+		e.score = score;
+		e.seq = nextSeq++;
+		e.epoch = epoch;
+		e.parents.assign(1, i);
+		parentCount++;
+
+		ids.insert(cube.hash(), id);
+		link(id);
 
         sumScore += score;
         numSeen += 1.0;
@@ -49,41 +69,115 @@ void CubeQueue::pop(const Cube& cube)
 	assert(contains(cube));
 #endif
 
-	double score = implicants[cube].first;
-	auto& vec = scorewise[score];
-	if (vec.size() == 1) {
-		scorewise.erase(score);
-	}
-	else {
-		auto it = std::find(vec.begin(), vec.end(), cube);
-		vec.erase(it);
-	}
-	implicants.erase(cube);
+	int id = ids.erase(cube.hash(), [&](int j) { return arena.equals(entries[j].cube, cube); });
+
+	unlink(id);
+	arena.release(entries[id].cube);
+	parentCount -= entries[id].parents.size();
+	entries[id].parents.clear();
+	freeIds.push_back(id);
+
+	maybeCompact();
+}
+
+void CubeQueue::update(const Cube& cube, double score)
+{
+	int id = idOf(cube);
+	unlink(id);
+	entries[id].score = score;
+	entries[id].seq = nextSeq++;
+	entries[id].epoch = epoch;
+	link(id);
+}
+
+void CubeQueue::setEpoch(uint64_t e)
+{
+	epoch = e;
+}
+
+uint64_t CubeQueue::epochOf(const Cube& cube) const
+{
+	return entries[idOf(cube)].epoch;
+}
+
+double CubeQueue::scoreOf(const Cube& cube) const
+{
+	return entries[idOf(cube)].score;
 }
 
 const Cube CubeQueue::peekBest(int r) const
 {
-	auto it = scorewise.rbegin();
-	const auto& vec = it->second;
-    if (vec.size() == 1) return vec[0];
-    else return vec[r % vec.size()];
+	int top = best[0];
+	double score = entries[top].score;
+
+	// Gather the ids that share the best score. In the heap, these form a
+	// subtree at the root.
+	ties.clear();
+	stack.assign(1, 0);
+	while (!stack.empty()) {
+		int k = stack.back();
+		stack.pop_back();
+
+		int id = best[k];
+		if (entries[id].score != score) continue;
+
+		ties.push_back(id);
+		if (2 * k + 1 < best.size()) stack.push_back(2 * k + 1);
+		if (2 * k + 2 < best.size()) stack.push_back(2 * k + 2);
+	}
+
+    if (ties.size() == 1) return arena.get(entries[top].cube);
+
+	std::nth_element(ties.begin(), ties.begin() + (r % ties.size()), ties.end(),
+		[this](int a, int b) { return entries[a].seq < entries[b].seq; });
+	return arena.get(entries[ties[r % ties.size()]].cube);
 }
 
 const Cube CubeQueue::peekWorst() const
 {
-	auto it = scorewise.begin();
-	const auto& vec = it->second;
-	return vec.front();
+	return arena.get(entries[worst[0]].cube);
+}
+
+void CubeQueue::peekBest(std::vector<Cube>& out, size_t n, double minScore) const
+{
+	if (empty()) return;
+
+	// Best-first walk of the heap: the frontier holds heap positions whose
+	// parents have already been output.
+	BestFirst lt = { &entries };
+	auto later = [&](int a, int b) { return lt(best[b], best[a]); };
+
+	std::vector<int> frontier = { 0 };
+	while (n > 0 && !frontier.empty()) {
+		std::pop_heap(frontier.begin(), frontier.end(), later);
+		int k = frontier.back();
+		frontier.pop_back();
+
+		const Entry& e = entries[best[k]];
+		if (e.score < minScore) break;
+
+		out.push_back(arena.get(e.cube));
+		n--;
+
+		if (2 * k + 1 < best.size()) {
+			frontier.push_back(2 * k + 1);
+			std::push_heap(frontier.begin(), frontier.end(), later);
+		}
+		if (2 * k + 2 < best.size()) {
+			frontier.push_back(2 * k + 2);
+			std::push_heap(frontier.begin(), frontier.end(), later);
+		}
+	}
 }
 
 bool CubeQueue::contains(const Cube& cube) const
 {
-	return implicants.find(cube) != implicants.end();
+	return find(cube) >= 0;
 }
 
 void CubeQueue::addParentInd(const Cube& cube, int i)
 {
-	auto& v = implicants.at(cube).second;
+	auto& v = entries[idOf(cube)].parents;
 
 	for (auto j : v) {
 		if (j == i) {
@@ -92,30 +186,173 @@ void CubeQueue::addParentInd(const Cube& cube, int i)
 	}
 
 	v.push_back(i);
+	parentCount++;
 }
 
 std::vector<int> CubeQueue::getParentInds(const Cube& cube) const
 {
-	return implicants.at(cube).second;
+	return entries[idOf(cube)].parents;
+}
+
+void CubeQueue::remapParentInds(const std::vector<int>& remap)
+{
+	parentCount = 0;
+	for (auto& e : entries) {
+		size_t k = 0;
+		for (auto j : e.parents) {
+			int r = (j >= 0 && j < remap.size()) ? remap[j] : -1;
+			if (r >= 0) e.parents[k++] = r;
+		}
+		e.parents.resize(k);
+		parentCount += k;
+	}
 }
 
 bool CubeQueue::empty() const
 {
-	return implicants.size() == 0;
+	return ids.size() == 0;
 }
 
 size_t CubeQueue::size() const
 {
-	return implicants.size();
+	return ids.size();
 }
 
 double CubeQueue::bestScore() const
 {
 	if (empty()) return 0.0;
-	else return scorewise.rbegin()->first;
+	else return entries[best[0]].score;
 }
 
 double CubeQueue::meanScore() const
 {
 	return sumScore / numSeen;
 }
+
+void CubeQueue::getSeen(double& sum, double& n) const
+{
+	sum = sumScore;
+	n = numSeen;
+}
+
+void CubeQueue::setSeen(double sum, double n)
+{
+	sumScore = sum;
+	numSeen = n;
+}
+
+size_t CubeQueue::memoryUsage() const
+{
+	return arena.memoryUsage()
+		+ ids.memoryUsage()
+		+ entries.capacity() * sizeof(Entry)
+		+ freeIds.capacity() * sizeof(int)
+		+ parentCount * sizeof(int)
+		+ 4 * entries.capacity() * sizeof(int);
+}
+
+void CubeQueue::evictWorst(size_t n)
+{
+	for (; n > 0 && !empty(); --n) {
+		pop(peekWorst());
+	}
+}
+
+void CubeQueue::shrink()
+{
+	// Move the live entries over to fresh storage, under dense ids.
+	std::vector<Entry> fresh;
+	fresh.reserve(size());
+	CubeArena freshArena;
+	CubeTable freshIds;
+	for (int k = 0; k < best.size(); ++k) {
+		Entry& e = entries[best[k]];
+		const Cube cube = arena.get(e.cube);
+
+		freshIds.insert(cube.hash(), fresh.size());
+		fresh.push_back(std::move(e));
+		fresh.back().cube = freshArena.intern(cube);
+		fresh.back().parents.shrink_to_fit();
+	}
+
+	best.clear(true);
+	worst.clear(true);
+	entries.swap(fresh);
+	freeIds = std::vector<int>();
+	arena = std::move(freshArena);
+	ids = std::move(freshIds);
+
+	for (int id = 0; id < entries.size(); ++id) {
+		link(id);
+	}
+}
+
+void CubeQueue::dump(std::vector<Cube>& cubes, std::vector<double>& scores,
+                     std::vector<std::vector<int>>& parents) const
+{
+	std::vector<int> order;
+	order.reserve(best.size());
+	for (int k = 0; k < best.size(); ++k) {
+		order.push_back(best[k]);
+	}
+	std::sort(order.begin(), order.end(), [&](int a, int b) { return entries[a].seq < entries[b].seq; });
+
+	for (auto id : order) {
+		const Entry& e = entries[id];
+		cubes.push_back(arena.get(e.cube));
+		scores.push_back(e.score);
+		parents.push_back(e.parents);
+	}
+}
+
+int CubeQueue::find(const Cube& cube) const
+{
+	return ids.find(cube.hash(), [&](int j) { return arena.equals(entries[j].cube, cube); });
+}
+
+int CubeQueue::idOf(const Cube& cube) const
+{
+	int id = find(cube);
+#ifndef NO_CS_ASSERTS
+	assert(id >= 0);
+#endif
+	return id;
+}
+
+void CubeQueue::maybeCompact()
+{
+	if (!arena.shouldCompact()) return;
+
+	// The free ids are exactly the ones without a cube.
+	std::vector<bool> dead(entries.size(), false);
+	for (auto id : freeIds) {
+		dead[id] = true;
+	}
+
+	CubeArena fresh;
+	for (int id = 0; id < entries.size(); ++id) {
+		if (dead[id]) continue;
+		auto& ref = entries[id].cube;
+		ref = fresh.intern(arena.begin(ref), arena.end(ref));
+	}
+	arena = std::move(fresh);
+}
+
+void CubeQueue::link(int id)
+{
+	best.insert(id);
+	worst.insert(id);
+}
+
+void CubeQueue::unlink(int id)
+{
+	// Heap::remove() moves the last element into the hole, but only sifts it
+	// down; it may also need to go up.
+	int lastBest = best[best.size() - 1];
+	best.remove(id);
+	if (lastBest != id) best.decrease(lastBest);
+
+	int lastWorst = worst[worst.size() - 1];
+	worst.remove(id);
+	if (lastWorst != id) worst.decrease(lastWorst);
+}
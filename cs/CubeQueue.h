@@ -20,11 +20,12 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef CubeQueueH
 #define CubeQueueH
 
-#include <map>
 #include <vector>
-#include <unordered_map>
 
+#include "minisat/mtl/Heap.h"
 #include "Cube.h"
+#include "CubeArena.h"
+#include "CubeTable.h"
 
 // A queue of cubes under which we can search.
 //
@@ -36,23 +37,56 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 // known to be subsumed by the negation of the cube. In other words, if the
 // cube gets refuted, any clauses in clause_ids that still exist can be
 // dropped and replaced with one count of the negation of the cube.
+//
+// Internally, each cube gets a dense id (reused once the cube is popped),
+// and the ids are kept in two heaps: one with the best cube on top, and one
+// with the worst. Among cubes of equal score, the one pushed earlier comes
+// first in both. Pushing, popping, evicting the worst cube and changing the
+// score of a cube all take O(log n) time.
+//
+// The cubes themselves are interned in a CubeArena, and looked up through a
+// CubeTable, so that a queued cube costs no allocation of its own.
 class CubeQueue
 {
 public:
 	CubeQueue(size_t cubeBudget=1000000);
 
+	// The heaps refer back to the entries, so the queue stays put.
+	CubeQueue(const CubeQueue&) = delete;
+	CubeQueue& operator=(const CubeQueue&) = delete;
+
 	// Register a cube with the given score.
 	void push(const Cube& cube, double score, int i);
 
 	// Remove the given cube from the queue.
 	void pop(const Cube&);
 
-	// Returns the best cube in the queue.
+	// Change the score of a cube in the queue. The cube is then ordered as if
+	// it had just been pushed, and its score is stamped with the current
+	// epoch.
+	void update(const Cube&, double score);
+
+	// The epoch that scores are stamped with when they are pushed or
+	// updated. Epochs are defined by the user; they are expected to grow.
+	void setEpoch(uint64_t);
+
+	// The epoch of the score of a cube in the queue.
+	uint64_t epochOf(const Cube&) const;
+
+	// The score of a cube in the queue.
+	double scoreOf(const Cube&) const;
+
+	// Returns the best cube in the queue. If several cubes share the best
+	// score, rnd picks one of them (in the order they were pushed).
 	const Cube peekBest(int rnd=0) const;
 
-	// Returns the best cube in the queue.
+	// Returns the worst cube in the queue.
 	const Cube peekWorst() const;
 
+	// Append up to n of the best cubes to out, in order of descending score.
+	// Only cubes with a score of at least minScore are considered.
+	void peekBest(std::vector<Cube>& out, size_t n, double minScore) const;
+
 	// Is the given cube recorded here, as a conflict?
 	bool contains(const Cube&) const;
 
@@ -60,6 +94,10 @@ public:
 	void addParentInd(const Cube&, int i);
 	std::vector<int> getParentInds(const Cube&) const;
 
+	// Renumber the parent indices after Bimap::compact(), dropping the ones
+	// that map to -1.
+	void remapParentInds(const std::vector<int>& remap);
+
 	// Is the queue empty?
 	bool empty() const;
 
@@ -72,16 +110,111 @@ public:
 	// Mean score seen so far.
 	double meanScore() const;
 
+	// Sum and number of the scores seen so far (see meanScore()), e.g. to
+	// carry them over from an earlier run.
+	void getSeen(double& sum, double& n) const;
+	void setSeen(double sum, double n);
+
+	// Bytes in use by the queue (the heaps are estimated).
+	size_t memoryUsage() const;
+
+	// Remove the n worst cubes from the queue.
+	void evictWorst(size_t n);
+
+	// Rebuild the queue to release the memory held by popped cubes.
+	void shrink();
+
+	// Append the cubes in the queue to cubes, in the order they were pushed,
+	// along with their scores and parent indices.
+	void dump(std::vector<Cube>& cubes, std::vector<double>& scores,
+	          std::vector<std::vector<int>>& parents) const;
+
+protected:
+	struct Entry
+	{
+		CubeArena::Ref cube;
+		double score;
+
+		// Push order, for breaking ties between equal scores.
+		uint64_t seq;
+
+		// Epoch of the score (see setEpoch()).
+		uint64_t epoch;
+
+		// Persistent indices of the parent clauses.
+		std::vector<int> parents;
+	};
+
+	// Orders ids by descending score, then by ascending push order.
+	struct BestFirst
+	{
+		const std::vector<Entry>* entries;
+		bool operator()(int a, int b) const;
+	};
+
+	// Orders ids by ascending score, then by ascending push order.
+	struct WorstFirst
+	{
+		const std::vector<Entry>* entries;
+		bool operator()(int a, int b) const;
+	};
+
+	// Returns the id of the cube, or -1 if it is not in the queue.
+	int find(const Cube&) const;
+
+	// Returns the id of the cube, which must be in the queue.
+	int idOf(const Cube&) const;
+
+	// Rebuild the arena, if enough of it is taken up by popped cubes.
+	void maybeCompact();
+
+	// Insert the id into both heaps, or remove it from both.
+	void link(int id);
+	void unlink(int id);
+
 protected:
     size_t budget;
 	double sumScore = 0.0;
 	double numSeen = 0.0;
+	uint64_t nextSeq = 0;
+	uint64_t epoch = 0;
+
+	// Number of parent indices over all entries.
+	size_t parentCount = 0;
 
-	// Map like: cubeScore -> [cubes...]
-	std::map<double, std::vector<Cube>> scorewise;
+	// Cube data, by id. Popped ids are recycled through freeIds.
+	std::vector<Entry> entries;
+	std::vector<int> freeIds;
 
-	// Map like: cube -> (cubeScore, persistentParentIndex)
-	std::unordered_map<Cube, std::pair<double, std::vector<int>>> implicants;
+	// Literals of the cubes in the entries.
+	CubeArena arena;
+
+	// Map like: cube -> id
+	CubeTable ids;
+
+	// Heaps of ids: best on top, and worst on top.
+	Minisat::Heap<int, BestFirst> best;
+	Minisat::Heap<int, WorstFirst> worst;
+
+	// Scratch space for peekBest(), kept between calls.
+	mutable std::vector<int> ties;
+	mutable std::vector<int> stack;
 };
 
+// Implementation below
+
+inline bool CubeQueue::BestFirst::operator()(int a, int b) const
+{
+	const Entry& x = (*entries)[a];
+	const Entry& y = (*entries)[b];
+	return (x.score > y.score) || ((x.score == y.score) && (x.seq < y.seq));
+}
+
+inline bool CubeQueue::WorstFirst::operator()(int a, int b) const
+{
+	const Entry& x = (*entries)[a];
+	const Entry& y = (*entries)[b];
+	return (x.score < y.score) || ((x.score == y.score) && (x.seq < y.seq));
+}
+
 #endif
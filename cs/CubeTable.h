@@ -0,0 +1,188 @@
+/************************************************************************************[CubeTable.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubeTableH
+#define CubeTableH
+
+#include <cstdint>
+#include <vector>
+
+// Open-addressing hash table from cubes to non-negative integer ids.
+//
+// The table stores only the ids and the hashes of the cubes; the cubes
+// themselves live elsewhere (e.g. in a CubeArena). Hence, lookups take the
+// hash of the cube and a predicate telling whether a given id refers to the
+// cube being looked up.
+//
+// Uses linear probing, with tombstones for erased entries. The table is
+// grown (and the tombstones purged) once it is 70 % full.
+class CubeTable
+{
+public:
+	CubeTable();
+
+	// Find the id of the cube with the given hash, for which same(id) holds.
+	// Returns -1 if there is no such cube.
+	template<class Same>
+	int find(size_t hash, Same same) const;
+
+	// Record an id for a cube that is not in the table yet.
+	void insert(size_t hash, int id);
+
+	// Remove the cube, as in find(). Returns the id that was removed, or -1.
+	template<class Same>
+	int erase(size_t hash, Same same);
+
+	// Number of ids in the table.
+	size_t size() const;
+
+	// Bytes in use by the table.
+	size_t memoryUsage() const;
+
+	void clear();
+
+private:
+	static const int32_t Empty = -1;
+	static const int32_t Erased = -2;
+
+	struct Slot
+	{
+		uint32_t hash;
+		int32_t id;
+	};
+
+	// Spreads the bits of a cube hash, so that it may be masked.
+	static uint32_t mix(size_t hash);
+
+	void grow();
+
+	std::vector<Slot> slots;
+	size_t mask;
+	size_t count = 0;
+	size_t used = 0;
+};
+
+// Implementation below
+
+inline CubeTable::CubeTable()
+{
+	slots.assign(16, { 0, Empty });
+	mask = slots.size() - 1;
+}
+
+inline uint32_t CubeTable::mix(size_t hash)
+{
+	uint64_t x = hash;
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return (uint32_t)x;
+}
+
+template<class Same>
+inline int CubeTable::find(size_t hash, Same same) const
+{
+	const uint32_t h = mix(hash);
+	for (size_t i = h & mask; ; i = (i + 1) & mask) {
+		const Slot& slot = slots[i];
+		if (slot.id == Empty) return -1;
+		if (slot.id >= 0 && slot.hash == h && same(slot.id)) return slot.id;
+	}
+}
+
+inline void CubeTable::insert(size_t hash, int id)
+{
+	if (10 * (used + 1) > 7 * slots.size()) {
+		grow();
+	}
+
+	const uint32_t h = mix(hash);
+	for (size_t i = h & mask; ; i = (i + 1) & mask) {
+		Slot& slot = slots[i];
+		if (slot.id < 0) {
+			if (slot.id == Empty) used++;
+			slot = { h, (int32_t)id };
+			count++;
+			return;
+		}
+	}
+}
+
+template<class Same>
+inline int CubeTable::erase(size_t hash, Same same)
+{
+	const uint32_t h = mix(hash);
+	for (size_t i = h & mask; ; i = (i + 1) & mask) {
+		Slot& slot = slots[i];
+		if (slot.id == Empty) return -1;
+		if (slot.id >= 0 && slot.hash == h && same(slot.id)) {
+			int id = slot.id;
+			slot.id = Erased;
+			count--;
+			return id;
+		}
+	}
+}
+
+inline size_t CubeTable::size() const
+{
+	return count;
+}
+
+inline size_t CubeTable::memoryUsage() const
+{
+	return slots.capacity() * sizeof(Slot);
+}
+
+inline void CubeTable::clear()
+{
+	slots.assign(16, { 0, Empty });
+	mask = slots.size() - 1;
+	count = 0;
+	used = 0;
+}
+
+inline void CubeTable::grow()
+{
+	// Only double the size if the table is full of live ids; otherwise,
+	// getting rid of the tombstones is enough.
+	size_t n = slots.size();
+	if (10 * (count + 1) > 5 * n) {
+		n *= 2;
+	}
+
+	std::vector<Slot> old(n, { 0, Empty });
+	old.swap(slots);
+	mask = n - 1;
+	used = count;
+
+	for (const auto& slot : old) {
+		if (slot.id < 0) continue;
+		for (size_t i = slot.hash & mask; ; i = (i + 1) & mask) {
+			if (slots[i].id == Empty) {
+				slots[i] = slot;
+				break;
+			}
+		}
+	}
+}
+
+#endif
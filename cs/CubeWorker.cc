@@ -0,0 +1,234 @@
+/**********************************************************************************[CubeWorker.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "CubeWorker.h"
+
+namespace Minisat
+{
+namespace
+{
+double wallTime()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+}
+
+CubeWorker::CubeWorker(int id) : id(id), status(l_Undef), finished(false)
+{
+	verbosity = 0;
+
+	// Make the workers diverge a little from each other.
+	random_seed += id + 1;
+}
+
+CubeWorker::~CubeWorker()
+{
+}
+
+void CubeWorker::load(const Solver& master)
+{
+#ifndef NO_CS_ASSERTS
+	assert(master.decisionLevel() == 0);
+	assert(nVars() == 0);
+#endif
+
+	// Variables and level-0 units come first, so that the clauses are
+	// simplified as they are added.
+	sync(master, {});
+
+	vec<Lit> lits;
+	for (int i = 0; i < master.clauses.size() && ok; ++i) {
+		const Clause& c = master.ca[master.clauses[i]];
+		if (c.mark() == 1) continue;
+
+		lits.clear();
+		for (int k = 0; k < c.size(); ++k) {
+			lits.push(c[k]);
+		}
+		addClause_(lits);
+	}
+
+	// Same learnt clause schedule as in Solver::solve_().
+	max_learnts = std::max(nClauses() * learntsize_factor, (double)min_learnts_lim);
+	learntsize_adjust_confl = learntsize_adjust_start_confl;
+	learntsize_adjust_cnt = (int)learntsize_adjust_confl;
+}
+
+void CubeWorker::sync(const Solver& master, const std::vector<std::vector<Lit>>& clauses)
+{
+#ifndef NO_CS_ASSERTS
+	assert(master.decisionLevel() == 0);
+	assert(decisionLevel() == 0);
+#endif
+
+	// Decision flags are only ever switched on here. The master switches them
+	// off for eliminated variables, but the worker may still have clauses
+	// that contain those, so it has to keep deciding them.
+	growVars(master);
+	for (Var v = 0; v < nVars(); ++v) {
+		if (master.decision[v] && !decision[v]) {
+			setDecisionVar(v, true);
+		}
+	}
+
+	// The master trail only shrinks if released variables are removed from
+	// it; in that case, start over (re-adding a unit is harmless).
+	if (master.trail.size() < syncedTrail) {
+		syncedTrail = 0;
+	}
+	for (; syncedTrail < master.trail.size() && ok; ++syncedTrail) {
+		addClause(master.trail[syncedTrail]);
+	}
+
+	vec<Lit> lits;
+	for (const auto& clause : clauses) {
+		if (!ok) break;
+
+		lits.clear();
+		for (auto L : clause) {
+			lits.push(L);
+		}
+		addClause_(lits);
+	}
+}
+
+void CubeWorker::run(const Cube& cube, int budget)
+{
+	reduced.clear();
+	model.clear();
+	conflict.clear();
+
+	uint64_t conflicts0 = conflicts;
+	const double time0 = wallTime();
+	int nextBarrier = epoch;
+
+	importClauses();
+	status = ok ? l_Undef : l_False;
+
+	if (ok) {
+		for (auto it = cube.begin(); it != cube.end(); ++it) {
+			assumptions.push(*it);
+		}
+
+		// Same restart schedule as in Solver::solve_(), but cut short by the
+		// budget given, and by the barriers.
+		while (status == l_Undef) {
+			int used = conflicts - conflicts0;
+			if (used >= budget || !withinBudget()) break;
+
+			if (barrier && used >= nextBarrier) {
+				const double wait0 = wallTime();
+				const bool go = barrier->arrive();
+				barrierTime += wallTime() - wait0;
+				if (!go) break;
+
+				nextBarrier = used + epoch;
+				importClauses();
+				if (!ok) status = l_False;
+				continue;
+			}
+
+			double base = luby_restart ? luby(restart_inc, restarts) : pow(restart_inc, restarts);
+			int length = std::min((int)(base * restart_first), budget - used);
+			if (barrier) length = std::min(length, nextBarrier - used);
+			restarts++;
+
+			status = search(length);
+			if (status == l_Undef) {
+				importClauses();
+				if (!ok) status = l_False;
+			}
+		}
+
+		if (status == l_True) {
+			model.growTo(nVars());
+			for (int i = 0; i < nVars(); i++) model[i] = value(i);
+		}
+		else if (status == l_False) {
+			for (int i = 0; i < conflict.size(); ++i) {
+				reduced.push(~conflict[i]);
+			}
+			if (reduced.size() == 0) {
+				ok = false;
+			}
+		}
+
+		cancelUntil(0);
+		assumptions.clear();
+	}
+
+	conflictsUsed = conflicts - conflicts0;
+	runTime += wallTime() - time0;
+	finished = true;
+	if (barrier) barrier->leave();
+	if (signal) signal->notify();
+}
+
+void CubeWorker::importClauses()
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	vec<Lit> lits;
+	while (inbox.pop(importBuffer)) {
+		if (!ok) continue;
+
+		lits.clear();
+		for (auto L : importBuffer) {
+			lits.push(L);
+		}
+		addLearnt_(lits);
+		clausesImported++;
+	}
+}
+
+void CubeWorker::onLearnt(const vec<Lit>& learnt)
+{
+	bool share = learnt.size() <= maxExportSize;
+
+	if (!share && maxExportLbd > 0) {
+		// The levels of the literals are still recorded at this point, even
+		// though the solver has already backtracked.
+		share = computeLBD(learnt, maxExportLbd) <= maxExportLbd;
+	}
+
+	if (share) {
+		if (outbox.push(&learnt[0], learnt.size())) {
+			clausesExported++;
+			if (signal) signal->notify();
+		}
+		else {
+			clausesDropped++;
+		}
+	}
+}
+
+void CubeWorker::growVars(const Solver& master)
+{
+	while (nVars() < master.nVars()) {
+		newVar(l_Undef, master.decision[nVars()]);
+	}
+}
+
+} // namespace Minisat
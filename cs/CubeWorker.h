@@ -0,0 +1,143 @@
+/***********************************************************************************[CubeWorker.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubeWorkerH
+#define CubeWorkerH
+
+#include <vector>
+
+#include "minisat/core/Solver.h"
+#include "ClauseRing.h"
+#include "CubeBarrier.h"
+#include "Cube.h"
+
+namespace Minisat
+{
+// A solver that searches cube branches on behalf of a master solver, on a
+// thread of its own.
+//
+// The worker holds a private copy of the problem clauses and level-0
+// assignment of the master (see load() and sync()). Any clause set obtained
+// this way is equivalent to the one in the master, since the master only
+// ever replaces clauses by implied ones. Thus:
+//   - a model found by the worker is a model for the master;
+//   - a conflict found by the worker is a conflict for the master.
+//
+// A worker never touches the master; the master reads the results after
+// the thread running run() has finished.
+//
+// While running, short learnt clauses are exported through the outbox ring,
+// and clauses learnt by the other workers arrive through the inbox ring.
+// These are drained at every restart, i.e. while at decision level 0.
+//
+// With a barrier, the worker also stops every epoch conflicts and waits for
+// the master, which only relays clauses then. The clauses a worker sees
+// then no longer depend on the timing of the threads.
+class CubeWorker : public Solver
+{
+public:
+	CubeWorker(int id);
+	~CubeWorker();
+
+	// Copy the problem clauses, decision flags and level-0 units of the
+	// master. The master must be at decision level 0.
+	void load(const Solver& master);
+
+	// Bring the worker up to date with the master: add new variables and
+	// level-0 units, as well as the given clauses (which must be implied by
+	// the problem clauses of the master).
+	void sync(const Solver& master, const std::vector<std::vector<Lit>>& clauses);
+
+	// Search under the cube for at most budget conflicts, restarting as
+	// usual. The outcome is written to the result fields below. Sets the
+	// finished flag when done.
+	void run(const Cube& cube, int budget);
+
+	// Add the clauses waiting in the inbox. Only valid at decision level 0.
+	void importClauses();
+
+public:
+	// Index of this worker.
+	const int id;
+
+	// Learnt clauses of at most this size, or of at most this LBD, are
+	// exported to the master.
+	int maxExportSize = 2;
+	int maxExportLbd = 2;
+
+	// If set, run() waits here after every epoch conflicts (see
+	// CubeBarrier). Set by the master.
+	CubeBarrier* barrier = nullptr;
+	int epoch = 1000;
+
+	// If set, notified whenever a clause is exported and when run() is
+	// done. Set by the master.
+	CubeSignal* signal = nullptr;
+
+	// Clauses passed to the master (written by the worker only).
+	ClauseRing outbox;
+
+	// Clauses passed from the master (written by the master only).
+	ClauseRing inbox;
+
+	// Result: l_True if a model was found (see Solver::model), l_False if the
+	// cube was refuted, l_Undef otherwise.
+	lbool status;
+
+	// Result: the subcube of the searched cube that caused the refutation.
+	// Empty, if the problem as a whole is unsatisfiable.
+	Cube reduced;
+
+	// Result: how many conflicts the run took.
+	uint64_t conflictsUsed = 0;
+
+	// Set once run() has written its results. Cleared by the master.
+	std::atomic<bool> finished;
+
+	// Counters: how many clauses have been exported, imported from the
+	// inbox, or dropped due to the outbox being full?
+	uint64_t clausesExported = 0;
+	uint64_t clausesImported = 0;
+	uint64_t clausesDropped = 0;
+
+	// Counters: seconds spent in run(), and waiting at the barrier.
+	double runTime = 0.0;
+	double barrierTime = 0.0;
+
+protected:
+	// Exports learnt clauses that are short enough, or have a low enough LBD.
+	virtual void onLearnt(const vec<Lit>& learnt) override;
+
+	// Add missing variables, so that the worker has as many as the master.
+	void growVars(const Solver& master);
+
+protected:
+	// How much of the master's level-0 trail has been copied over.
+	int syncedTrail = 0;
+
+	// Restarts made so far, over all runs.
+	int restarts = 0;
+
+	// Scratch space for importing.
+	std::vector<Lit> importBuffer;
+};
+
+} // namespace Minisat
+
+#endif
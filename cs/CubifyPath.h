@@ -0,0 +1,82 @@
+/***********************************************************************************[CubifyPath.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubifyPathH
+#define CubifyPathH
+
+#include <cstdint>
+
+// Cubification paths of root cubes of width W, planned at compile time.
+//
+// The path of CubifyingSolver::makeCubifyPath() only depends on the width of
+// the root cube and on which of its terminals (the root minus one literal)
+// already have a score. makeCubifyPathDifficultyOrder() places the literals
+// of those terminals in front, so the known terminals are always the first
+// k. The plan for each k is a sequence of steps: a step s >= 0 means "push
+// the literal at index s", and CubifyCancel means "pop one level".
+const int8_t CubifyCancel = -1;
+
+template<int W>
+struct CubifyPlan
+{
+	// Upper bound on the number of steps: W - 1 pushes to move the prefix
+	// along, W(W - 1) / 2 pushes and as many pops to reach the terminals.
+	static const int Capacity = W * W - 1;
+
+	int8_t step[Capacity] {};
+	int size = 0;
+};
+
+// Plans for k = 0, ..., W known terminals.
+template<int W>
+struct CubifyPlans
+{
+	CubifyPlan<W> plan[W + 1] {};
+};
+
+template<int W>
+constexpr CubifyPlans<W> makeCubifyPlans()
+{
+	CubifyPlans<W> t {};
+	for (int k = 0; k <= W; ++k) {
+		CubifyPlan<W>& p = t.plan[k];
+
+		// As in makeCubifyPath(): between the terminals, the cube is the
+		// prefix [0, n) of the root.
+		int n = 0;
+		for (int i = k; i < W; ++i) {
+			for (int j = n; j < i; ++j) p.step[p.size++] = j;
+			for (int j = i + 1; j < W; ++j) p.step[p.size++] = j;
+			for (int j = i + 1; j < W; ++j) p.step[p.size++] = CubifyCancel;
+			n = i;
+		}
+	}
+	return t;
+}
+
+template<int W>
+struct CubifyPath
+{
+	static constexpr CubifyPlans<W> plans = makeCubifyPlans<W>();
+};
+
+template<int W>
+constexpr CubifyPlans<W> CubifyPath<W>::plans;
+
+#endif
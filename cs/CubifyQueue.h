@@ -0,0 +1,201 @@
+/**********************************************************************************[CubifyQueue.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubifyQueueH
+#define CubifyQueueH
+
+#include <algorithm>
+#include <vector>
+
+#include "Bimap.h"
+
+// A queue of clauses to cubify, by persistent index (see Bimap.h).
+//
+// The clauses most likely to give dense cubes come first: the narrowest ones,
+// and among those, the ones with the greatest weight (e.g. the literals that
+// propagate the most).
+//
+// The queued clauses are the ones marked in the Bimap. A clause that is
+// dropped is unmarked at once, so the number of queued clauses that still
+// exist is always known; the heap entries of such clauses are only skipped
+// once they come up.
+class CubifyQueue
+{
+public:
+	explicit CubifyQueue(Bimap& bi);
+
+	// Enqueue the clause with the persistent index j, unless it is queued
+	// already.
+	void push(int j, int width, double weight);
+
+	// Dequeue the best clause that still exists. Returns -1 if there is none.
+	int pop();
+
+	// Take the clause out of the queue.
+	void remove(int j);
+
+	bool contains(int j) const;
+
+	// Number of queued clauses that still exist.
+	int live() const;
+
+	// Number of heap entries, including ones for clauses removed since.
+	size_t size() const;
+
+	// Renumber the entries after Bimap::compact(), dropping the ones for
+	// removed clauses.
+	void remap(const std::vector<int>& remap);
+
+	// Drop the entries for removed clauses, and release their memory.
+	void shrink();
+
+	// Empty the queue, releasing its memory.
+	void clear();
+
+	// The queued clauses that still exist, with their widths and weights, in
+	// no particular order. A clause may appear more than once, if it was
+	// removed and enqueued again.
+	void dump(std::vector<int>& ids, std::vector<int>& widths, std::vector<double>& weights) const;
+
+	// Bytes in use by the heap (the marks are counted in the Bimap).
+	size_t memoryUsage() const;
+
+private:
+	struct Entry
+	{
+		int width;
+		double weight;
+		int id;
+	};
+
+	// Heap order: is lhs to be dequeued after rhs? Ties go to the newest
+	// clause.
+	static bool after(const Entry& lhs, const Entry& rhs);
+
+	Bimap& bi;
+	std::vector<Entry> heap;
+};
+
+// Implementation below
+
+inline CubifyQueue::CubifyQueue(Bimap& bi) : bi(bi)
+{
+}
+
+inline bool CubifyQueue::after(const Entry& lhs, const Entry& rhs)
+{
+	if (lhs.width != rhs.width) return lhs.width > rhs.width;
+	if (lhs.weight != rhs.weight) return lhs.weight < rhs.weight;
+	return lhs.id < rhs.id;
+}
+
+inline void CubifyQueue::push(int j, int width, double weight)
+{
+	if (bi.marked(j)) return;
+
+	bi.mark(j);
+	heap.push_back({ width, weight, j });
+	std::push_heap(heap.begin(), heap.end(), after);
+}
+
+inline int CubifyQueue::pop()
+{
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), after);
+		int j = heap.back().id;
+		heap.pop_back();
+
+		if (bi.marked(j)) {
+			bi.unmark(j);
+			return j;
+		}
+	}
+	return -1;
+}
+
+inline void CubifyQueue::remove(int j)
+{
+	bi.unmark(j);
+}
+
+inline bool CubifyQueue::contains(int j) const
+{
+	return bi.marked(j);
+}
+
+inline int CubifyQueue::live() const
+{
+	return bi.nMarked();
+}
+
+inline size_t CubifyQueue::size() const
+{
+	return heap.size();
+}
+
+inline void CubifyQueue::remap(const std::vector<int>& remap)
+{
+	size_t k = 0;
+	for (const auto& e : heap) {
+		int r = (e.id >= 0 && e.id < remap.size()) ? remap[e.id] : -1;
+		if (r >= 0 && bi.marked(r)) {
+			heap[k] = e;
+			heap[k++].id = r;
+		}
+	}
+	heap.resize(k);
+	std::make_heap(heap.begin(), heap.end(), after);
+}
+
+inline void CubifyQueue::shrink()
+{
+	size_t k = 0;
+	for (const auto& e : heap) {
+		if (bi.marked(e.id)) heap[k++] = e;
+	}
+	heap.resize(k);
+	heap.shrink_to_fit();
+	std::make_heap(heap.begin(), heap.end(), after);
+}
+
+inline void CubifyQueue::clear()
+{
+	for (const auto& e : heap) {
+		bi.unmark(e.id);
+	}
+	heap = std::vector<Entry>();
+}
+
+inline void CubifyQueue::dump(std::vector<int>& ids, std::vector<int>& widths, std::vector<double>& weights) const
+{
+	for (const auto& e : heap) {
+		if (!bi.marked(e.id)) continue;
+
+		ids.push_back(e.id);
+		widths.push_back(e.width);
+		weights.push_back(e.weight);
+	}
+}
+
+inline size_t CubifyQueue::memoryUsage() const
+{
+	return heap.capacity() * sizeof(Entry);
+}
+
+#endif
@@ -0,0 +1,102 @@
+/********************************************************************************[CubifyWorker.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include "CubifyWorker.h"
+
+namespace Minisat
+{
+CubifyWorker::CubifyWorker(int id) : CubeWorker(id)
+{
+}
+
+void CubifyWorker::walk(const std::vector<Task>& tasks, std::vector<Result>& results, int first, int step)
+{
+	for (int k = first; k < tasks.size(); k += step) {
+		walk(tasks[k], results[k]);
+	}
+}
+
+void CubifyWorker::walk(const Task& task, Result& result)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	result = Result();
+	result.post = task.root;
+	if (task.subsumed || !ok) return;
+
+	int level0 = decisionLevel();
+	int trail0 = trail.size();
+
+	// As in CubifyingSolver::cubifyInternal().
+	Cube cube;
+	bool conflict = false;
+	std::vector<Lit> stack;
+	for (const auto L : task.path)
+	{
+		if (L == lit_Undef) {
+			cube.pop(stack.back());
+			stack.pop_back();
+			cancelProbe(decisionLevel() - 1);
+		}
+		else {
+			stack.push_back(L);
+			newProbeLevel();
+			auto v = value(L);
+
+			if (v == l_False) {
+				cube.push(L);
+				conflict = true;
+				break;
+			}
+			else if (v == l_True) {
+				continue;
+			}
+			else {
+				auto propagationsBefore = propagations;
+
+				cube.push(L);
+				enqueue(L);
+				if (propagate() != CRef_Undef) {
+					conflict = true;
+					break;
+				}
+
+				if (cube.size() == 1) {
+					result.difficulties.emplace_back(L, propagations - propagationsBefore);
+				}
+
+				result.implicants++;
+				double num = trail.size() - trail0;
+				double den = cube.size();
+				double score = num / den;
+				if (score > 1.0) {
+					result.scored.emplace_back(cube, score);
+				}
+			}
+		}
+	}
+
+	cancelProbe(level0);
+
+	if (conflict) result.post = cube;
+}
+
+} // namespace Minisat
@@ -0,0 +1,86 @@
+/*********************************************************************************[CubifyWorker.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef CubifyWorkerH
+#define CubifyWorkerH
+
+#include <utility>
+#include <vector>
+
+#include "CubeWorker.h"
+#include "Cube.h"
+
+namespace Minisat
+{
+// A solver that walks cubification paths on behalf of a master solver, on a
+// thread of its own.
+//
+// The clauses are copied and kept up to date as in CubeWorker; the paths are
+// planned by the master (see CubifyingSolver::makeCubifyPath()), and walked
+// with the worker's own trail. The outcome of each path is only recorded:
+// the master applies it once the thread has finished, so the worker never
+// touches the master.
+class CubifyWorker : public CubeWorker
+{
+public:
+	CubifyWorker(int id);
+
+	// A clause to cubify.
+	struct Task
+	{
+		// Persistent index of the clause.
+		int id;
+
+		// Root cube of the clause, and the path planned for it.
+		Cube root;
+		std::vector<Lit> path;
+
+		// The clause is subsumed by another problem clause (the path is
+		// empty).
+		bool subsumed = false;
+	};
+
+	// The outcome of walking the path of a task.
+	struct Result
+	{
+		// Conflicting subcube of the root cube (see
+		// CubifyingSolver::cubifyInternal()).
+		Cube post;
+
+		// Implicant cubes worth queueing, with their scores.
+		std::vector<std::pair<Cube, double>> scored;
+
+		// New literal difficulties.
+		std::vector<std::pair<Lit, int>> difficulties;
+
+		// How many implicant cubes were scored?
+		uint64_t implicants = 0;
+	};
+
+	// Walk the paths of tasks first, first + step, first + 2 * step, ...,
+	// writing the outcomes to the same positions of results.
+	void walk(const std::vector<Task>& tasks, std::vector<Result>& results, int first, int step);
+
+protected:
+	void walk(const Task&, Result&);
+};
+
+} // namespace Minisat
+
+#endif
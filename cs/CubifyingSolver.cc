@@ -18,10 +18,13 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 **************************************************************************************************/
 
 #include <algorithm>
+#include <thread>
 
 #include "minisat/utils/Options.h"
 #include "minisat/utils/System.h"
 #include "CubifyingSolver.h"
+#include "CubifyPath.h"
+#include "Snapshot.h"
 
 namespace Minisat
 {
@@ -39,106 +42,1860 @@ static DoubleOption opt_k_c(_cat, "k_c",
 static BoolOption opt_always_search(_cat, "always-search",
         "Search inside a cube even before cubification is completed", false);
 
+static IntOption  opt_cubify_batch(_cat, "cubify-batch",
+        "Cubify this many clauses at a time, sharing propagations of common prefixes (1=off)", 1, IntRange(1, INT_MAX));
+
+static IntOption  opt_cubify_threads(_cat, "cubify-threads",
+        "Number of threads cubifying clauses in parallel", 1, IntRange(1, 1024));
+
+static IntOption  opt_cube_threads(_cat, "cube-threads",
+        "Number of threads searching cube branches in parallel", 1, IntRange(1, 1024));
+
+static IntOption  opt_cube_batch(_cat, "cube-batch",
+        "Search this many cubes at a time, keeping their shared assumption levels (1=off)", 1, IntRange(1, INT_MAX));
+
+static IntOption  opt_cube_share_size(_cat, "cube-share-size",
+        "Maximum size of learnt clauses shared by the cube threads", 2, IntRange(0, INT_MAX));
+
+static IntOption  opt_cube_share_lbd(_cat, "cube-share-lbd",
+        "Maximum LBD of learnt clauses shared by the cube threads (0=off)", 2, IntRange(0, INT_MAX));
+
+static BoolOption opt_deterministic(_cat, "deterministic",
+        "Make the cube threads wait for each other at fixed conflict counts, so that runs are reproducible", false);
+
+static IntOption  opt_cube_epoch(_cat, "cube-epoch",
+        "Conflicts each cube thread runs between waits, with -deterministic", 1000, IntRange(1, INT_MAX));
+
+static BoolOption opt_adaptive(_cat, "adaptive",
+        "Adapt k_c, k_t and the cube search budget to the measured payoff of each phase", false);
+
+static IntOption  opt_rescore_after(_cat, "rescore-after",
+        "Re-score a cube before searching it, if this many level-0 units are newer than its score (0=off)", 0, IntRange(0, INT_MAX));
+
+static IntOption  opt_emit_cubes(_cat, "emit-cubes",
+        "Instead of solving, split the problem into at most this many cubes and write them to -cube-out (0=off)", 0, IntRange(0, INT_MAX));
+
+static StringOption opt_cube_out(_cat, "cube-out",
+        "File for the simplified problem and the cubes of -emit-cubes, in iCNF");
+
+static BoolOption opt_lookahead_split(_cat, "lookahead-split",
+        "Split the problem for -emit-cubes and -serve by lookahead, rather than along the best cubes", false);
+
+static IntOption  opt_split_depth(_cat, "split-depth",
+        "Maximum depth of the tree of -lookahead-split", 32, IntRange(1, INT_MAX));
+
+static DoubleOption opt_split_reduced(_cat, "split-reduced",
+        "Share of the free variables assigned under a node that makes it a leaf, with -lookahead-split", 0.5, DoubleRange(0, false, 1, true));
+
+static IntOption  opt_split_candidates(_cat, "split-candidates",
+        "Variables to look ahead on at each node, with -lookahead-split", 32, IntRange(1, INT_MAX));
+
+static IntOption  opt_serve(_cat, "serve",
+        "Instead of solving, serve cubes to -connect workers on this TCP port (0=off)", 0, IntRange(0, 65535));
+
+static IntOption  opt_serve_cubes(_cat, "serve-cubes",
+        "Number of cubes to split the problem into initially, in -serve mode", 64, IntRange(1, INT_MAX));
+
+static IntOption  opt_conquer_budget(_cat, "conquer-budget",
+        "Conflicts per cube, before a worker splits it, in -serve mode", 10000, IntRange(1, INT_MAX));
+
+static StringOption opt_connect(_cat, "connect",
+        "Instead of solving, work for the -serve coordinator at this host:port");
+
+static IntOption  opt_probe_interval(_cat, "probe-interval",
+        "Steps between two rounds of probing, equivalent literal substitution and transitive reduction (0=off)", 0, IntRange(0, INT_MAX));
+
+static DoubleOption opt_probe_effort(_cat, "probe-effort",
+        "Propagations of a round of probing, as a share of those since the previous round", 0.1, DoubleRange(0, false, HUGE_VAL, false));
+
+static IntOption  opt_elim_interval(_cat, "elim-interval",
+        "Steps between two rounds of variable elimination and subsumption (0=off)", 0, IntRange(0, INT_MAX));
+
+static IntOption  opt_elim_units(_cat, "elim-units",
+        "Also eliminate variables again once this many units have been found since the last round (0=off)", 0, IntRange(0, INT_MAX));
+
+static IntOption  opt_elim_occ_limit(_cat, "elim-occ-limit",
+        "Skip a round of elimination if the problem clauses have more literals than this", 10000000, IntRange(0, INT_MAX));
+
+static DoubleOption opt_cube_mem_share(_cat, "cube-mem-share",
+        "Share of -mem-lim for the cube queue, the index and the cubification queue", 0.5, DoubleRange(0, false, 1, true));
+
+static StringOption opt_telemetry(_cat, "telemetry",
+        "Write one JSON record per solver step to this file");
+
+static StringOption opt_score_cache(_cat, "score-cache",
+        "Warm-start the cube queue from this file, and write it back at the end");
+
+static StringOption opt_checkpoint(_cat, "checkpoint",
+        "Write the state of the run to this file periodically, to be continued with -resume");
+
+static DoubleOption opt_checkpoint_interval(_cat, "checkpoint-interval",
+        "Seconds between two checkpoints", 300.0, DoubleRange(0, true, HUGE_VAL, false));
+
 CubifyingSolver::CubifyingSolver()
 {
     k_t = opt_k_t;
     k_c = opt_k_c;
     maxCubifiableSize = opt_max_cubify;
     alwaysSearchCube = opt_always_search;
+    cubifyBatch = opt_cubify_batch;
+    cubifyThreads = opt_cubify_threads;
+    cubeThreads = opt_cube_threads;
+    cubeBatch = opt_cube_batch;
+    cubeShareSize = opt_cube_share_size;
+    cubeShareLbd = opt_cube_share_lbd;
+    deterministic = opt_deterministic;
+    cubeEpoch = opt_cube_epoch;
+    rescoreAfter = opt_rescore_after;
+    adaptive = opt_adaptive;
+    memoryShare = opt_cube_mem_share;
+    if (opt_score_cache) scoreCache = (const char*)opt_score_cache;
+    if (opt_checkpoint) checkpointPath = (const char*)opt_checkpoint;
+    checkpointInterval = opt_checkpoint_interval;
+    emitCubes = opt_emit_cubes;
+    if (opt_cube_out) cubeOut = (const char*)opt_cube_out;
+    lookaheadSplit = opt_lookahead_split;
+    splitDepth = opt_split_depth;
+    splitReduced = opt_split_reduced;
+    splitCandidates = opt_split_candidates;
+    servePort = opt_serve;
+    serveCubes = opt_serve_cubes;
+    conquerBudget = opt_conquer_budget;
+    if (opt_connect) connectTo = (const char*)opt_connect;
+    probeInterval = opt_probe_interval;
+    probeEffort = opt_probe_effort;
+    elimInterval = opt_elim_interval;
+    elimUnits = opt_elim_units;
+    elimOccLimit = opt_elim_occ_limit;
+    if (opt_telemetry && !openTelemetry(opt_telemetry)) {
+        printf("WARNING! Could not open telemetry file: %s\n", (const char*)opt_telemetry);
+    }
+}
+
+CubifyingSolver::~CubifyingSolver()
+{
+}
+
+bool CubifyingSolver::pickCube(Cube& cube)
+{
+	for (;;) {
+		// A refuted cube may have added units, and so moved the epoch.
+		cq.setEpoch(scoreEpoch());
+
+		if (cq.empty()) {
+			return false;
+		}
+		else if (cq.bestScore() < (k_t * cq.meanScore())) {
+			return false;
+		}
+
+		cube = cq.peekBest(irand(random_seed, 1000000));
+		if (!isStale(cube)) {
+			return true;
+		}
+		if (rescoreCube(cube) == l_False) {
+			return false;
+		}
+	}
+}
+
+int CubifyingSolver::pickCubes(std::vector<Cube>& cubes, int n)
+{
+	size_t n0 = cubes.size();
+	for (;;) {
+		// As in pickCube().
+		cq.setEpoch(scoreEpoch());
+
+		if (cq.empty()) {
+			return 0;
+		}
+
+		cq.peekBest(cubes, n, k_t * cq.meanScore());
+
+		// Re-score the stale cubes among the best, and try again.
+		bool stale = false;
+		for (size_t k = n0; k < cubes.size(); ++k) {
+			if (!isStale(cubes[k])) continue;
+
+			stale = true;
+			if (rescoreCube(cubes[k]) == l_False) {
+				cubes.resize(n0);
+				return 0;
+			}
+		}
+		if (!stale) break;
+
+		cubes.resize(n0);
+	}
+
+	return cubes.size() - n0;
+}
+
+uint64_t CubifyingSolver::scoreEpoch() const
+{
+	return (trail_lim.size() > 0) ? trail_lim[0] : trail.size();
+}
+
+bool CubifyingSolver::isStale(const Cube& cube) const
+{
+	return (rescoreAfter > 0) && (scoreEpoch() - cq.epochOf(cube) >= (uint64_t)rescoreAfter);
+}
+
+lbool CubifyingSolver::rescoreCube(const Cube& cube)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+	assert(cq.contains(cube));
+#endif
+
+	cubeRescores++;
+
+	// Assume the literals one at a time, as in cubifyInternal(). The ones
+	// that are already implied do not count.
+	const int trail0 = trail.size();
+	Cube reduced;
+	bool falsified = false;
+	bool conflict = false;
+	for (auto L : cube) {
+		auto v = value(L);
+		if (v == l_True) {
+			continue;
+		}
+		else if (v == l_False) {
+			// Falsified at level 0, or by the literals before it.
+			falsified = (decisionLevel() == 0) || (level(var(L)) == 0);
+			conflict = !falsified;
+			reduced.push(L);
+			break;
+		}
+
+		reduced.push(L);
+		newProbeLevel();
+		enqueue(L);
+		if (propagate() != CRef_Undef) {
+			conflict = true;
+			break;
+		}
+	}
+	const double growth = trail.size() - trail0;
+	cancelProbe(0);
+
+	if (conflict) {
+		return refuteCube(cube, reduced);
+	}
+
+	// The parent clauses of a falsified cube are satisfied at level 0, and
+	// the ones of an implied cube will be found by the default search.
+	const double score = (reduced.size() > 0) ? growth / reduced.size() : 0.0;
+	if (falsified || score <= 1.0) {
+		cq.pop(cube);
+	}
+	else {
+		// Stamped with the epoch as it is now, so that the cube is not stale
+		// again at once.
+		cq.setEpoch(scoreEpoch());
+		cq.update(cube, score);
+	}
+	return l_Undef;
+}
+
+lbool CubifyingSolver::refuteCube(const Cube& base, const Cube& reduced)
+{
+#ifndef NO_CS_ASSERTS
+	assert(cq.contains(base));
+#endif
+
+	auto ii = cq.getParentInds(base);
+	cq.pop(base);
+
+	const bool learn = !ci.contains(reduced);
+	if (learn) proofNegationOf(reduced);
+
+	for (auto i : ii) {
+		int j = bi.fw(i);
+		if (j >= 0) {
+			dropClause(j);
+			refutedClausesDropped++;
+		}
+	}
+
+	if (learn) {
+		const int n = clauses.size();
+		learnNegationOf(reduced);
+		if (clauses.size() > n) queueForCubify(bi.bw(n));
+		ci.push(reduced);
+
+		if (!cubifyWorkers.empty()) {
+			cubifyBroadcast.emplace_back();
+			for (auto L : reduced) cubifyBroadcast.back().push_back(~L);
+		}
+	}
+
+	return ok ? l_Undef : l_False;
+}
+
+bool CubifyingSolver::pruneClause(const int i, const Cube& C)
+{
+	const bool learn = !ci.contains(C);
+	if (learn) proofNegationOf(C);
+
+	dropClause(i);
+	if (learn) {
+		Minisat::vec<Lit> v;
+		C.invert(v);
+		return addClause_(v);
+	}
+	return true;
+}
+
+void CubifyingSolver::bootstrap()
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	literalDifficulty.resize(2 * nVars(), INT_MAX);
+
+	// The workers derive clauses from ones that the master may have deleted
+	// from the proof already, so those could not be checked.
+	if (proof != NULL && (cubeThreads > 1 || cubifyThreads > 1)) {
+		if (verbosity > 0) printf("Writing a proof: cube search and cubification run on one thread\n");
+		cubeThreads = 1;
+		cubifyThreads = 1;
+	}
+
+	if (memoryBudget == 0) {
+		memoryBudget = size_t(memoryShare * memoryLimit() * 1024 * 1024);
+	}
+
+	// On later calls, the clauses that were here the last time have been
+	// enqueued already.
+	for (int i = 0; i < clauses.size(); ++i) {
+		const int j = bi.bw(i);
+		if (j >= bootstrapped) queueForCubify(j);
+	}
+	bootstrapped = bi.size();
+
+	cq.setEpoch(scoreEpoch());
+	for (const auto& d : deferred) {
+		// Not a new score, so the mean stays as it was.
+		double sum, n;
+		cq.getSeen(sum, n);
+		cq.push(d.cube, d.score, d.parents.empty() ? -1 : d.parents[0]);
+		for (size_t k = 1; k < d.parents.size(); ++k) {
+			cq.addParentInd(d.cube, d.parents[k]);
+		}
+		cq.setSeen(sum, n);
+	}
+	deferred.clear();
+
+	// The workers hold clauses over the variables eliminated since, and miss
+	// the clauses added since the last call; start them over from the
+	// problem as it is now.
+	if (eliminated_vars > eliminatedVars) {
+		dropEliminatedCubes();
+	}
+	if (eliminated_vars > eliminatedVars || bi.size() > stepIds) {
+		cubifyWorkers.clear();
+		cubifyBroadcast.clear();
+		cubeWorkers.clear();
+		workerBroadcast.clear();
+	}
+	eliminatedVars = eliminated_vars;
+
+	// Units found before the call do not count towards elimUnits.
+	elimTrail = trail.size();
+
+	if (solveCalls++ > 0) return;
+
+	if (!scoreCache.empty()) {
+		cacheHash = problemHash();
+		loadScoreCache();
+	}
+
+	// The controller starts from the configured values.
+	baseK_c = k_c;
+	baseK_t = k_t;
+	arm = AdaptiveArms / 2;
+}
+
+void CubifyingSolver::deferCube(const Cube& cube)
+{
+#ifndef NO_CS_ASSERTS
+	assert(cq.contains(cube));
+#endif
+
+	deferred.push_back({ cube, cq.scoreOf(cube), cq.getParentInds(cube) });
+	cq.pop(cube);
+	cubesDeferred++;
+}
+
+void CubifyingSolver::dropEliminatedCubes()
+{
+	std::vector<Cube> cubes;
+	std::vector<double> scores;
+	std::vector<std::vector<int>> parents;
+	cq.dump(cubes, scores, parents);
+
+	for (const auto& cube : cubes) {
+		for (auto L : cube) {
+			if (isEliminated(var(L))) {
+				cq.pop(cube);
+				break;
+			}
+		}
+	}
+
+	std::vector<Cube> indexed;
+	ci.dump(indexed);
+	for (const auto& cube : indexed) {
+		for (auto L : cube) {
+			if (isEliminated(var(L))) {
+				ci.pop(cube);
+				break;
+			}
+		}
+	}
+
+	auto eliminatedIn = [&](const DeferredCube& d) {
+		for (auto L : d.cube) {
+			if (isEliminated(var(L))) return true;
+		}
+		return false;
+	};
+	deferred.erase(std::remove_if(deferred.begin(), deferred.end(), eliminatedIn), deferred.end());
+}
+
+lbool CubifyingSolver::inprocess()
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	// Elimination keeps occurrence lists, which the rewriting would leave
+	// stale.
+	if (use_simplification) return l_Undef;
+
+	// As in SimpSolver::solve_(), the assumptions stay.
+	vec<Var> extraFrozen;
+	for (int i = 0; i < assumptions.size(); ++i) {
+		const Var v = var(assumptions[i]);
+		if (!frozen[v]) {
+			setFrozen(v, true);
+			extraFrozen.push(v);
+		}
+	}
+
+	bool sat = true;
+	if (probeInterval > 0 && ++probeSteps >= (uint64_t)probeInterval) {
+		probeSteps = 0;
+		sat = probeRound();
+	}
+
+	elimSteps++;
+	if (sat && ((elimInterval > 0 && elimSteps >= (uint64_t)elimInterval)
+		|| (elimUnits > 0 && trail.size() >= elimTrail + elimUnits))) {
+		sat = eliminateRound();
+		elimSteps = 0;
+		elimTrail = trail.size();
+	}
+
+	for (int i = 0; i < extraFrozen.size(); ++i) {
+		setFrozen(extraFrozen[i], false);
+	}
+
+	// The workers hold the clauses over the variables eliminated or
+	// substituted; start them over from the new problem.
+	if (eliminated_vars > eliminatedVars) {
+		dropEliminatedCubes();
+		cubifyWorkers.clear();
+		cubifyBroadcast.clear();
+		cubeWorkers.clear();
+		workerBroadcast.clear();
+		eliminatedVars = eliminated_vars;
+	}
+
+	return (sat && simplify()) ? l_Undef : l_False;
+}
+
+bool CubifyingSolver::probeRound()
+{
+	probeRounds++;
+
+	const uint64_t budget = uint64_t(probeEffort * (propagations - probePropagations));
+	const bool sat = probeLiterals(budget) && substituteEquivalences();
+	if (sat) reduceTransitive(budget);
+
+	probePropagations = propagations;
+	return sat;
+}
+
+bool CubifyingSolver::eliminateRound()
+{
+	if (clauses_literals > (uint64_t)elimOccLimit) return true;
+	elimRounds++;
+
+	const int ids0 = bi.size();
+	const int clauses0 = nClauses();
+	const int eliminated0 = eliminated_vars;
+
+	resumeElimination();
+	if (!eliminate(false)) return false;
+
+	// The resolvents are new problem clauses, to be cubified. Persistent
+	// indices are not compacted while elimination is on, so they are the
+	// ones from ids0 on.
+	unindexRemovedClauses();
+	int added = 0;
+	for (int i = 0; i < clauses.size(); ++i) {
+		const int j = bi.bw(i);
+		if (j >= ids0 && !isRemoved(clauses[i])) {
+			queueForCubify(j);
+			added++;
+		}
+	}
+	if (!eliminate(true)) return false;
+
+	elimVars += eliminated_vars - eliminated0;
+	elimResolvents += added;
+	elimRemoved += std::max(clauses0 + added - nClauses(), 0);
+
+	// Learnt clauses over the eliminated variables would only keep them
+	// assigned for nothing.
+	if (eliminated_vars > eliminated0) {
+		int i, j;
+		for (i = j = 0; i < learnts.size(); ++i) {
+			const Clause& c = ca[learnts[i]];
+			bool keep = true;
+			for (int k = 0; k < c.size() && keep; ++k) {
+				if (isEliminated(var(c[k]))) keep = false;
+			}
+			if (keep) learnts[j++] = learnts[i];
+			else removeClause(learnts[i]);
+		}
+		learnts.shrink(i - j);
+		checkGarbage();
+	}
+
+	return true;
+}
+
+void CubifyingSolver::unindexRemovedClauses()
+{
+	for (int i = 0; i < clauses.size(); ++i) {
+		if (isRemoved(clauses[i])) ci.pop(Cube::inverted(ca[clauses[i]]));
+	}
+}
+
+bool CubifyingSolver::probeLiterals(uint64_t budget)
+{
+	std::vector<std::pair<double, Var>> order;
+	for (Var v = 0; v < nVars(); ++v) {
+		if (!decision[v] || isEliminated(v) || value(v) != l_Undef) continue;
+		double prior = 1.0;
+		bool scored = false;
+		for (auto L : { mkLit(v), ~mkLit(v) }) {
+			const int d = (L.x < (int)literalDifficulty.size()) ? literalDifficulty[L.x] : INT_MAX;
+			if (d != INT_MAX) {
+				prior *= 1.0 + d;
+				scored = true;
+			}
+		}
+		if (scored) order.emplace_back(prior, v);
+	}
+	std::sort(order.begin(), order.end(),
+		[](const std::pair<double, Var>& a, const std::pair<double, Var>& b) { return a.first > b.first; });
+
+	// At most one resolvent per ten problem clauses in a round.
+	const uint64_t maxHyper = hyperBinaries + clauses.size() / 10 + 100;
+	const uint64_t props0 = propagations;
+	std::vector<int> stamp(2 * nVars(), -1);
+	std::vector<Lit> both, hyper;
+	vec<Lit> lits;
+
+	for (int k = 0; k < (int)order.size(); ++k) {
+		if (propagations - props0 >= budget || outOfBudget()) break;
+		const Var v = order[k].second;
+		if (value(v) != l_Undef) continue;
+
+		// Stamp what the first literal implies, to find what both imply.
+		Lit failed = lit_Undef;
+		both.clear();
+		hyper.clear();
+		for (int s = 0; s < 2; ++s) {
+			const Lit L = mkLit(v, s);
+			newProbeLevel();
+			uncheckedEnqueue(L);
+			if (propagate() != CRef_Undef) {
+				cancelProbe(0);
+				failed = L;
+				break;
+			}
+			for (int t = trail_lim[0] + 1; t < trail.size(); ++t) {
+				const Lit u = trail[t];
+				const CRef r = reason(var(u));
+				if (r != CRef_Undef && ca[r].size() > 2) {
+					hyper.push_back(~L);
+					hyper.push_back(u);
+				}
+				if (s == 0) stamp[toInt(u)] = k;
+				else if (stamp[toInt(u)] == k) both.push_back(u);
+			}
+			cancelProbe(0);
+		}
+
+		if (failed != lit_Undef) {
+			probeUnits++;
+			if (!learnUnit(~failed)) return false;
+			continue;
+		}
+
+		for (auto u : both) {
+			if (value(u) != l_Undef) continue;
+			if (proof != NULL) {
+				lits.clear();
+				lits.push(~mkLit(v));
+				lits.push(u);
+				proof->add(lits);
+				lits[0] = mkLit(v);
+				proof->add(lits);
+			}
+			probeUnits++;
+			if (!learnUnit(u)) return false;
+			if (proof != NULL) {
+				proof->remove(lits);
+				lits[0] = ~mkLit(v);
+				proof->remove(lits);
+			}
+		}
+
+		for (size_t h = 0; h < hyper.size() && hyperBinaries < maxHyper; h += 2) {
+			const Lit a = hyper[h];
+			const Lit b = hyper[h + 1];
+			if (value(a) != l_Undef || value(b) != l_Undef || hasBinary(a, b)) continue;
+
+			lits.clear();
+			lits.push(a);
+			lits.push(b);
+			if (proof != NULL) proof->add(lits);
+			const CRef cr = ca.alloc(lits, true);
+			ca[cr].lbd(2);
+			ca[cr].tier(tierOfLBD(2));
+			learnts.push(cr);
+			attachClause(cr);
+			hyperBinaries++;
+		}
+	}
+
+	return true;
+}
+
+bool CubifyingSolver::substituteEquivalences()
+{
+	const int n = 2 * nVars();
+	std::vector<Lit> repr(n);
+	for (int x = 0; x < n; ++x) repr[x] = toLit(x);
+	bool found = false;
+
+	// Tarjan's algorithm without recursion: each frame is a literal, and the
+	// next of its binary watchers to follow.
+	std::vector<int> index(n, -1), low(n, 0);
+	std::vector<char> onStack(n, 0), member(n, 0), done(nVars(), 0);
+	std::vector<Lit> stack, component;
+	std::vector<std::pair<Lit, int>> frames;
+	int counter = 0;
+
+	for (int x = 0; x < n; ++x) {
+		const Lit root = toLit(x);
+		if (index[x] >= 0 || value(root) != l_Undef || isEliminated(var(root))) continue;
+		index[x] = low[x] = counter++;
+		stack.push_back(root);
+		onStack[x] = 1;
+		frames.emplace_back(root, 0);
+
+		while (!frames.empty()) {
+			const Lit p = frames.back().first;
+			const vec<Watcher>& ws = bin_watches[p];
+			if (frames.back().second < ws.size()) {
+				const Watcher& w = ws[frames.back().second++];
+				const Lit q = w.blocker;
+				if (ca[w.cref].mark() == 1 || value(q) != l_Undef) continue;
+				if (index[toInt(q)] < 0) {
+					index[toInt(q)] = low[toInt(q)] = counter++;
+					stack.push_back(q);
+					onStack[toInt(q)] = 1;
+					frames.emplace_back(q, 0);
+				}
+				else if (onStack[toInt(q)]) {
+					low[toInt(p)] = std::min(low[toInt(p)], index[toInt(q)]);
+				}
+				continue;
+			}
+
+			frames.pop_back();
+			if (!frames.empty()) {
+				const int parent = toInt(frames.back().first);
+				low[parent] = std::min(low[parent], low[toInt(p)]);
+			}
+			if (low[toInt(p)] != index[toInt(p)]) continue;
+
+			component.clear();
+			Lit q;
+			do {
+				q = stack.back();
+				stack.pop_back();
+				onStack[toInt(q)] = 0;
+				component.push_back(q);
+			} while (q != p);
+
+			// The complement of a component is one too; the first of the two
+			// to be found stands for both.
+			if (component.size() == 1 || done[var(p)]) continue;
+
+			Lit r = component[0];
+			for (auto L : component) member[toInt(L)] = 1;
+			for (auto L : component) {
+				if (member[toInt(~L)]) {
+					// L and ~L imply each other.
+					if (proof != NULL) {
+						vec<Lit> unit;
+						unit.push(~L);
+						proof->add(unit);
+					}
+					return ok = false;
+				}
+				done[var(L)] = 1;
+				if (frozen[var(L)] > frozen[var(r)] || (frozen[var(L)] == frozen[var(r)] && var(L) < var(r))) r = L;
+			}
+			for (auto L : component) {
+				member[toInt(L)] = 0;
+				if (L == r || frozen[var(L)] || !decision[var(L)]) continue;
+				repr[toInt(L)] = r;
+				repr[toInt(~L)] = ~r;
+				found = true;
+			}
+		}
+	}
+	if (!found) return true;
+
+	// Rewrite the clauses through repr, dropping the false literals and the
+	// duplicates. Returns false if the clause is satisfied or a tautology.
+	vec<Lit> lits;
+	auto substitute = [&](const Clause& c) {
+		lits.clear();
+		bool keep = true;
+		for (int k = 0; k < c.size() && keep; ++k) {
+			const Lit L = repr[toInt(c[k])];
+			if (value(L) == l_True || member[toInt(~L)]) keep = false;
+			else if (value(L) == l_Undef && !member[toInt(L)]) {
+				member[toInt(L)] = 1;
+				lits.push(L);
+			}
+		}
+		for (int k = 0; k < lits.size(); ++k) member[toInt(lits[k])] = 0;
+		return keep;
+	};
+	auto affected = [&](const Clause& c) {
+		for (int k = 0; k < c.size(); ++k) {
+			if (repr[toInt(c[k])] != c[k]) return true;
+		}
+		return false;
+	};
+
+	// The rewritten clauses follow from the binary clauses of the
+	// components, so they all go to the proof before any clause is removed.
+	if (proof != NULL) {
+		for (int i = 0; i < clauses.size() + learnts.size(); ++i) {
+			const Clause& c = ca[(i < clauses.size()) ? clauses[i] : learnts[i - clauses.size()]];
+			if (affected(c) && substitute(c) && lits.size() > 0) proof->add(lits);
+		}
+	}
+
+	// Units are assigned once all clauses are rewritten.
+	std::vector<Lit> units;
+	for (int i = clauses.size() - 1; i >= 0; --i) {
+		const Clause& c = ca[clauses[i]];
+		if (!affected(c)) continue;
+		if (!substitute(c)) {
+			ci.pop(Cube::inverted(c));
+			dropClause(i);
+		}
+		else if (lits.size() == 0) {
+			return ok = false;
+		}
+		else if (lits.size() == 1) {
+			units.push_back(lits[0]);
+			ci.pop(Cube::inverted(c));
+			dropClause(i);
+		}
+		else {
+			rewriteClause(clauses[i], lits);
+		}
+	}
+
+	int i, j;
+	for (i = j = 0; i < learnts.size(); ++i) {
+		const CRef cr = learnts[i];
+		const Clause& c = ca[cr];
+		if (!ok || !affected(c)) {
+			learnts[j++] = cr;
+		}
+		else if (!substitute(c)) {
+			removeClause(cr);
+		}
+		else if (lits.size() == 0) {
+			ok = false;
+			learnts[j++] = cr;
+		}
+		else if (lits.size() == 1) {
+			units.push_back(lits[0]);
+			removeClause(cr);
+		}
+		else {
+			rewriteClause(cr, lits);
+			learnts[j++] = cr;
+		}
+	}
+	learnts.shrink(i - j);
+	if (!ok) return false;
+
+	// As in SimpSolver::eliminateVar(), but the clauses defining each
+	// variable are its two binary clauses with the representative.
+	for (Var v = 0; v < nVars(); ++v) {
+		const Lit r = repr[toInt(mkLit(v))];
+		if (r == mkLit(v)) continue;
+		elimclauses.push(toInt(mkLit(v)));
+		elimclauses.push(toInt(~r));
+		elimclauses.push(2);
+		elimclauses.push(toInt(~mkLit(v)));
+		elimclauses.push(toInt(r));
+		elimclauses.push(2);
+		eliminated[v] = true;
+		setDecisionVar(v, false);
+		eliminated_vars++;
+		substitutedVars++;
+	}
+
+	for (auto L : units) {
+		if (value(L) == l_False) return ok = false;
+		if (value(L) == l_Undef) uncheckedEnqueue(L);
+	}
+	return ok = (propagate() == CRef_Undef);
+}
+
+void CubifyingSolver::reduceTransitive(uint64_t budget)
+{
+	std::vector<int> stamp(2 * nVars(), -1);
+	std::vector<Lit> queue;
+	uint64_t steps = 0;
+	int search = 0;
+
+	// Is b reachable from a through binary clauses other than cr?
+	auto reaches = [&](Lit a, Lit b, CRef cr) {
+		search++;
+		queue.clear();
+		queue.push_back(a);
+		stamp[toInt(a)] = search;
+		for (size_t h = 0; h < queue.size() && steps < budget; ++h) {
+			const vec<Watcher>& ws = bin_watches[queue[h]];
+			for (int k = 0; k < ws.size(); ++k) {
+				steps++;
+				const Lit q = ws[k].blocker;
+				if (ws[k].cref == cr || stamp[toInt(q)] == search || value(q) != l_Undef
+					|| ca[ws[k].cref].mark() == 1) {
+					continue;
+				}
+				if (q == b) return true;
+				stamp[toInt(q)] = search;
+				queue.push_back(q);
+			}
+		}
+		return false;
+	};
+
+	for (int i = clauses.size() - 1; i >= 0 && steps < budget; --i) {
+		const Clause& c = ca[clauses[i]];
+		if (c.size() != 2 || value(c[0]) != l_Undef || value(c[1]) != l_Undef) continue;
+		if (reaches(~c[0], c[1], clauses[i])) {
+			ci.pop(Cube::inverted(c));
+			dropClause(i);
+			transitiveRemoved++;
+		}
+	}
+
+	int i, j;
+	for (i = j = 0; i < learnts.size(); ++i) {
+		const CRef cr = learnts[i];
+		const Clause& c = ca[cr];
+		if (steps < budget && c.size() == 2 && value(c[0]) == l_Undef && value(c[1]) == l_Undef
+			&& reaches(~c[0], c[1], cr)) {
+			removeClause(cr);
+			transitiveRemoved++;
+		}
+		else {
+			learnts[j++] = cr;
+		}
+	}
+	learnts.shrink(i - j);
+}
+
+bool CubifyingSolver::learnUnit(Lit L)
+{
+	if (proof != NULL) {
+		vec<Lit> unit;
+		unit.push(L);
+		proof->add(unit);
+	}
+	if (value(L) == l_False) return ok = false;
+	if (value(L) == l_Undef) uncheckedEnqueue(L);
+	return ok = (propagate() == CRef_Undef);
+}
+
+bool CubifyingSolver::hasBinary(Lit a, Lit b)
+{
+	const vec<Watcher>& ws = bin_watches[~a];
+	for (int k = 0; k < ws.size(); ++k) {
+		if (ws[k].blocker == b && ca[ws[k].cref].mark() == 0) return true;
+	}
+	return false;
+}
+
+void CubifyingSolver::rewriteClause(CRef cr, const vec<Lit>& lits)
+{
+	Clause& c = ca[cr];
+	const Cube old = Cube::inverted(c);
+	if (proof != NULL) {
+		proof_tmp.clear();
+		for (int k = 0; k < c.size(); ++k) proof_tmp.push(c[k]);
+	}
+
+	detachClause(cr, true);
+	for (int k = 0; k < lits.size(); ++k) c[k] = lits[k];
+	c.shrink(c.size() - lits.size());
+	attachClause(cr);
+
+	if (proof != NULL) proof->remove(proof_tmp);
+	if (!c.learnt() && ci.contains(old)) {
+		ci.pop(old);
+		ci.push(Cube::inverted(c));
+	}
+}
+
+// Budget multipliers tried by the adaptive controller, for k_c and k_q.
+static const double AdaptiveScales[] = { 0.25, 1.0, 4.0 };
+
+void CubifyingSolver::onStep(const StepStats& s)
+{
+	if (!adaptive || s.status != l_Undef) return;
+
+	// The payoff of a step is what the cube phases exist for: refuted cubes,
+	// the clauses they replace, and new facts at level 0. The cost is the
+	// conflicts of both searches, plus the cubification propagations at the
+	// rate of propagations per conflict in the default search.
+	const double propsPerConflict = (s.searchConflicts > 0)
+		? double(s.searchProps) / s.searchConflicts : 1.0;
+	const double cost = s.searchConflicts + s.cubeConflicts
+		+ s.cubifyProps / std::max(1.0, propsPerConflict);
+	const double payoff = s.cubeRefutations + s.clausesDropped + s.newUnits;
+	bandit.update(arm, (cost > 0.0) ? payoff / cost : 0.0);
+
+	arm = bandit.choose();
+	k_c = baseK_c * AdaptiveScales[arm / 3];
+	k_q = AdaptiveScales[arm % 3];
+
+	// If nearly every cube searched is refuted, the threshold only lets
+	// through cubes that are too easy; if hardly any is, the cube search is
+	// wasted on cubes that are too hard. If no cube passes the threshold at
+	// all, the cube search is starved.
+	if (s.cubeSearches > 0) {
+		const double rate = double(s.cubeRefutations) / s.cubeSearches;
+		if (rate > 0.5) k_t = std::max(baseK_t / 10.0, k_t / 1.1);
+		else if (rate < 0.1) k_t = std::min(baseK_t * 10.0, k_t * 1.1);
+	}
+	else if (!cq.empty() && cq.bestScore() < k_t * cq.meanScore()) {
+		k_t = std::max(baseK_t / 10.0, k_t / 1.1);
+	}
+}
+
+void CubifyingSolver::loadScoreCache()
+{
+	SnapshotReader in(scoreCache.c_str());
+
+	int n = 0;
+	uint64_t hash = 0;
+	double sumScore, numSeen;
+	const int* difficulty;
+	const Lit* lits;
+	const uint32_t* sizes;
+	const double* scores;
+	const uint32_t* parentCounts;
+	const Lit* parentLits;
+	const uint32_t* parentSizes;
+	size_t nDifficulty, nLits, nCubes, nScores, nParentCounts, nParentLits, nParents;
+
+	in.getValue(n);
+	in.getValue(hash);
+	in.getArray(difficulty, nDifficulty);
+	in.getValue(sumScore);
+	in.getValue(numSeen);
+	in.getArray(lits, nLits);
+	in.getArray(sizes, nCubes);
+	in.getArray(scores, nScores);
+	in.getArray(parentCounts, nParentCounts);
+	in.getArray(parentLits, nParentLits);
+	in.getArray(parentSizes, nParents);
+
+	// Written for another instance (or not at all).
+	if (!in.ok() || n != nVars() || hash != cacheHash || nDifficulty != literalDifficulty.size()
+		|| nScores != nCubes || nParentCounts != nCubes) {
+		return;
+	}
+
+	std::copy(difficulty, difficulty + nDifficulty, literalDifficulty.begin());
+
+	// The parents are recorded by their literals, since persistent indices
+	// are only meaningful within a run.
+	std::unordered_map<Cube, int> parentIds;
+	for (int i = 0; i < clauses.size(); ++i) {
+		const Clause& c = ca[clauses[i]];
+		if (c.size() <= maxCubifiableSize) {
+			parentIds.emplace(Cube::inverted(c), bi.bw(i));
+		}
+	}
+
+	auto valid = [&](const Lit* begin, const Lit* end) {
+		for (auto it = begin; it != end; ++it) {
+			if (var(*it) < 0 || var(*it) >= nVars() || isEliminated(var(*it))) return false;
+		}
+		return true;
+	};
+
+	std::vector<char> done(bi.size(), 0);
+	std::vector<int> parents;
+	size_t kLit = 0, kParent = 0, kParentLit = 0;
+	for (size_t c = 0; c < nCubes; ++c) {
+		if (sizes[c] > nLits - kLit || parentCounts[c] > nParents - kParent) return;
+
+		const Lit* begin = lits + kLit;
+		const Lit* end = begin + sizes[c];
+		kLit += sizes[c];
+
+		parents.clear();
+		for (uint32_t p = 0; p < parentCounts[c]; ++p) {
+			const uint32_t size = parentSizes[kParent++];
+			if (size > nParentLits - kParentLit) return;
+
+			const Lit* pBegin = parentLits + kParentLit;
+			kParentLit += size;
+			if (!valid(pBegin, pBegin + size)) continue;
+
+			auto it = parentIds.find(Cube(pBegin, pBegin + size));
+			if (it != parentIds.end()) parents.push_back(it->second);
+		}
+
+		// Drop the cube if its parents are gone, or it is decided at level 0.
+		if (parents.empty() || !valid(begin, end)) continue;
+
+		bool satisfied = true;
+		bool falsified = false;
+		for (auto it = begin; it != end; ++it) {
+			satisfied &= (value(*it) == l_True);
+			falsified |= (value(*it) == l_False);
+		}
+		if (satisfied || falsified) continue;
+
+		Cube cube(begin, end);
+		for (auto j : parents) {
+			cq.push(cube, scores[c], j);
+			done[j] = 1;
+		}
+		cachedCubes++;
+	}
+
+	// The scores seen in the earlier runs already include the cached cubes.
+	cq.setSeen(sumScore, numSeen);
+
+	// Do not cubify the clauses again.
+	for (int j = 0; j < done.size(); ++j) {
+		if (done[j]) cubifyQueue.remove(j);
+	}
+}
+
+bool CubifyingSolver::saveScoreCache() const
+{
+	if (scoreCache.empty()) return true;
+
+	std::vector<Cube> cubes;
+	std::vector<double> scores;
+	std::vector<std::vector<int>> parents;
+	cq.dump(cubes, scores, parents);
+
+	std::vector<Lit> lits;
+	std::vector<uint32_t> sizes;
+	std::vector<double> cubeScores;
+	std::vector<uint32_t> parentCounts;
+	std::vector<Lit> parentLits;
+	std::vector<uint32_t> parentSizes;
+	for (size_t c = 0; c < cubes.size(); ++c) {
+		uint32_t count = 0;
+		for (auto j : parents[c]) {
+			int i = bi.fw(j);
+			if (i < 0) continue;
+
+			Cube neg = Cube::inverted(ca[clauses[i]]);
+			parentLits.insert(parentLits.end(), neg.begin(), neg.end());
+			parentSizes.push_back(neg.size());
+			count++;
+		}
+		if (count == 0) continue;
+
+		lits.insert(lits.end(), cubes[c].begin(), cubes[c].end());
+		sizes.push_back(cubes[c].size());
+		cubeScores.push_back(scores[c]);
+		parentCounts.push_back(count);
+	}
+
+	double sumScore, numSeen;
+	cq.getSeen(sumScore, numSeen);
+
+	SnapshotWriter out(scoreCache.c_str());
+	out.putValue(nVars());
+	out.putValue(cacheHash);
+	out.putArray(literalDifficulty.data(), literalDifficulty.size());
+	out.putValue(sumScore);
+	out.putValue(numSeen);
+	out.putArray(lits.data(), lits.size());
+	out.putArray(sizes.data(), sizes.size());
+	out.putArray(cubeScores.data(), cubeScores.size());
+	out.putArray(parentCounts.data(), parentCounts.size());
+	out.putArray(parentLits.data(), parentLits.size());
+	out.putArray(parentSizes.data(), parentSizes.size());
+	return out.close();
+}
+
+// Cubes as two blocks: the literals of all of them, and their sizes.
+static void putCubes(SnapshotWriter& out, const std::vector<Cube>& cubes)
+{
+	std::vector<Lit> lits;
+	std::vector<uint32_t> sizes;
+	for (const auto& cube : cubes) {
+		lits.insert(lits.end(), cube.begin(), cube.end());
+		sizes.push_back(cube.size());
+	}
+	out.putArray(lits.data(), lits.size());
+	out.putArray(sizes.data(), sizes.size());
+}
+
+static bool getCubes(SnapshotReader& in, std::vector<Cube>& cubes)
+{
+	const Lit* lits;
+	const uint32_t* sizes;
+	size_t nLits, nCubes;
+	if (!in.getArray(lits, nLits) || !in.getArray(sizes, nCubes)) return false;
+
+	size_t k = 0;
+	for (size_t c = 0; c < nCubes; ++c) {
+		if (sizes[c] > nLits - k) return false;
+		cubes.emplace_back(lits + k, lits + k + sizes[c]);
+		k += sizes[c];
+	}
+	return true;
+}
+
+void CubifyingSolver::saveCheckpoint(SnapshotWriter& out)
+{
+	CubifyingSolverBase::saveCheckpoint(out);
+
+	// Unlike in the score cache, the parents are kept by persistent index,
+	// since the snapshot keeps those.
+	std::vector<Cube> cubes;
+	std::vector<double> scores;
+	std::vector<std::vector<int>> parents;
+	cq.dump(cubes, scores, parents);
+
+	std::vector<uint32_t> parentCounts;
+	std::vector<int> parentIds;
+	for (const auto& p : parents) {
+		parentCounts.push_back(p.size());
+		parentIds.insert(parentIds.end(), p.begin(), p.end());
+	}
+
+	double sumScore, numSeen;
+	cq.getSeen(sumScore, numSeen);
+
+	std::vector<Cube> indexed;
+	ci.dump(indexed);
+
+	std::vector<int> queued, widths;
+	std::vector<double> weights;
+	cubifyQueue.dump(queued, widths, weights);
+
+	const uint64_t counters[] = { scoredImplicants, cubeRescores, memoryPurges, solveCalls, cubesDeferred,
+		(uint64_t)cachedCubes, (uint64_t)bootstrapped, (uint64_t)eliminatedVars, (uint64_t)cubifyDisabled,
+		(uint64_t)arm, probeRounds, probeUnits, hyperBinaries, substitutedVars, transitiveRemoved,
+		probeSteps, probePropagations, elimRounds, elimVars, elimResolvents, elimRemoved, elimSteps,
+		(uint64_t)elimTrail };
+	const double params[] = { k_t, k_c, baseK_t, baseK_c };
+
+	out.putArray(counters, sizeof(counters) / sizeof(counters[0]));
+	out.putArray(params, sizeof(params) / sizeof(params[0]));
+	out.putArray(literalDifficulty.data(), literalDifficulty.size());
+	out.putValue(sumScore);
+	out.putValue(numSeen);
+	putCubes(out, cubes);
+	out.putArray(scores.data(), scores.size());
+	out.putArray(parentCounts.data(), parentCounts.size());
+	out.putArray(parentIds.data(), parentIds.size());
+	putCubes(out, indexed);
+	out.putArray(queued.data(), queued.size());
+	out.putArray(widths.data(), widths.size());
+	out.putArray(weights.data(), weights.size());
+}
+
+bool CubifyingSolver::loadCheckpoint(SnapshotReader& in)
+{
+	if (!CubifyingSolverBase::loadCheckpoint(in)) return false;
+
+	const uint64_t* counters;
+	const double* params;
+	const int* difficulty;
+	const double* scores;
+	const uint32_t* parentCounts;
+	const int* parentIds;
+	const int* queued;
+	const int* widths;
+	const double* weights;
+	size_t nCounters, nParams, nDifficulty, nScores, nParentCounts, nParentIds, nQueued, nWidths, nWeights;
+	double sumScore, numSeen;
+	std::vector<Cube> cubes, indexed;
+
+	in.getArray(counters, nCounters);
+	in.getArray(params, nParams);
+	in.getArray(difficulty, nDifficulty);
+	in.getValue(sumScore);
+	in.getValue(numSeen);
+	getCubes(in, cubes);
+	in.getArray(scores, nScores);
+	in.getArray(parentCounts, nParentCounts);
+	in.getArray(parentIds, nParentIds);
+	getCubes(in, indexed);
+	in.getArray(queued, nQueued);
+	in.getArray(widths, nWidths);
+	in.getArray(weights, nWeights);
+
+	if (!in.ok() || nCounters != 23 || nParams != 4 || nDifficulty != 2 * (size_t)nVars()
+		|| nScores != cubes.size() || nParentCounts != cubes.size()
+		|| nWidths != nQueued || nWeights != nQueued) {
+		return false;
+	}
+
+	scoredImplicants = counters[0];
+	cubeRescores = counters[1];
+	memoryPurges = counters[2];
+	solveCalls = counters[3];
+	cubesDeferred = counters[4];
+	cachedCubes = (int)counters[5];
+	bootstrapped = (int)counters[6];
+	eliminatedVars = (int)counters[7];
+	cubifyDisabled = counters[8] != 0;
+	arm = (int)counters[9];
+	probeRounds = counters[10];
+	probeUnits = counters[11];
+	hyperBinaries = counters[12];
+	substitutedVars = counters[13];
+	transitiveRemoved = counters[14];
+	probeSteps = counters[15];
+	probePropagations = counters[16];
+	elimRounds = counters[17];
+	elimVars = counters[18];
+	elimResolvents = counters[19];
+	elimRemoved = counters[20];
+	elimSteps = counters[21];
+	elimTrail = (int)counters[22];
+
+	k_t = params[0];
+	k_c = params[1];
+	baseK_t = params[2];
+	baseK_c = params[3];
+
+	literalDifficulty.assign(difficulty, difficulty + nDifficulty);
+
+	// The scores were computed at various epochs; count them all as fresh.
+	cq.setEpoch(scoreEpoch());
+	size_t k = 0;
+	for (size_t c = 0; c < cubes.size(); ++c) {
+		if (parentCounts[c] == 0 || parentCounts[c] > nParentIds - k) return false;
+
+		cq.push(cubes[c], scores[c], parentIds[k]);
+		for (uint32_t p = 1; p < parentCounts[c]; ++p) {
+			cq.addParentInd(cubes[c], parentIds[k + p]);
+		}
+		k += parentCounts[c];
+	}
+	cq.setSeen(sumScore, numSeen);
+
+	for (const auto& cube : indexed) {
+		ci.push(cube);
+	}
+
+	for (size_t q = 0; q < nQueued; ++q) {
+		if (queued[q] < 0 || queued[q] >= bi.size()) return false;
+		cubifyQueue.push(queued[q], widths[q], weights[q]);
+	}
+
+	return true;
+}
+
+lbool CubifyingSolver::emitCubeSplit()
+{
+	std::vector<Cube> leaves;
+	lbool status;
+	if (!cubifyAndSplit(emitCubes, leaves, status)) {
+		return status;
+	}
+
+	if (!writeCubes(cubeOut.c_str(), leaves)) {
+		printf("ERROR! Could not write cubes: %s\n", cubeOut.c_str());
+		exit(1);
+	}
+	if (verbosity > 0) {
+		printf("Wrote %d cubes (from %d in the queue) to %s\n", (int)leaves.size(), (int)cq.size(), cubeOut.c_str());
+	}
+	return l_Undef;
+}
+
+bool CubifyingSolver::cubifyAndSplit(int k, std::vector<Cube>& leaves, lbool& status)
+{
+	status = l_False;
+	if (!ok || !simplify()) return false;
+
+	bootstrap();
+
+	// Cubify every clause.
+	while (withinBudget() && canCubify()) {
+		if (cubifyOne() == l_False) return false;
+	}
+	if (!withinBudget()) {
+		status = l_Undef;
+		return false;
+	}
+	if (!simplify()) return false;
+
+	if (lookaheadSplit) {
+		splitLookahead(k, leaves);
+	}
+	else {
+		splitCubes(k, leaves);
+	}
+	return !leaves.empty();
+}
+
+Lit CubifyingSolver::pickSplitLiteral(const Cube& cube)
+{
+	if (lookaheadSplit) {
+		std::vector<double> prior;
+		splitPriors(prior);
+		Lit failed;
+		const Lit L = lookahead(cube, prior, failed);
+
+		// Splitting on a failed literal refutes one branch right away.
+		if (failed != lit_Undef) return failed;
+		if (L != lit_Undef) return L;
+	}
+
+	// The most active variable; failing that (e.g. before any search), the
+	// one whose both literals propagate the most, as in lookahead.
+	Var best = var_Undef;
+	double bestActivity = 0.0;
+	double bestProduct = 0.0;
+	for (Var v = 0; v < nVars(); ++v) {
+		if (!decision[v] || isEliminated(v) || value(v) != l_Undef) continue;
+		if (cube.contains(mkLit(v)) || cube.contains(~mkLit(v))) continue;
+
+		double product = 1.0;
+		for (auto L : { mkLit(v), ~mkLit(v) }) {
+			const int d = (L.x < (int)literalDifficulty.size()) ? literalDifficulty[L.x] : INT_MAX;
+			product *= (d == INT_MAX) ? 1.0 : (1.0 + d);
+		}
+
+		if (best == var_Undef || activity[v] > bestActivity
+			|| (activity[v] == bestActivity && product > bestProduct)) {
+			best = v;
+			bestActivity = activity[v];
+			bestProduct = product;
+		}
+	}
+
+	if (best == var_Undef) return lit_Undef;
+	return mkLit(best, polarity[best]);
+}
+
+uint64_t CubifyingSolver::problemHash() const
+{
+	uint64_t h = 1469598103934665603ULL;
+	auto mix = [&h](uint64_t x) {
+		h ^= x;
+		h *= 1099511628211ULL;
+	};
+
+	mix(nVars());
+	for (int i = 0; i < trail.size(); ++i) {
+		mix(toInt(trail[i]));
+	}
+	for (int i = 0; i < clauses.size(); ++i) {
+		const Clause& c = ca[clauses[i]];
+		for (int k = 0; k < c.size(); ++k) {
+			mix(toInt(c[k]));
+		}
+		mix(~0ULL);
+	}
+	return h;
+}
+
+bool CubifyingSolver::outOfBudget() const
+{
+	return !withinBudget();
+}
+
+void CubifyingSolver::splitCubes(int k, std::vector<Cube>& leaves)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	// Each applied cube adds at least one leaf, so there is no use in looking
+	// at more than k of them.
+	std::vector<Cube> best;
+	cq.peekBest(best, k, 0.0);
+
+	leaves.assign(1, Cube());
+	for (const auto& cube : best) {
+		// The literals that are not fixed at level 0.
+		Cube free;
+		bool falsified = false;
+		for (auto L : cube) {
+			if (value(L) == l_False) falsified = true;
+			else if (value(L) == l_Undef) free.push(L);
+		}
+		if (falsified || free.size() == 0) continue;
+
+		for (size_t l = 0; l < leaves.size(); ++l) {
+			const Cube leaf = leaves[l];
+
+			// The literals that would be new to the leaf.
+			std::vector<Lit> fresh;
+			bool compatible = true;
+			for (auto L : free) {
+				if (leaf.contains(~L)) compatible = false;
+				else if (!leaf.contains(L)) fresh.push_back(L);
+			}
+			if (!compatible || fresh.empty()) continue;
+			if (leaves.size() + fresh.size() > (size_t)k) continue;
+
+			// leaf & ~x1, leaf & x1 & ~x2, ..., leaf & x1 & ... & xn
+			Cube prefix = leaf;
+			for (auto L : fresh) {
+				Cube branch = prefix;
+				branch.push(~L);
+				leaves.push_back(branch);
+				prefix.push(L);
+			}
+			leaves[l] = prefix;
+		}
+	}
+
+	// Leave out the branches refuted by UP. (If none remain, the problem is
+	// UNSAT.)
+	size_t j = 0;
+	for (size_t l = 0; l < leaves.size(); ++l) {
+		if (leaves[l].size() > 0 && isConflicted(leaves[l])) continue;
+		leaves[j++] = leaves[l];
+	}
+	leaves.resize(j);
+}
+
+void CubifyingSolver::splitLookahead(int k, std::vector<Cube>& leaves)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	std::vector<double> prior;
+	splitPriors(prior);
+
+	int free = 0;
+	for (Var v = 0; v < nVars(); ++v) {
+		if (decision[v] && !isEliminated(v) && value(v) == l_Undef) free++;
+	}
+	const int root = trail.size();
+
+	struct Node
+	{
+		Cube cube;
+		int depth;
+		int assigned;
+	};
+
+	// A heap of the open nodes, the least reduced on top.
+	auto moreReduced = [](const Node& a, const Node& b) { return a.assigned > b.assigned; };
+	std::vector<Node> open = { { Cube(), 0, root } };
+	std::vector<Node> children;
+
+	leaves.clear();
+	uint64_t looked = 0;
+	uint64_t failures = 0;
+	while (!open.empty() && open.size() + leaves.size() < (size_t)k && withinBudget()) {
+		std::pop_heap(open.begin(), open.end(), moreReduced);
+		Node node = open.back();
+		open.pop_back();
+
+		if (node.depth >= splitDepth || node.assigned - root >= splitReduced * free) {
+			leaves.push_back(node.cube);
+			continue;
+		}
+
+		Lit failed;
+		const Lit L = lookahead(node.cube, prior, failed);
+		looked++;
+
+		children.clear();
+		if (failed != lit_Undef) {
+			failures++;
+			children.push_back(node);
+			children.back().cube.push(~failed);
+		}
+		else if (L != lit_Undef) {
+			for (auto B : { L, ~L }) {
+				children.push_back({ node.cube, node.depth + 1, 0 });
+				children.back().cube.push(B);
+			}
+		}
+		else {
+			leaves.push_back(node.cube);
+			continue;
+		}
+
+		for (auto& child : children) {
+			child.assigned = assignedUnder(child.cube);
+			if (child.assigned < 0) continue;
+
+			open.push_back(child);
+			std::push_heap(open.begin(), open.end(), moreReduced);
+		}
+	}
+	for (const auto& node : open) {
+		leaves.push_back(node.cube);
+	}
+
+	if (verbosity > 0) {
+		printf("Lookahead split: %" PRIu64 " nodes, %" PRIu64 " failed literals, %d leaves\n",
+			looked, failures, (int)leaves.size());
+	}
+}
+
+void CubifyingSolver::splitPriors(std::vector<double>& prior) const
+{
+	prior.assign(nVars(), 1.0);
+	for (Var v = 0; v < nVars(); ++v) {
+		for (auto L : { mkLit(v), ~mkLit(v) }) {
+			const int d = (L.x < (int)literalDifficulty.size()) ? literalDifficulty[L.x] : INT_MAX;
+			if (d != INT_MAX) prior[v] *= 1.0 + d;
+		}
+	}
+
+	std::vector<Cube> best;
+	cq.peekBest(best, 256, 0.0);
+
+	std::vector<double> share(nVars(), 0.0);
+	double total = 0.0;
+	for (const auto& cube : best) {
+		const double score = cq.scoreOf(cube);
+		for (auto L : cube) share[var(L)] += score;
+		total += score;
+	}
+	if (total <= 0.0) return;
+
+	for (Var v = 0; v < nVars(); ++v) {
+		prior[v] *= 1.0 + share[v] / total;
+	}
+}
+
+Lit CubifyingSolver::lookahead(const Cube& cube, const std::vector<double>& prior, Lit& failed)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	failed = lit_Undef;
+
+	newProbeLevel();
+	bool conflict = false;
+	for (auto L : cube) {
+		if (!enqueue(L)) {
+			conflict = true;
+			break;
+		}
+	}
+	if (conflict || propagate() != CRef_Undef) {
+		cancelProbe(0);
+		return lit_Undef;
+	}
+	const int base = trail.size();
+
+	std::vector<Var> candidates;
+	for (Var v = 0; v < nVars(); ++v) {
+		if (decision[v] && !isEliminated(v) && value(v) == l_Undef) candidates.push_back(v);
+	}
+	if (candidates.size() > (size_t)splitCandidates) {
+		std::partial_sort(candidates.begin(), candidates.begin() + splitCandidates, candidates.end(),
+			[&](Var x, Var y) { return prior[x] > prior[y]; });
+		candidates.resize(splitCandidates);
+	}
+
+	Lit best = lit_Undef;
+	double bestScore = -1.0;
+	for (Var v : candidates) {
+		int growth[2];
+		for (int s = 0; s < 2; ++s) {
+			const Lit L = mkLit(v, s);
+			newProbeLevel();
+			enqueue(L);
+			const bool fails = (propagate() != CRef_Undef);
+			growth[s] = trail.size() - base;
+			cancelProbe(1);
+
+			if (fails) {
+				failed = L;
+				cancelProbe(0);
+				return lit_Undef;
+			}
+		}
+
+		const double score = 1024.0 * growth[0] * growth[1] + growth[0] + growth[1];
+		if (score > bestScore) {
+			best = mkLit(v, growth[1] > growth[0]);
+			bestScore = score;
+		}
+	}
+
+	cancelProbe(0);
+	return best;
+}
+
+int CubifyingSolver::assignedUnder(const Cube& cube)
+{
+	newProbeLevel();
+	bool conflict = false;
+	for (auto L : cube) {
+		if (!enqueue(L)) {
+			conflict = true;
+			break;
+		}
+	}
+	if (!conflict) conflict = (propagate() != CRef_Undef);
+
+	const int assigned = trail.size();
+	cancelProbe(0);
+	return conflict ? -1 : assigned;
+}
+
+bool CubifyingSolver::writeCubes(const char* path, const std::vector<Cube>& cubes)
+{
+	FILE* f = fopen(path, "w");
+	if (f == NULL) return false;
+
+	auto writeLit = [&](Lit L) {
+		fprintf(f, "%s%d ", sign(L) ? "-" : "", var(L) + 1);
+	};
+
+	fprintf(f, "p inccnf\n");
+	for (int i = 0; i < trail.size(); ++i) {
+		writeLit(trail[i]);
+		fprintf(f, "0\n");
+	}
+	for (int i = 0; i < clauses.size(); ++i) {
+		const Clause& c = ca[clauses[i]];
+		if (satisfied(c)) continue;
+
+		for (int k = 0; k < c.size(); ++k) {
+			if (value(c[k]) != l_False) writeLit(c[k]);
+		}
+		fprintf(f, "0\n");
+	}
+	for (const auto& cube : cubes) {
+		fprintf(f, "a ");
+		for (auto L : cube) writeLit(L);
+		fprintf(f, "0\n");
+	}
+
+	return (fclose(f) == 0);
+}
+
+void CubifyingSolver::garbageCollect()
+{
+	// While elimination is on, removed clauses stay in the clause vector
+	// until now.
+	if (use_simplification) unindexRemovedClauses();
+
+	CubifyingSolverBase::garbageCollect();
+
+	if (use_simplification || bi.dead() < 65536 || bi.dead() < clauses.size()) return;
+
+	compactClauseIndices();
 }
 
-CubifyingSolver::~CubifyingSolver()
+void CubifyingSolver::collectRegions(int n)
 {
+	CubifyingSolverBase::collectRegions(n);
+
+	if (bi.dead() < 65536 || bi.dead() < clauses.size()) return;
+
+	compactClauseIndices();
 }
 
-bool CubifyingSolver::pickCube(Cube& cube)
+void CubifyingSolver::compactClauseIndices()
 {
-	if (cq.empty()) {
-		return false;
-	}
-	else if (cq.bestScore() < (k_t * cq.meanScore())) {
-		return false;
+	const auto remap = bi.compact();
+	cq.remapParentInds(remap);
+
+	// Persistent indices keep their order, so the ones that bootstrap() has
+	// seen are still the lowest ones.
+	int survivors = 0;
+	for (int j = 0; j < bootstrapped && j < (int)remap.size(); ++j) {
+		if (remap[j] >= 0) survivors++;
 	}
-	else {
-		cube = cq.peekBest(irand(random_seed, 1000000));
-		return true;
+	bootstrapped = survivors;
+
+	for (auto& d : deferred) {
+		size_t n = 0;
+		for (auto j : d.parents) {
+			int r = (j >= 0 && j < remap.size()) ? remap[j] : -1;
+			if (r >= 0) d.parents[n++] = r;
+		}
+		d.parents.resize(n);
 	}
+
+	cubifyQueue.remap(remap);
 }
 
-lbool CubifyingSolver::refuteCube(const Cube& base, const Cube& reduced)
+void CubifyingSolver::getQueueStats(QueueStats& q) const
 {
-#ifndef NO_CS_ASSERTS
-	assert(cq.contains(base));
-#endif
+	q.cubes = cq.size();
+	q.bestScore = cq.bestScore();
+	q.meanScore = cq.meanScore();
+	q.cubifyQueue = cubifyQueue.live();
+	q.threshold = k_t;
+}
 
-	auto ii = cq.getParentInds(base);
-	cq.pop(base);
+bool CubifyingSolver::canCubify() const
+{
+	return cubifyQueue.live() > 0;
+}
 
-	for (auto i : ii) {
-		int j = bi.fw(i);
-		if (j >= 0) {
-			dropClause(j);
-		}
-	}
+void CubifyingSolver::queueForCubify(int j)
+{
+	if (cubifyDisabled) return;
 
-	if (!ci.contains(reduced)) {
-		cubifyQueue.push_back(clauses.size());
-		learnNegationOf(reduced);
-		ci.push(reduced);
+	const Clause& clause = ca[clauses[bi.fw(j)]];
+
+	// Literals that have not been propagated alone yet do not count.
+	double weight = 0.0;
+	for (int k = 0; k < clause.size(); ++k) {
+		const Lit L = ~clause[k];
+		if (L.x < literalDifficulty.size() && literalDifficulty[L.x] != INT_MAX) {
+			weight += literalDifficulty[L.x];
+		}
 	}
 
-	return ok ? l_Undef : l_False;
+	cubifyQueue.push(j, clause.size(), weight);
 }
 
-bool CubifyingSolver::pruneClause(const int i, const Cube& C)
+size_t CubifyingSolver::cubeMemory() const
 {
-	dropClause(i);
-	if (!ci.contains(C)) {
-		Minisat::vec<Lit> v;
-		C.invert(v);
-		return addClause_(v);
-	}
+	return cq.memoryUsage()
+		+ ci.memoryUsage()
+		+ cubifyQueue.memoryUsage()
+		+ bi.memoryUsage()
+		+ literalDifficulty.capacity() * sizeof(int);
 }
 
-void CubifyingSolver::bootstrap()
+bool CubifyingSolver::overMemoryBudget() const
 {
-#ifndef NO_CS_ASSERTS
-	assert(decisionLevel() == 0);
-#endif
+	return (memoryBudget > 0) && (cubeMemory() > memoryBudget);
+}
 
-	cubifyQueue.reserve(clauses.size());
-	for (int i = 0; i < clauses.size(); ++i) {
-		cubifyQueue.push_back(bi.bw(i));
+void CubifyingSolver::purgeMemory()
+{
+	memoryPurges++;
+	const size_t before = cubeMemory();
+
+	// Give up the worse half of the cube queue, and release what the
+	// structures hold on to for removed entries.
+	cq.evictWorst(cq.size() / 2);
+	cq.shrink();
+	ci.shrink();
+	cubifyQueue.shrink();
+	// As in garbageCollect(), the ids stay as they are while elimination
+	// is on.
+	if (!use_simplification && bi.dead() > 0) {
+		compactClauseIndices();
 	}
 
-	literalDifficulty.resize(2 * nVars(), INT_MAX);
-}
+	// If that was not enough, stop cubifying for good. The default search
+	// goes on, and so does the search in the cubes that are left.
+	if (overMemoryBudget()) {
+		cubifyDisabled = true;
+		cubifyQueue.clear();
+	}
 
-bool CubifyingSolver::canCubify() const
-{
-	for (const auto j : cubifyQueue) {
-		if (bi.fw(j) >= 0) {
-			return true;
-		}
+	if (verbosity >= 1) {
+		printf("| Cube memory over budget: %.2f MB -> %.2f MB%s\n",
+			before / (1024.0 * 1024.0), cubeMemory() / (1024.0 * 1024.0),
+			cubifyDisabled ? ", cubification disabled" : "");
 	}
-	return false;
 }
 
 lbool CubifyingSolver::cubifyOne()
 {
-	while (!cubifyQueue.empty()) {
-		int j = cubifyQueue.back();
-		cubifyQueue.pop_back();
+	cq.setEpoch(scoreEpoch());
 
-		int i = bi.fw(j);
-		if (i >= 0) {
-			return cubify(i);
-		}
+	if (overMemoryBudget()) {
+		purgeMemory();
+		if (cubifyDisabled) return l_Undef;
 	}
-return l_Undef;
+
+	if (cubifyThreads > 1) {
+		return cubifyParallel(cubifyThreads * CubifyTasksPerThread);
+	}
+	if (cubifyBatch > 1) {
+		return cubifyMany(cubifyBatch);
+	}
+
+	int j = cubifyQueue.pop();
+	if (j >= 0) {
+		return cubify(bi.fw(j));
+	}
+	return l_Undef;
 }
 
 lbool CubifyingSolver::cubify(const int i)
+{
+	Cube root;
+	lbool status;
+	if (!prepareCubify(i, root, status)) {
+		return status;
+	}
+
+	// Cubify the clause, unless it's unit under UP.
+	//
+	// If a subsumption is found, immediately replace the clause with
+	// the reduced clause and enqueue the child for cubification.
+	Cube post = cubifyInternal(i, root);
+
+	return finishCubify(i, post);
+}
+
+bool CubifyingSolver::prepareCubify(const int i, Cube& root, lbool& status)
 {
 #ifndef NO_CS_ASSERTS
 	assert(ok);
@@ -148,15 +1905,18 @@ lbool CubifyingSolver::cubify(const int i)
 	CRef cr = clauses[i];
 	const Clause& clause = ca[cr];
 
+	cubifications++;
+	status = l_Undef;
+
 	// Reduce the clause to a minimal conflicting cube (minimal in a weak sense).
-	Cube root;
+	root.clear();
 	for (int k = 0; k < clause.size(); ++k) {
 		auto L = clause[k];
 		auto v = value(L);
 
 		if (v == l_True) {
 			// If the literal is true, the clause is satisfied.
-			return l_Undef;
+			return false;
 		}
 		else if (v == l_False) {
 			// If the literal is false, it need not be included.
@@ -171,9 +1931,9 @@ lbool CubifyingSolver::cubify(const int i)
 	// possible).
 	if (root.size() > maxCubifiableSize) {
 		if (root.size() < clause.size()) {
-			return pruneClause(i, root) ? l_Undef : l_False;
+			status = pruneClause(i, root) ? l_Undef : l_False;
 		}
-		return l_Undef;
+		return false;
 	}
 
 	// if (root.size() == 1) return refuteCube(root, root);
@@ -185,11 +1945,12 @@ lbool CubifyingSolver::cubify(const int i)
 	assert(isConflicted(root));
 #endif
 
-	// Cubify the clause, unless it's unit under UP.
-	//
-	// If a subsumption is found, immediately replace the clause with
-	// the reduced clause and enqueue the child for cubification.
-	Cube post = cubifyInternal(i, root);
+	return true;
+}
+
+lbool CubifyingSolver::finishCubify(const int i, const Cube& post)
+{
+	const Clause& clause = ca[clauses[i]];
 
 	// Special case: an empty postcube indicates that the clause under inspection
 	// is subsumed by another problem clause.
@@ -200,12 +1961,12 @@ lbool CubifyingSolver::cubify(const int i)
 
 #ifndef NO_CS_ASSERTS
 	// Sanity checks.
-	assert(post.subsetOf(root));
 	assert(isConflicted(post));
 #endif
 
 	if (post.size() < clause.size())
 	{
+		if (post.size() == 1 || !ci.contains(post)) proofNegationOf(post);
 		dropClause(i);
 
 		if (post.size() == 1)
@@ -219,11 +1980,12 @@ lbool CubifyingSolver::cubify(const int i)
 		}
 		else {
 			if (!ci.contains(post)) {
-				cubifyQueue.push_back(clauses.size());
+				const int n = clauses.size();
 
 				vec<Lit> v;
 				post.invert(v);
 				addClause_(v);
+				if (clauses.size() > n) queueForCubify(bi.bw(n));
 
 				ci.push(post);
 			}
@@ -233,6 +1995,304 @@ lbool CubifyingSolver::cubify(const int i)
 	return ok ? l_Undef : l_False;
 }
 
+lbool CubifyingSolver::cubifyMany(int n)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	// Dequeue up to n clauses that are still to be cubified.
+	std::vector<BatchClause> batch;
+	while (batch.size() < n) {
+		int j = cubifyQueue.pop();
+		if (j < 0) break;
+
+		int i = bi.fw(j);
+
+		BatchClause bc;
+		bc.id = j;
+
+		lbool status;
+		if (!prepareCubify(i, bc.root, status)) {
+			if (status != l_Undef) return status;
+			continue;
+		}
+
+		batch.push_back(bc);
+	}
+
+	// Order the literals the same way in every clause, so that equal prefixes
+	// get merged in the trie. All the clauses are sorted before the walk,
+	// which updates the difficulties.
+	const std::vector<int>& difficulty = literalDifficulty;
+	auto before = [&](const Lit& lhs, const Lit& rhs) {
+		if (difficulty[lhs.x] != difficulty[rhs.x]) {
+			return difficulty[lhs.x] > difficulty[rhs.x];
+		}
+		return lhs < rhs;
+	};
+
+	trie.clear();
+	trie.push_back(TrieNode());
+	for (int b = 0; b < batch.size(); ++b) {
+		auto& bc = batch[b];
+		std::vector<Lit> c(bc.root.begin(), bc.root.end());
+		std::sort(c.begin(), c.end(), before);
+		insertCubifyPaths(b, c, bc);
+	}
+
+	// Walk the trie, collecting the conflicts found into the batch.
+	batchTrail0 = trail.size();
+	Cube cube;
+	for (auto k : trie[0].children) {
+		walkCubifyTrie(k, cube, batch);
+	}
+
+	// Apply the outcome to each clause, in order.
+	for (auto& bc : batch) {
+		int i = bi.fw(bc.id);
+		if (i < 0) continue;
+
+		// A clause added earlier in the batch may have assigned literals of
+		// this outcome. If so, it is cubified again later on.
+		bool stale = false;
+		for (auto L : bc.post) {
+			if (value(L) != l_Undef) stale = true;
+		}
+		if (stale) {
+			queueForCubify(bc.id);
+			continue;
+		}
+
+		auto status = finishCubify(i, bc.subsumed ? Cube() : bc.post);
+		if (status != l_Undef) return status;
+	}
+
+	return ok ? l_Undef : l_False;
+}
+
+lbool CubifyingSolver::cubifyParallel(int n)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	// Dequeue up to n clauses, and plan their paths on the master, since that
+	// reads (and updates) the cube queue and the index.
+	std::vector<CubifyWorker::Task> tasks;
+	while (tasks.size() < n) {
+		int j = cubifyQueue.pop();
+		if (j < 0) break;
+
+		int i = bi.fw(j);
+
+		CubifyWorker::Task task;
+		task.id = j;
+
+		lbool status;
+		if (!prepareCubify(i, task.root, status)) {
+			if (status != l_Undef) return status;
+			continue;
+		}
+
+		task.subsumed = !makeCubifyPathDifficultyOrder(task.root, task.path, i);
+		tasks.push_back(std::move(task));
+	}
+	if (tasks.empty()) return ok ? l_Undef : l_False;
+
+	// Bring the workers up to date, as in searchCubeBranches().
+	const int m = std::min<int>(cubifyThreads, tasks.size());
+	for (auto& w : cubifyWorkers) {
+		w->sync(*this, cubifyBroadcast);
+	}
+	cubifyBroadcast.clear();
+	while (cubifyWorkers.size() < m) {
+		cubifyWorkers.emplace_back(new CubifyWorker(cubifyWorkers.size()));
+		cubifyWorkers.back()->load(*this);
+	}
+
+	// Walk the paths. The tasks are dealt out in a fixed pattern, so that
+	// the outcome does not depend on the timing of the threads.
+	std::vector<CubifyWorker::Result> results(tasks.size());
+	std::vector<uint64_t> propagations0(m);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < m; ++t) {
+		CubifyWorker* w = cubifyWorkers[t].get();
+		propagations0[t] = w->propagations;
+		threads.emplace_back([w, &tasks, &results, t, m]() { w->walk(tasks, results, t, m); });
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	for (int t = 0; t < m; ++t) {
+		propagations += cubifyWorkers[t]->propagations - propagations0[t];
+	}
+
+	// Apply the outcome to each clause, in order, as in cubifyMany().
+	for (int k = 0; k < tasks.size(); ++k) {
+		const auto& task = tasks[k];
+		const auto& result = results[k];
+
+		for (const auto& s : result.scored) {
+			cq.push(s.first, s.second, task.id);
+		}
+		for (const auto& d : result.difficulties) {
+			literalDifficulty[d.first.x] = d.second;
+		}
+		scoredImplicants += result.implicants;
+
+		int i = bi.fw(task.id);
+		if (i < 0) continue;
+
+		bool stale = false;
+		for (auto L : result.post) {
+			if (value(L) != l_Undef) stale = true;
+		}
+		if (stale) {
+			queueForCubify(task.id);
+			continue;
+		}
+
+		auto status = finishCubify(i, task.subsumed ? Cube() : result.post);
+		if (status != l_Undef) return status;
+	}
+
+	return ok ? l_Undef : l_False;
+}
+
+void CubifyingSolver::insertCubifyPaths(int b, const std::vector<Lit>& C, BatchClause& bc)
+{
+	const int N = C.size();
+	const int pid = bc.id;
+	bc.post = bc.root;
+
+	// As in makeCubifyPath(): each i corresponds to the terminal C \ C[i].
+	// A terminal with a known score need not be walked again.
+	std::vector<int> terminals;
+	for (int i = 0; i < N; ++i) {
+		Cube terminal;
+		for (int j = 0; j < N; ++j) {
+			if (j != i) terminal.push(C[j]);
+		}
+
+		if (cq.contains(terminal)) {
+			cq.addParentInd(terminal, pid);
+		}
+		else {
+			terminals.push_back(i);
+		}
+	}
+
+	// If the negation of some prefix is a problem clause already, that clause
+	// subsumes this one.
+	for (auto i : terminals) {
+		Cube cube;
+		for (int j = 0; j < N; ++j) {
+			if (j == i) continue;
+			cube.push(C[j]);
+			if (ci.contains(cube)) {
+				bc.subsumed = true;
+				return;
+			}
+		}
+	}
+
+	for (auto i : terminals) {
+		int node = 0;
+		for (int j = 0; j < N; ++j) {
+			if (j == i) continue;
+
+			int next = -1;
+			for (auto k : trie[node].children) {
+				if (trie[k].lit == C[j]) {
+					next = k;
+					break;
+				}
+			}
+			if (next < 0) {
+				next = trie.size();
+				trie.push_back(TrieNode());
+				trie[next].lit = C[j];
+				trie[node].children.push_back(next);
+			}
+
+			node = next;
+			auto& owners = trie[node].owners;
+			if (owners.empty() || owners.back() != b) {
+				owners.push_back(b);
+			}
+		}
+	}
+}
+
+void CubifyingSolver::walkCubifyTrie(int k, Cube& cube, std::vector<BatchClause>& batch)
+{
+	const TrieNode& node = trie[k];
+
+	// Skip the subtree, if every clause below has an outcome already.
+	bool open = false;
+	for (auto b : node.owners) {
+		if (!batch[b].subsumed && !batch[b].conflicted) open = true;
+	}
+	if (!open) return;
+
+	const Lit L = node.lit;
+	newProbeLevel();
+	auto v = value(L);
+
+	// The three cases are as in cubifyInternal().
+	bool conflict = false;
+	bool pushed = false;
+	if (v == l_False) {
+		cube.push(L);
+		pushed = true;
+		conflict = true;
+	}
+	else if (v == l_Undef) {
+		auto propagationsBefore = propagations;
+
+		cube.push(L);
+		pushed = true;
+		enqueue(L);
+		if (propagate() != CRef_Undef) {
+			conflict = true;
+		}
+		else {
+			if (cube.size() == 1) {
+				literalDifficulty[L.x] = propagations - propagationsBefore;
+			}
+
+			scoredImplicants++;
+			double num = trail.size() - batchTrail0;
+			double den = cube.size();
+			double score = num / den;
+			if (score > 1.0) {
+				for (auto b : node.owners) {
+					cq.push(cube, score, batch[b].id);
+				}
+			}
+		}
+	}
+
+	if (conflict) {
+		for (auto b : node.owners) {
+			auto& bc = batch[b];
+			if (!bc.subsumed && !bc.conflicted) {
+				bc.conflicted = true;
+				bc.post = cube;
+			}
+		}
+	}
+	else {
+		for (auto c : node.children) {
+			walkCubifyTrie(c, cube, batch);
+		}
+	}
+
+	cancelProbe(decisionLevel() - 1);
+	if (pushed) cube.pop(L);
+}
+
 bool CubifyingSolver::makeCubifyPathBasic(const Cube& C, std::vector<Lit>& path)
 {
 	std::vector<Lit> c(C.begin(), C.end());
@@ -328,6 +2388,125 @@ bool CubifyingSolver::makeCubifyPath(const std::vector<Lit>& C, std::vector<Lit>
 }
 
 Cube CubifyingSolver::cubifyInternal(const int i, const Cube& root)
+{
+	static_assert(MaxFixedCubifyWidth == 8, "cubifyInternal() dispatches up to width 8");
+	switch (root.size()) {
+	case 2: return cubifyFixed<2>(i, root);
+	case 3: return cubifyFixed<3>(i, root);
+	case 4: return cubifyFixed<4>(i, root);
+	case 5: return cubifyFixed<5>(i, root);
+	case 6: return cubifyFixed<6>(i, root);
+	case 7: return cubifyFixed<7>(i, root);
+	case 8: return cubifyFixed<8>(i, root);
+	default: return cubifyGeneric(i, root);
+	}
+}
+
+template<int W>
+Cube CubifyingSolver::cubifyFixed(const int i, const Cube& root)
+{
+	const Lit* R = root.begin();
+
+	// As in makeCubifyPathDifficultyOrder(): the literals whose terminals
+	// have a score go in front (k of them), the rest after them from
+	// predicted-hardest to predicted-easiest. The root is sorted, so each
+	// terminal is the root with one index left out.
+	Lit c[W];
+	int k = 0;
+	int iNextNormal = W - 1;
+	for (int l = 0; l < W; ++l) {
+		Cube term;
+		for (int m = 0; m < W; ++m) {
+			if (m != l) term.push(R[m]);
+		}
+
+		if (cq.contains(term)) {
+			cq.addParentInd(term, bi.bw(i));
+			c[k++] = R[l];
+		}
+		else {
+			c[iNextNormal--] = R[l];
+		}
+	}
+	std::sort(c + k, c + W, [&](const Lit& lhs, const Lit& rhs) {
+			return literalDifficulty[lhs.x] > literalDifficulty[rhs.x]; });
+
+	const CubifyPlan<W>& plan = CubifyPath<W>::plans.plan[k];
+
+	// As in makeCubifyPath(): give up if some prefix is a problem clause.
+	Cube cube;
+	Lit stack[W];
+	int top = 0;
+	for (int s = 0; s < plan.size; ++s) {
+		const int8_t step = plan.step[s];
+		if (step == CubifyCancel) {
+			cube.pop(stack[--top]);
+			continue;
+		}
+		stack[top++] = c[step];
+		cube.push(c[step]);
+		if (ci.contains(cube)) return Cube();
+	}
+
+	int level0 = decisionLevel();
+	int trail0 = trail.size();
+
+	// As in cubifyGeneric().
+	cube.clear();
+	top = 0;
+	bool conflict = false;
+	for (int s = 0; s < plan.size; ++s) {
+		const int8_t step = plan.step[s];
+		if (step == CubifyCancel) {
+			cube.pop(stack[--top]);
+			cancelProbe(decisionLevel() - 1);
+			continue;
+		}
+
+		const Lit L = c[step];
+		stack[top++] = L;
+		newProbeLevel();
+		auto v = value(L);
+
+		if (v == l_False) {
+			cube.push(L);
+			conflict = true;
+			break;
+		}
+		else if (v == l_True) {
+			continue;
+		}
+		else {
+			auto propagationsBefore = propagations;
+
+			cube.push(L);
+			enqueue(L);
+			if (propagate() != CRef_Undef) {
+				conflict = true;
+				break;
+			}
+
+			if (cube.size() == 1) {
+				literalDifficulty[L.x] = propagations - propagationsBefore;
+			}
+
+			scoredImplicants++;
+			double num = trail.size() - trail0;
+			double den = cube.size();
+			double score = num / den;
+			if (score > 1.0) {
+				cq.push(cube, score, bi.bw(i));
+			}
+		}
+	}
+
+	cancelProbe(level0);
+
+	if (conflict) return cube;
+	return root;
+}
+
+Cube CubifyingSolver::cubifyGeneric(const int i, const Cube& root)
 {
 	std::vector<Lit> path;
 	auto pathOk = makeCubifyPathDifficultyOrder(root, path, i);
@@ -345,13 +2524,13 @@ Cube CubifyingSolver::cubifyInternal(const int i, const Cube& root)
 		if (L == lit_Undef) {
 			cube.pop(stack.back());
 			stack.pop_back();
-			cancelUntil(decisionLevel() - 1);
+			cancelProbe(decisionLevel() - 1);
 		}
 
 		// Push literal L
 		else {
 			stack.push_back(L);
-			newDecisionLevel();
+			newProbeLevel();
 			auto v = value(L);
 
 			// Case 1:
@@ -387,6 +2566,7 @@ Cube CubifyingSolver::cubifyInternal(const int i, const Cube& root)
 					literalDifficulty[L.x] = propagations - propagationsBefore;
 				}
 
+				scoredImplicants++;
 				double num = trail.size() - trail0;
 				double den = cube.size();
 				double score = num / den;
@@ -398,7 +2578,7 @@ Cube CubifyingSolver::cubifyInternal(const int i, const Cube& root)
 	}
 
 	// Done going through the path; unwind the stack.
-	cancelUntil(level0);
+	cancelProbe(level0);
 
 	// If a subsumption was found, return it.
 	if (conflict) return cube;
@@ -412,4 +2592,9 @@ double CubifyingSolver::meanScore() const
 	return cq.meanScore();
 }
 
+size_t CubifyingSolver::indexMemory() const
+{
+	return ci.memoryUsage();
+}
+
 } // namespace Minisat
@@ -20,12 +20,16 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef CubifyingSolverH
 #define CubifyingSolverH
 
+#include <string>
 #include <unordered_set>
 #include <unordered_map>
 
 #include "CubifyingSolverBase.h"
+#include "CubifyWorker.h"
 #include "CubeIndex.h"
 #include "CubeQueue.h"
+#include "CubifyQueue.h"
+#include "PhaseBandit.h"
 #include "Cube.h"
 
 namespace Minisat
@@ -39,6 +43,87 @@ public:
 
 	double meanScore() const;
 
+    // Bytes in use by the index of learnt cube negations.
+	size_t indexMemory() const;
+
+    // Bytes in use by the cube queue, the index, the cubification queue and
+    // the clause indices; this is what memoryBudget limits.
+	size_t cubeMemory() const;
+
+    // Write the cube queue and the literal difficulties to scoreCache, if it
+    // is set. Returns false if the file could not be written.
+	bool saveScoreCache() const;
+
+    // Number of cubes taken from scoreCache.
+	int cachedCubes = 0;
+
+    // Also restores the cube queue, the index, the cubification queue, the
+    // literal difficulties and the adaptive parameters (but not the history
+    // of the bandit, which starts over).
+	bool loadCheckpoint(SnapshotReader& in) override;
+
+    // Cube-and-conquer export, instead of solving: cubify every clause, split
+    // the search space into at most emitCubes cubes (along the best cubes in
+    // the queue, or by lookahead), and write the simplified problem and the cubes to cubeOut
+    // as iCNF. Returns l_False if the problem turned out to be UNSAT on the
+    // way, and l_Undef otherwise.
+	lbool emitCubeSplit();
+
+    // The first half of emitCubeSplit(): cubify every clause, and split the
+    // search space into at most k leaves (see splitCubes() and
+    // splitLookahead()). Returns false if
+    // there are no leaves; then, status is l_False if the problem is UNSAT,
+    // or l_Undef if the solver was interrupted.
+	bool cubifyAndSplit(int k, std::vector<Cube>& leaves, lbool& status);
+
+    // A good literal for splitting the cube in two, or lit_Undef if every
+    // variable is assigned or in the cube. Must be at decision level 0.
+	Lit pickSplitLiteral(const Cube&);
+
+    // Fingerprint of the problem clauses and units, e.g. to check that two
+    // processes have read and simplified the same problem.
+	uint64_t problemHash() const;
+
+    // Has the solver been interrupted, or run out of its budget?
+	bool outOfBudget() const;
+
+    // Counter: how many implicant cubes have been scored in cubification?
+	uint64_t scoredImplicants = 0;
+
+    // Counter: how many stale cubes have been re-scored (see rescoreAfter)?
+	uint64_t cubeRescores = 0;
+
+    // Counter: how many times has the cube memory gone over memoryBudget?
+	uint64_t memoryPurges = 0;
+
+    // Set once cubification has been switched off, to stay within
+    // memoryBudget.
+	bool cubifyDisabled = false;
+
+    // Counter: how many times has the solver been bootstrapped, i.e. how many
+    // calls to interleavedSolve() have there been?
+	uint64_t solveCalls = 0;
+
+    // Counter: how many cubes have been set aside until the next call, as
+    // refuted only under the assumptions of the caller?
+	uint64_t cubesDeferred = 0;
+
+    // Counters of inprocessing (see probeInterval): rounds, units found by
+    // probing, hyper-binary resolvents learnt, variables substituted by
+    // equivalent literals, and binary clauses removed as transitive.
+	uint64_t probeRounds = 0;
+	uint64_t probeUnits = 0;
+	uint64_t hyperBinaries = 0;
+	uint64_t substitutedVars = 0;
+	uint64_t transitiveRemoved = 0;
+
+    // Counters of elimination rounds (see elimInterval): rounds, variables
+    // eliminated, resolvents added, and problem clauses removed.
+	uint64_t elimRounds = 0;
+	uint64_t elimVars = 0;
+	uint64_t elimResolvents = 0;
+	uint64_t elimRemoved = 0;
+
 public:
     // Only search inside cubes that are at least k_t times as dense as the
     // mean density seen so far.
@@ -47,29 +132,273 @@ public:
     // Only cubify clauses of this size or smaller.
     int maxCubifiableSize = 6;
 
+    // If greater than one, cubify this many clauses at a time: the paths of
+    // all the clauses are merged into one trie, so that a prefix shared by
+    // several clauses is only propagated once.
+    int cubifyBatch = 1;
+
+    // If greater than one, cubify on this many threads: the master plans the
+    // paths of a round of clauses, CubifyWorker clones of the solver walk
+    // them, and the master applies the outcomes in order. Takes precedence
+    // over cubifyBatch.
+    int cubifyThreads = 1;
+
+    // If positive, a cube is only searched if its score is fresh: if more
+    // than this many units have been found at level 0 since the cube was
+    // scored, the cube is propagated again and re-scored (or refuted, or
+    // dropped) instead.
+    int rescoreAfter = 0;
+
+    // Bytes that cubeMemory() may take up. If zero at the first bootstrap(),
+    // it is set to memoryShare of the memory limit (see -mem-lim), if any.
+    // Once over the budget, the worse half of the cube queue is evicted and
+    // the structures are compacted; if that is not enough, cubification is
+    // switched off, while the search goes on.
+    size_t memoryBudget = 0;
+    double memoryShare = 0.5;
+
+    // If set, k_c, k_q and k_t are tuned while solving, by the measured
+    // payoff of the cube phases (see onStep()).
+    bool adaptive = false;
+
+    // If positive, emitCubeSplit() is used instead of interleavedSolve(),
+    // and writes this many cubes (at most) to cubeOut.
+    int emitCubes = 0;
+    std::string cubeOut;
+
+    // If set, the split of emitCubeSplit() and of the coordinator is a tree
+    // built by lookahead (see splitLookahead()), and so are the later splits
+    // of pickSplitLiteral(). A node is a leaf at depth splitDepth, or once
+    // splitReduced of the variables free at the root are assigned under it.
+    // At each node, the splitCandidates variables of best prior are looked
+    // ahead on.
+    bool lookaheadSplit = false;
+    int splitDepth = 32;
+    double splitReduced = 0.5;
+    int splitCandidates = 32;
+
+    // Distributed cube-and-conquer (see CubeConquer.h): if servePort is
+    // set, serve cubes to workers on this TCP port, starting from a split
+    // into at most serveCubes cubes, and searching each for at most
+    // conquerBudget conflicts at a time; if connectTo is set, work for the
+    // coordinator at this "host:port".
+    int servePort = 0;
+    int serveCubes = 64;
+    int conquerBudget = 10000;
+    std::string connectTo;
+
+    // If set, the cube queue is warm-started from this file in bootstrap(),
+    // and saveScoreCache() writes it back there. Cubes whose parent clauses
+    // are gone, or which are decided at level 0, are dropped when loading;
+    // the parent clauses of the rest are not cubified again. A cache written
+    // for another problem (by problemHash()) is ignored.
+    std::string scoreCache;
+
+    // If positive, inprocess every probeInterval steps (see inprocess()).
+    // A round may spend probeEffort times the propagations made since the
+    // previous round on probing, and as many steps on transitive reduction.
+    int probeInterval = 0;
+    double probeEffort = 0.1;
+
+    // If positive, run variable elimination and subsumption again every
+    // elimInterval steps, or once elimUnits units have been found since the
+    // previous round, as inprocessing. A round is skipped if the problem
+    // clauses have more than elimOccLimit literals, for which it would build
+    // occurrence lists.
+    int elimInterval = 0;
+    int elimUnits = 0;
+    int elimOccLimit = 10000000;
+
 protected:
     // Pick the best cube in the queue, but only if it is dense enough (see
-    // the k_t parameter above).
+    // the k_t parameter above). Stale cubes are re-scored on the way.
 	virtual bool pickCube(Cube&) override;
 
+    // Pick up to n of the best cubes in the queue, subject to the same
+    // density threshold as pickCube().
+	virtual int pickCubes(std::vector<Cube>&, int n) override;
+
+    // Number of units at level 0; the epoch of the scores in the queue.
+	uint64_t scoreEpoch() const;
+
+    // Has the score of the queued cube been computed before the last
+    // rescoreAfter units?
+	bool isStale(const Cube&) const;
+
+    // Propagate the queued cube again at level 0, and update its score. If
+    // the cube is now conflicting, refute it; if it is falsified or implied
+    // at level 0, or no longer dense, just remove it.
+	lbool rescoreCube(const Cube&);
+
     // Remove the base cube from the queue. If the negation of the reduced
     // cube is a new clause, learn it and pass it on as a cubification
     // candidate.
 	virtual lbool refuteCube(const Cube&, const Cube&) override;
 
+    // Sizes and scores of the cube queue and the cubification queue.
+	virtual void getQueueStats(QueueStats&) const override;
+
     // Can cubify if there are clauses in the queue.
 	virtual bool canCubify() const override;
 
-    // Dequeue and cubify() a single clause.
+    // Dequeue and cubify() a single clause (or a batch of them, see
+    // cubifyBatch and cubifyThreads).
 	virtual lbool cubifyOne() override;
 
-    // Enqueue all problem clauses (as long as they are not too big).
+    // Enqueue all problem clauses (as long as they are not too big), and
+    // warm-start from scoreCache. On later calls to interleavedSolve(), only
+    // the clauses added since are enqueued; the cube queue, the index and
+    // the literal difficulties are kept, the deferred cubes are put back,
+    // and cubes over variables eliminated since are dropped.
 	void bootstrap() override;
 
+    // Set the cube aside until the next call (see bootstrap()).
+	virtual void deferCube(const Cube&) override;
+
+    // Remove the cubes that contain eliminated variables from the queue, the
+    // index and the deferred cubes.
+	void dropEliminatedCubes();
+
+    // Run probeRound() every probeInterval steps, and eliminateRound() as
+    // scheduled by elimInterval and elimUnits. Only once elimination is
+    // turned off.
+	virtual lbool inprocess() override;
+
+    // Probe the literals scored in cubification again (see probeLiterals()),
+    // substitute equivalent literals (see substituteEquivalences()), and
+    // remove transitive binary clauses (see reduceTransitive()). Returns
+    // false if the problem turned out to be UNSAT.
+	bool probeRound();
+
+    // Turn elimination on again for a round over the problem clauses (see
+    // SimpSolver::resumeElimination()), then off. The resolvents are queued
+    // for cubification, the removed clauses leave the index, and the learnt
+    // clauses over the eliminated variables are removed. Returns false if
+    // the problem turned out to be UNSAT.
+	bool eliminateRound();
+
+    // Remove the negations of the clauses marked as removed, but still in
+    // the clause vector, from the index.
+	void unindexRemovedClauses();
+
+    // Probe both literals of each variable scored in cubification, the
+    // hardest first, for at most budget propagations. Failed literals and
+    // literals implied by both make units; each literal implied through a
+    // longer clause gets a hyper-binary resolvent, learnt as a core clause.
+    // Returns false if the problem turned out to be UNSAT.
+	bool probeLiterals(uint64_t budget);
+
+    // Find the strongly connected components of the binary implication
+    // graph, and replace the variables of each by one of its literals in
+    // every clause. The replaced variables are eliminated, and restored from
+    // their representatives in extendModel(). Frozen variables stay.
+    // Returns false if the problem turned out to be UNSAT.
+	bool substituteEquivalences();
+
+    // Remove the binary clauses (a, b) whose implication ~a -> b also
+    // follows through other binary clauses, for at most budget watchers
+    // visited.
+	void reduceTransitive(uint64_t budget);
+
+    // Add the unit to the proof, assign it at level 0, and propagate.
+    // Returns false on a conflict.
+	bool learnUnit(Lit);
+
+    // Is there a binary clause (a, b), original or learnt?
+	bool hasBinary(Lit a, Lit b);
+
+    // Replace the literals of the clause by lits (at least two, none of them
+    // assigned), which must be in the proof already, and keep the index in
+    // step.
+	void rewriteClause(CRef cr, const vec<Lit>& lits);
+
+    // Fill the cube queue and the literal difficulties from scoreCache.
+	void loadScoreCache();
+
+	void saveCheckpoint(SnapshotWriter& out) override;
+
+    // Split the search space along the best cubes in the queue: each cube
+    // that is applied to a part of the space (a leaf) replaces it with the
+    // leaf extended by the cube, and with the remainder branches that
+    // negate each new literal in turn. Returns at most k leaves, which
+    // together cover the whole space; the ones refuted by UP are left out.
+	void splitCubes(int k, std::vector<Cube>& leaves);
+
+    // Split the search space as a tree: each node is split on the variable
+    // whose literals both propagate the most under it (by the product of
+    // their trail growths, as in lookahead solvers), and the least reduced
+    // node is split first, so that the leaves are of about equal size. A
+    // literal that fails under a node is negated into the cube of the node.
+    // Returns at most k leaves, which together cover the whole space; the
+    // nodes refuted by UP are left out.
+	void splitLookahead(int k, std::vector<Cube>& leaves);
+
+    // The prior of each variable for lookahead: the product of one plus the
+    // difficulty of each of its literals, times one plus its share of the
+    // scores of the best cubes in the queue.
+	void splitPriors(std::vector<double>& prior) const;
+
+    // Look ahead on the splitCandidates free variables of best prior, under
+    // the cube. Returns the literal to split on (the one of the bigger
+    // branch), or lit_Undef if there is none or the cube conflicts. If a
+    // literal conflicts under the cube, lit_Undef is returned, and the
+    // literal in failed.
+	Lit lookahead(const Cube& cube, const std::vector<double>& prior, Lit& failed);
+
+    // Size of the trail once the cube is propagated at level 0, or -1 if it
+    // conflicts.
+	int assignedUnder(const Cube&);
+
+    // Write the problem clauses, the units at level 0, and the cubes as
+    // assumptions, in iCNF. Variables keep their numbers.
+	bool writeCubes(const char* path, const std::vector<Cube>& cubes);
+
+    // In adaptive mode, credit the step to the current arm of the bandit,
+    // and pick the budget split for the next step. The arms are the
+    // combinations of k_c and k_q scaled by 1/4, 1 or 4; the reward is the
+    // payoff of the step per conflict spent, counting cubification
+    // propagations at the rate of the default search. Meanwhile, k_t
+    // follows the share of searched cubes that get refuted.
+	virtual void onStep(const StepStats&) override;
+
+    // After collecting garbage (all of it, or some regions), also reclaim
+    // the persistent indices of removed clauses, if there are enough of them.
+	virtual void garbageCollect() override;
+	virtual void collectRegions(int n) override;
+
+    // Reclaim the persistent indices of removed clauses (see
+    // Bimap::compact()), renumbering the references to them.
+	void compactClauseIndices();
+
+    // Is cubeMemory() over memoryBudget?
+	bool overMemoryBudget() const;
+
+    // Get back under memoryBudget (see above).
+	void purgeMemory();
+
 protected:
 	// Cubify the clause with transient index i.
 	lbool cubify(const int i);
 
+	// Enqueue the clause with persistent index j for cubification, weighted
+	// by the difficulties of the literals of its root cube.
+	void queueForCubify(int j);
+
+	// First half of cubify(): find the root cube of the clause. Returns false
+	// if the clause is not to be cubified; then, status is the result.
+	bool prepareCubify(const int i, Cube& root, lbool& status);
+
+	// Second half of cubify(): handle the conflicting subcube found for the
+	// clause (see cubifyInternal()).
+	lbool finishCubify(const int i, const Cube& post);
+
+	// Dequeue and cubify up to n clauses at once, walking their paths as one
+	// trie.
+	lbool cubifyMany(int n);
+
+	// Dequeue up to n clauses, and cubify them on cubifyThreads threads.
+	lbool cubifyParallel(int n);
+
 	// Plan a path of propagate/cancel operations that touches every cube
 	// implicant not already accounted for. Returns true by default; returns
 	// false if an explicit subsumption was found.
@@ -91,9 +420,68 @@ protected:
 	// cube is already subsumed in the problem and can be summarily dropped.
 	Cube cubifyInternal(const int i, const Cube&);
 
+	// cubifyInternal() for root cubes of width W, walking a path planned at
+	// compile time (see CubifyPath.h) with fixed-size buffers. Wider roots
+	// take the generic code.
+	template<int W>
+	Cube cubifyFixed(const int i, const Cube&);
+	Cube cubifyGeneric(const int i, const Cube&);
+
+	static const int MaxFixedCubifyWidth = 8;
+
 	// Replace i:th clause with the negation of C. (i is a transient index.)
 	bool pruneClause(const int i, const Cube& C);
 
+protected:
+	// A clause in a cubification batch.
+	struct BatchClause
+	{
+		// Persistent index of the clause.
+		int id;
+
+		// Root cube, and the conflicting subcube found for it.
+		Cube root;
+		Cube post;
+
+		// The clause is subsumed by another problem clause.
+		bool subsumed = false;
+
+		// A conflict was found for post.
+		bool conflicted = false;
+	};
+
+	// A node of the cubification trie: propagate lit, on behalf of the owners
+	// (indices into the batch).
+	struct TrieNode
+	{
+		Lit lit = lit_Undef;
+		std::vector<int> children;
+		std::vector<int> owners;
+	};
+
+	// Add the paths of batch clause b, whose root cube has the literals C (in
+	// trie order), to the trie.
+	void insertCubifyPaths(int b, const std::vector<Lit>& C, BatchClause& bc);
+
+	// Walk the subtree of trie node k, propagating and scoring as in
+	// cubifyInternal().
+	void walkCubifyTrie(int k, Cube& cube, std::vector<BatchClause>& batch);
+
+	std::vector<TrieNode> trie;
+
+	// Trail size before the trie walk.
+	int batchTrail0 = 0;
+
+protected:
+	// Clauses per thread in a round of cubifyParallel().
+	static const int CubifyTasksPerThread = 16;
+
+	// Solver clones for parallel cubification, created as needed.
+	std::vector<std::unique_ptr<CubifyWorker>> cubifyWorkers;
+
+	// Clauses learnt by the master that the cubify workers have not seen yet.
+	std::vector<std::vector<Lit>> cubifyBroadcast;
+
 protected:
     // Queue of cubes to search on, ordered by the density score. This object
     // also tracks the mean density seen so far.
@@ -104,12 +492,51 @@ protected:
     // than the clauses as such, are stored.
     CubeIndex ci;
 
-	// Permanent indices of clauses to cubify.
-	std::vector<int> cubifyQueue;
+	// Clauses to cubify, narrowest and hardest first.
+	CubifyQueue cubifyQueue{ bi };
 
 	// How many propagations were required last time when the indexing literal
 	// was the first decision literal?
 	std::vector<int> literalDifficulty;
+
+protected:
+	// Incremental use: the persistent indices below bootstrapped have been
+	// enqueued for cubification already, and eliminatedVars variables had
+	// been eliminated, at the last bootstrap().
+	int bootstrapped = 0;
+	int eliminatedVars = 0;
+
+	// problemHash() at the first bootstrap(), which the score cache is kept
+	// for (zero if there is no cache).
+	uint64_t cacheHash = 0;
+
+	// Steps since the last round of inprocess(), and the propagations made
+	// up to it.
+	uint64_t probeSteps = 0;
+	uint64_t probePropagations = 0;
+
+	// Steps since the last round of eliminateRound(), and the size of the
+	// trail after it.
+	uint64_t elimSteps = 0;
+	int elimTrail = 0;
+
+	// Cubes set aside by deferCube(), with their scores and parent clauses.
+	struct DeferredCube
+	{
+		Cube cube;
+		double score;
+		std::vector<int> parents;
+	};
+	std::vector<DeferredCube> deferred;
+
+protected:
+	// Adaptive mode: the bandit, its current arm, and the configured values
+	// that the arms are relative to.
+	static const int AdaptiveArms = 9;
+	PhaseBandit bandit{ AdaptiveArms };
+	int arm = AdaptiveArms / 2;
+	double baseK_c = 1.0;
+	double baseK_t = 1.0;
 };
 
 } // namespace Minisat
@@ -18,11 +18,73 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 **************************************************************************************************/
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
 #include "minisat/utils/System.h"
 #include "CubifyingSolverBase.h"
+#include "Snapshot.h"
+
+#ifdef CS_PERF_COUNTERS
+#define CS_PERF_PHASE(step, phase) perfPhase(step, phase)
+#else
+#define CS_PERF_PHASE(step, phase)
+#endif
 
 namespace Minisat
 {
+CubifyingSolverBase::~CubifyingSolverBase()
+{
+	if (telemetry != nullptr) {
+		fclose(telemetry);
+	}
+}
+
+void CubifyingSolverBase::saveCheckpoint(SnapshotWriter& out)
+{
+	InterleavedSolver::saveCheckpoint(out);
+
+	const uint64_t counters[] = { cubifications, cubifyPropagations, cubeSearches, cubeRefutations,
+		cubeModels, refutedClausesDropped, cubeLevelsKept, cubeWorkerConflicts, cubeClausesImported,
+		cubeClausesDropped, cubeBarriers, telemetrySteps };
+	const double times[] = { totalTimeSearch, totalTimeCubify, totalTimeSearchCube, totalTimeEndSimplify };
+	out.putArray(counters, sizeof(counters) / sizeof(counters[0]));
+	out.putArray(times, sizeof(times) / sizeof(times[0]));
+	out.putValue(k_q);
+}
+
+bool CubifyingSolverBase::loadCheckpoint(SnapshotReader& in)
+{
+	if (!InterleavedSolver::loadCheckpoint(in)) return false;
+
+	const uint64_t* counters;
+	const double* times;
+	size_t nCounters, nTimes;
+	if (!in.getArray(counters, nCounters) || nCounters != 12) return false;
+	if (!in.getArray(times, nTimes) || nTimes != 4) return false;
+
+	cubifications = counters[0];
+	cubifyPropagations = counters[1];
+	cubeSearches = counters[2];
+	cubeRefutations = counters[3];
+	cubeModels = counters[4];
+	refutedClausesDropped = counters[5];
+	cubeLevelsKept = counters[6];
+	cubeWorkerConflicts = counters[7];
+	cubeClausesImported = counters[8];
+	cubeClausesDropped = counters[9];
+	cubeBarriers = counters[10];
+	telemetrySteps = counters[11];
+
+	totalTimeSearch = times[0];
+	totalTimeCubify = times[1];
+	totalTimeSearchCube = times[2];
+	totalTimeEndSimplify = times[3];
+
+	in.getValue(k_q);
+	return in.ok();
+}
+
 lbool CubifyingSolverBase::interleavedSolveStep(double budget, int curr_restarts)
 {
 	lbool status = l_Undef;
@@ -32,14 +94,31 @@ lbool CubifyingSolverBase::interleavedSolveStep(double budget, int curr_restarts
 	// search step.
 	int conflictBudget = int(budget);
 
+	// Counters at the start of the step and after each phase.
+	StepStats step;
+	const uint64_t propagations0 = propagations;
+	const uint64_t conflicts0 = conflicts;
+	const uint64_t cubifications0 = cubifications;
+	const uint64_t cubeSearches0 = cubeSearches;
+	const uint64_t cubeRefutations0 = cubeRefutations;
+	const uint64_t cubeModels0 = cubeModels;
+	const uint64_t clausesDropped0 = refutedClausesDropped;
+	const int assigns0 = nAssigns();
+
 	// STEP: default search
 	//
-	// Search without assumptions.
+	// Search under the assumptions of the caller, if any.
 	stepTime0 = cpuTime();
+#ifdef CS_PERF_COUNTERS
+	perfLast = perf.read();
+#endif
 	auto propagationsBeforeSearch = propagations;
 	status = search(conflictBudget);
 	stepTime1 = cpuTime();
+	CS_PERF_PHASE(step, PerfSearch);
 	totalTimeSearch += (stepTime1 - stepTime0);
+	step.searchProps = propagations - propagations0;
+	step.searchConflicts = conflicts - conflicts0;
 
 	// STEP: cubification
 	//
@@ -51,29 +130,42 @@ lbool CubifyingSolverBase::interleavedSolveStep(double budget, int curr_restarts
 		auto propagationBudget = k_c * (propagations - propagationsBeforeSearch);
 		int propagationLimit = propagations + propagationBudget;
 
+		auto propagationsBeforeCubify = propagations;
 		while (propagations < propagationLimit) {
 			if (!withinBudget()) break;
 			if (!canCubify()) break;
 
-			cubifications++;
 			status = cubifyOne();
 			if (status != l_Undef) {
 				exitPoint = 1;
 				break;
 			}
 		}
+		cubifyPropagations += propagations - propagationsBeforeCubify;
 	}
 	stepTime2 = cpuTime();
+	CS_PERF_PHASE(step, PerfCubify);
 	totalTimeCubify += (stepTime2 - stepTime1);
+	step.cubifyProps = propagations - propagations0 - step.searchProps;
+	const uint64_t conflicts2 = conflicts;
+	const int cubeBudget = int(k_q * conflictBudget);
 
 	// STEP: cube search
 	//
 	// Search while assuming the topmost admissible cube, for as long as the
 	// budget allows. If alwaysSearchCube is false, this step only executes
-	// once all cubes have been scored.
-	if ((status == l_Undef) && (!canCubify() || alwaysSearchCube)) {
+	// once all cubes have been scored. The cube is assumed after the
+	// assumptions of the caller, if any; the workers do not know about those,
+	// so then the cubes are searched here, one at a time.
+	if ((status == l_Undef) && (!canCubify() || alwaysSearchCube) && (cubeThreads > 1) && (assumptions.size() == 0)) {
+		status = searchCubesParallel(cubeBudget);
+	}
+	else if ((status == l_Undef) && (!canCubify() || alwaysSearchCube) && (cubeBatch > 1)) {
+		status = searchCubeBatches(cubeBudget);
+	}
+	else if ((status == l_Undef) && (!canCubify() || alwaysSearchCube)) {
 		Cube cube;
-		int conflicts_limit = conflicts + conflictBudget;
+		int conflicts_limit = conflicts + cubeBudget;
 		while (conflicts < conflicts_limit)
 		{
 			if (!withinBudget()) break;
@@ -84,33 +176,16 @@ lbool CubifyingSolverBase::interleavedSolveStep(double budget, int curr_restarts
 #endif
 
 			status = searchCubeBranch(cube, conflicts_limit - conflicts);
+			cubeSearches++;
 
 			if (status == l_True) {
+				cubeModels++;
 				exitPoint = 2;
                 break;
 			}
 			else if (status == l_False) {
-				cubeRefutations++;
-
-				if (conflict.size() == 0) {
-					exitPoint = 4;
-                    break;
-				}
-				else {
-					Cube reduced;
-					for (int i = 0; i < conflict.size(); ++i) {
-						reduced.push(~conflict[i]);
-					}
-#ifndef NO_CS_ASSERTS
-					assert(reduced.subsetOf(cube));
-#endif
-
-					status = refuteCube(cube, reduced);
-					if (status == l_False) {
-						exitPoint = 3;
-						break;
-					}
-				}
+				status = handleCubeConflict(cube);
+				if (status == l_False) break;
 			}
 
 #ifndef NO_CS_ASSERTS
@@ -119,41 +194,507 @@ lbool CubifyingSolverBase::interleavedSolveStep(double budget, int curr_restarts
 		}
 	}
 	stepTime3 = cpuTime();
+	CS_PERF_PHASE(step, PerfCube);
 	totalTimeSearchCube += (stepTime3 - stepTime2);
+	step.cubeProps = propagations - propagations0 - step.searchProps - step.cubifyProps;
+	step.cubeConflicts = conflicts - conflicts2;
 
 	if ((status == l_Undef) && !simplify()) {
 		exitPoint = 5;
-		return l_False;
+		status = l_False;
+	}
+	if ((status == l_Undef) && (inprocess() == l_False)) {
+		exitPoint = 7;
+		status = l_False;
 	}
 	stepTime4 = cpuTime();
+	CS_PERF_PHASE(step, PerfSimplify);
 	totalTimeEndSimplify += (stepTime4 - stepTime3);
 
+	step.restart = curr_restarts;
+	step.budget = conflictBudget;
+	step.status = status;
+	step.searchTime = stepTime1 - stepTime0;
+	step.cubifyTime = stepTime2 - stepTime1;
+	step.cubeTime = stepTime3 - stepTime2;
+	step.simplifyTime = stepTime4 - stepTime3;
+	step.cubifications = cubifications - cubifications0;
+	step.cubeSearches = cubeSearches - cubeSearches0;
+	step.cubeRefutations = cubeRefutations - cubeRefutations0;
+	step.cubeModels = cubeModels - cubeModels0;
+	step.clausesDropped = refutedClausesDropped - clausesDropped0;
+	step.newUnits = (decisionLevel() == 0) ? nAssigns() - assigns0 : 0;
+
+	if (telemetry != nullptr) {
+		writeTelemetry(step);
+	}
+	onStep(step);
+
+	stepIds = bi.size();
 	return status;
 }
 
+#ifdef CS_PERF_COUNTERS
+static const char* perfPhaseNames[] = { "search", "cubify", "cube", "simplify" };
+
+void CubifyingSolverBase::perfPhase(StepStats& step, int phase)
+{
+	PerfCounters::Sample now = perf.read();
+	step.perf[phase] = now - perfLast;
+	perfTotals[phase] += step.perf[phase];
+	perfLast = now;
+}
+#endif
+
+bool CubifyingSolverBase::openTelemetry(const char* path)
+{
+	if (telemetry != nullptr) {
+		fclose(telemetry);
+	}
+
+	telemetry = fopen(path, "w");
+	if (telemetry == nullptr) {
+		return false;
+	}
+
+	// The records are small and frequent; only write them out in bulk.
+	setvbuf(telemetry, nullptr, _IOFBF, 1 << 20);
+	return true;
+}
+
+void CubifyingSolverBase::onStep(const StepStats&)
+{
+}
+
+void CubifyingSolverBase::writeTelemetry(const StepStats& s)
+{
+	QueueStats q;
+	getQueueStats(q);
+
+	// JSON has no NaN (e.g. the mean score before any cube is seen).
+	auto num = [](double x) { return std::isfinite(x) ? x : 0.0; };
+
+	fprintf(telemetry,
+		"{\"step\":%" PRIu64 ",\"restart\":%d,\"budget\":%d,\"conflicts\":%" PRIu64
+		",\"search_props\":%" PRIu64 ",\"cubify_props\":%" PRIu64 ",\"cube_props\":%" PRIu64
+		",\"search_time\":%.6f,\"cubify_time\":%.6f,\"cube_time\":%.6f,\"simplify_time\":%.6f"
+		",\"cubes\":%zu,\"best_score\":%g,\"mean_score\":%g"
+		",\"cubifications\":%" PRIu64 ",\"cubes_searched\":%" PRIu64 ",\"cubes_refuted\":%" PRIu64
+		",\"cubes_sat\":%" PRIu64 ",\"clauses_dropped\":%" PRIu64 ",\"cubify_queue\":%zu"
+		",\"k_c\":%g,\"k_q\":%g,\"k_t\":%g"
+		",\"status\":\"%s\",\"exit\":%d",
+		telemetrySteps++, s.restart, s.budget, conflicts,
+		s.searchProps, s.cubifyProps, s.cubeProps,
+		s.searchTime, s.cubifyTime, s.cubeTime, s.simplifyTime,
+		q.cubes, num(q.bestScore), num(q.meanScore),
+		s.cubifications, s.cubeSearches, s.cubeRefutations, s.cubeModels, s.clausesDropped, q.cubifyQueue,
+		k_c, k_q, q.threshold,
+		(s.status == l_True) ? "sat" : (s.status == l_False) ? "unsat" : "undef", exitPoint);
+
+#ifdef CS_PERF_COUNTERS
+	// Counters that are unavailable are left out.
+	if (perf.available()) {
+		fprintf(telemetry, ",\"perf\":{");
+		for (int p = 0; p < NumPerfPhases; ++p) {
+			fprintf(telemetry, "%s\"%s\":{", (p > 0) ? "," : "", perfPhaseNames[p]);
+			bool first = true;
+			for (int e = 0; e < PerfCounters::NumEvents; ++e) {
+				if (!perf.available(e)) continue;
+				fprintf(telemetry, "%s\"%s\":%" PRIu64, first ? "" : ",", PerfCounters::name(e), s.perf[p].counts[e]);
+				first = false;
+			}
+			fprintf(telemetry, "}");
+		}
+		fprintf(telemetry, "}");
+	}
+#endif
+
+	fprintf(telemetry, "}\n");
+}
+
 lbool CubifyingSolverBase::searchCubeBranch(const Cube& cube, int budget)
 {
 #ifndef NO_CS_ASSERTS
 	assert(cube.sane());
 	assert(decisionLevel() == 0);
-	assert(assumptions.size() == 0);
 #endif
 
+	const int assumptions0 = assumptions.size();
 	for (auto it = cube.begin(); it != cube.end(); ++it) {
 		assumptions.push(*it);
 	}
 
 	conflict.clear();
+	learnt_in_cube = true;
 	auto status = search(budget);
+	learnt_in_cube = false;
 
+	assumptions.shrink(assumptions.size() - assumptions0);
 	if (status == l_True) return l_True;
 
 	cancelUntil(0);
-	assumptions.clear();
 
 	return status;
 }
 
+lbool CubifyingSolverBase::handleCubeConflict(const Cube& cube)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	cubeRefutations++;
+
+	if (conflict.size() == 0) {
+		exitPoint = 4;
+		return l_False;
+	}
+
+	Cube reduced;
+	int inCube = 0;
+	for (int i = 0; i < conflict.size(); ++i) {
+		reduced.push(~conflict[i]);
+		if (cube.contains(~conflict[i])) inCube++;
+	}
+
+	if (inCube == reduced.size()) {
+		if (refuteCube(cube, reduced) == l_False) {
+			exitPoint = 3;
+			return l_False;
+		}
+	}
+	else if (inCube == 0) {
+		// The assumptions of the caller are contradictory by themselves; the
+		// conflict is the answer.
+		exitPoint = 6;
+		return l_False;
+	}
+	else {
+		// Only refuted together with some of the assumptions.
+		deferCube(cube);
+	}
+
+	return l_Undef;
+}
+
+lbool CubifyingSolverBase::searchCubeBatches(int budget)
+{
+	lbool status = l_Undef;
+	std::vector<Cube> cubes;
+
+	int conflicts_limit = conflicts + budget;
+	while (status == l_Undef && conflicts < conflicts_limit)
+	{
+		if (!withinBudget()) break;
+
+		cubes.clear();
+		if (pickCubes(cubes, cubeBatch) == 0) break;
+
+		status = searchCubeBatch(cubes, conflicts_limit - conflicts);
+	}
+
+	return status;
+}
+
+lbool CubifyingSolverBase::searchCubeBatch(std::vector<Cube>& cubes, int budget)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+#endif
+
+	// Cubes are sorted, so in lexicographic order, neighbours tend to share
+	// their first literals, i.e. their first assumption levels.
+	std::sort(cubes.begin(), cubes.end());
+
+	const int assumptions0 = assumptions.size();
+	const int conflicts_limit = conflicts + budget;
+
+	// The final conflicts, to be handled once back at level 0, in order.
+	std::vector<int> refuted;
+	std::vector<std::vector<Lit>> finals;
+
+	lbool status = l_Undef;
+	for (int k = 0; k < cubes.size(); ++k) {
+		if (conflicts >= conflicts_limit || !withinBudget()) break;
+
+		const Cube& cube = cubes[k];
+
+#ifndef NO_CS_ASSERTS
+		assert(cube.sane());
+		assert(cube.size() > 0);
+#endif
+
+		// Keep the levels of the assumptions shared with the previous cube;
+		// the levels after them are undone.
+		int keep = assumptions0;
+		while (keep < assumptions.size() && keep - assumptions0 < cube.size()
+				&& assumptions[keep] == cube[keep - assumptions0]) {
+			keep++;
+		}
+		keep = std::min(keep, decisionLevel());
+		if (k > 0) cubeLevelsKept += keep - assumptions0;
+		cancelUntil(keep);
+
+		assumptions.shrink(assumptions.size() - assumptions0);
+		for (auto it = cube.begin(); it != cube.end(); ++it) {
+			assumptions.push(*it);
+		}
+
+		conflict.clear();
+		learnt_in_cube = true;
+		status = search(conflicts_limit - conflicts);
+		learnt_in_cube = false;
+		cubeSearches++;
+
+		if (status == l_True) {
+			assumptions.shrink(assumptions.size() - assumptions0);
+			cubeModels++;
+			exitPoint = 2;
+			return l_True;
+		}
+		else if (status == l_False) {
+			refuted.push_back(k);
+			finals.emplace_back();
+			for (int i = 0; i < conflict.size(); ++i) {
+				finals.back().push_back(conflict[i]);
+			}
+
+			// The problem is UNSAT, or the assumptions of the caller are:
+			// nothing more to search.
+			bool inCube = false;
+			for (auto L : finals.back()) {
+				if (cube.contains(~L)) inCube = true;
+			}
+			if (!inCube) break;
+
+			status = l_Undef;
+		}
+	}
+
+	assumptions.shrink(assumptions.size() - assumptions0);
+	cancelUntil(0);
+
+	for (int r = 0; r < refuted.size(); ++r) {
+		conflict.clear();
+		for (auto L : finals[r]) {
+			conflict.insert(L);
+		}
+
+		status = handleCubeConflict(cubes[refuted[r]]);
+		if (status != l_Undef) break;
+	}
+
+	return status;
+}
+
+lbool CubifyingSolverBase::searchCubesParallel(int budget)
+{
+	lbool status = l_Undef;
+	std::vector<Cube> cubes;
+
+	int conflicts_limit = conflicts + budget;
+	while (conflicts < conflicts_limit)
+	{
+		if (!withinBudget()) break;
+
+		cubes.clear();
+		if (pickCubes(cubes, cubeThreads) == 0) break;
+
+		status = searchCubeBranches(cubes, conflicts_limit - conflicts);
+		if (status != l_Undef) break;
+	}
+
+	return status;
+}
+
+lbool CubifyingSolverBase::searchCubeBranches(const std::vector<Cube>& cubes, int budget)
+{
+#ifndef NO_CS_ASSERTS
+	assert(decisionLevel() == 0);
+	assert(cubes.size() <= cubeThreads);
+#endif
+
+	const int n = cubes.size();
+
+	if (reloadWorkers) {
+		cubeWorkers.clear();
+		workerBroadcast.clear();
+		reloadWorkers = false;
+	}
+
+	// Bring the workers up to date. New workers copy the current state in
+	// full, so the broadcast clauses are only needed by the old ones.
+	for (auto& w : cubeWorkers) {
+		w->sync(*this, workerBroadcast);
+	}
+	workerBroadcast.clear();
+	while (cubeWorkers.size() < n) {
+		cubeWorkers.emplace_back(new CubeWorker(cubeWorkers.size()));
+		cubeWorkers.back()->maxExportSize = cubeShareSize;
+		cubeWorkers.back()->maxExportLbd = cubeShareLbd;
+		cubeWorkers.back()->load(*this);
+	}
+
+	// Run the workers. While they run, pass their learnt clauses around. As
+	// soon as any of them finds a model (or the master becomes UNSAT due to
+	// an imported clause), the rest are interrupted.
+	std::vector<std::thread> threads;
+	cubeSearches += n;
+	if (deterministic) cubeBarrier.start(n);
+	for (int i = 0; i < n; ++i) {
+		CubeWorker* w = cubeWorkers[i].get();
+		w->finished = false;
+		w->clearInterrupt();
+		w->barrier = deterministic ? &cubeBarrier : nullptr;
+		w->signal = deterministic ? nullptr : &cubeSignal;
+		w->epoch = cubeEpoch;
+		threads.emplace_back([w, &cubes, i, budget]() { w->run(cubes[i], budget); });
+	}
+
+	// In the deterministic mode, the same happens, but only while all the
+	// workers wait at the barrier: the clauses are relayed in worker order,
+	// and the rest are stopped from there.
+	while (deterministic && cubeBarrier.wait()) {
+		relayWorkerClauses();
+
+		bool stop = !ok || !withinBudget();
+		for (int i = 0; i < n; ++i) {
+			const CubeWorker& w = *cubeWorkers[i];
+			if (w.finished && w.status == l_True) stop = true;
+		}
+
+		cubeBarrier.release(stop);
+		cubeBarriers++;
+	}
+
+	bool running = !deterministic;
+	bool modelFound = false;
+	while (running) {
+		// Woken by the workers; the timeout bounds the time until the budget
+		// is checked.
+		cubeSignal.wait(std::chrono::milliseconds(10));
+
+		running = false;
+		for (int i = 0; i < n; ++i) {
+			const CubeWorker& w = *cubeWorkers[i];
+			if (!w.finished) running = true;
+			else if (w.status == l_True) modelFound = true;
+		}
+
+		relayWorkerClauses();
+
+		if (modelFound || !ok || !withinBudget()) {
+			for (int i = 0; i < n; ++i) {
+				cubeWorkers[i]->interrupt();
+			}
+		}
+	}
+
+	for (auto& t : threads) {
+		t.join();
+	}
+	relayWorkerClauses();
+
+	// The workers ran side by side, so the master is charged for the longest
+	// of the runs.
+	uint64_t longest = 0;
+	for (int i = 0; i < n; ++i) {
+		longest = std::max(longest, cubeWorkers[i]->conflictsUsed);
+		cubeWorkerConflicts += cubeWorkers[i]->conflictsUsed;
+	}
+	conflicts += longest;
+
+	// Handle the results in worker order.
+	if (!ok) {
+		exitPoint = 6;
+		return l_False;
+	}
+
+	for (int i = 0; i < n; ++i) {
+		const CubeWorker& w = *cubeWorkers[i];
+		if (w.status == l_True) {
+			if (!isModel(w.model)) {
+				reloadWorkers = true;
+				continue;
+			}
+			w.model.copyTo(model);
+			cubeModels++;
+			exitPoint = 2;
+			return l_True;
+		}
+	}
+
+	// Refuted cubes.
+	for (int i = 0; i < n; ++i) {
+		const CubeWorker& w = *cubeWorkers[i];
+		if (w.status != l_False) continue;
+
+		cubeRefutations++;
+
+		if (w.reduced.size() == 0) {
+			conflict.clear();
+			exitPoint = 4;
+			return l_False;
+		}
+
+#ifndef NO_CS_ASSERTS
+		assert(w.reduced.subsetOf(cubes[i]));
+#endif
+
+		if (refuteCube(cubes[i], w.reduced) == l_False) {
+			exitPoint = 3;
+			return l_False;
+		}
+	}
+
+	return l_Undef;
+}
+
+void CubifyingSolverBase::relayWorkerClauses()
+{
+	Minisat::vec<Lit> v;
+	for (int i = 0; i < cubeWorkers.size(); ++i) {
+		while (cubeWorkers[i]->outbox.pop(relayBuffer)) {
+			for (int j = 0; j < cubeWorkers.size(); ++j) {
+				if (j == i) continue;
+				if (!cubeWorkers[j]->inbox.push(relayBuffer)) {
+					cubeClausesDropped++;
+				}
+			}
+
+			// As learnt clauses, so that reduceDB() may remove them again.
+			if (ok) {
+				v.clear();
+				for (auto L : relayBuffer) {
+					v.push(L);
+				}
+				addLearnt_(v);
+				cubeClausesImported++;
+			}
+		}
+	}
+}
+
+bool CubifyingSolverBase::isModel(const Minisat::vec<lbool>& m) const
+{
+	for (int i = 0; i < trail.size(); ++i) {
+		const Lit L = trail[i];
+		if (var(L) >= m.size() || (m[var(L)] ^ sign(L)) != l_True) return false;
+	}
+
+	for (int i = 0; i < clauses.size(); ++i) {
+		const Clause& c = ca[clauses[i]];
+		if (c.mark() == 1) continue;
+
+		bool sat = false;
+		for (int k = 0; k < c.size() && !sat; ++k) {
+			sat = var(c[k]) < m.size() && (m[var(c[k])] ^ sign(c[k])) == l_True;
+		}
+		if (!sat) return false;
+	}
+	return true;
+}
+
 bool CubifyingSolverBase::rootOf(const Clause& clause, Cube& cube)
 {
 	for (size_t j = 0; j < clause.size(); ++j)
@@ -175,11 +716,11 @@ bool CubifyingSolverBase::isConflicted(const Cube& cube)
 	assert(decisionLevel() == 0);
 #endif
 
-	newDecisionLevel();
+	newProbeLevel();
 	for (auto it = cube.begin(); it != cube.end(); ++it) {
 		auto L = *it;
 		if (value(L) == l_False) {
-			cancelUntil(0);
+			cancelProbe(0);
 			return true;
 		}
 		else {
@@ -187,11 +728,11 @@ bool CubifyingSolverBase::isConflicted(const Cube& cube)
 		}
 	}
 	if (propagate() != CRef_Undef) {
-		cancelUntil(0);
+		cancelProbe(0);
 		return true;
 	}
 
-	cancelUntil(0);
+	cancelProbe(0);
 	return false;
 }
 
@@ -200,13 +741,37 @@ bool CubifyingSolverBase::pickCube(Cube&)
 	return false;
 }
 
+int CubifyingSolverBase::pickCubes(std::vector<Cube>& cubes, int n)
+{
+	Cube cube;
+	if (n > 0 && pickCube(cube)) {
+		cubes.push_back(cube);
+		return 1;
+	}
+	return 0;
+}
+
 lbool CubifyingSolverBase::refuteCube(const Cube& base, const Cube& reduced)
 //lbool CubifyingSolverBase::refuteCube(const Cube& base)
 {
+	proofNegationOf(base);
 	learnNegationOf(base);
 	return ok ? l_Undef : l_False;
 }
 
+void CubifyingSolverBase::deferCube(const Cube&)
+{
+}
+
+lbool CubifyingSolverBase::inprocess()
+{
+	return l_Undef;
+}
+
+void CubifyingSolverBase::getQueueStats(QueueStats&) const
+{
+}
+
 bool CubifyingSolverBase::canCubify() const
 {
 	return false;
@@ -226,9 +791,23 @@ bool CubifyingSolverBase::learnNegationOf(const Cube& cube)
 
 	Minisat::vec<Lit> v;
 	cube.invert(v);
+
+	if (!cubeWorkers.empty()) {
+		workerBroadcast.emplace_back(&v[0], &v[0] + v.size());
+	}
+
 	return addClause_(v);
 }
 
+void CubifyingSolverBase::proofNegationOf(const Cube& cube)
+{
+	if (proof == NULL) return;
+
+	Minisat::vec<Lit> v;
+	cube.invert(v);
+	proof->add(v);
+}
+
 void CubifyingSolverBase::dropClause(const int i)
 {
 #ifndef NO_CS_ASSERTS
@@ -271,7 +850,121 @@ void CubifyingSolverBase::printStepStats() const
 	printf("| Exit:         %12d\n", exitPoint);
 	printf("===============================================================================\n");
 	printf("cubifications         : %-12ld\n", cubifications);
+	printf("cubify propagations   : %-12ld\n", cubifyPropagations);
 	printf("cube refutations      : %-12ld\n", cubeRefutations);
+	if (cubeBatch > 1) {
+		printf("cube levels kept      : %-12ld\n", cubeLevelsKept);
+	}
+	if (cubeThreads > 1) {
+		printf("cube worker conflicts : %-12ld\n", cubeWorkerConflicts);
+
+		uint64_t exported = 0;
+		uint64_t imported = cubeClausesImported;
+		uint64_t dropped = cubeClausesDropped;
+		for (const auto& w : cubeWorkers) {
+			exported += w->clausesExported;
+			imported += w->clausesImported;
+			dropped += w->clausesDropped;
+		}
+		printf("cube clauses exported : %-12ld\n", exported);
+		printf("cube clauses imported : %-12ld\n", imported);
+		printf("cube clauses dropped  : %-12ld\n", dropped);
+
+		if (deterministic) {
+			double runTime = 0.0;
+			double barrierTime = 0.0;
+			for (const auto& w : cubeWorkers) {
+				runTime += w->runTime;
+				barrierTime += w->barrierTime;
+			}
+			double pct = (runTime > 0.0) ? 100.0 * barrierTime / runTime : 0.0;
+			printf("cube barriers         : %-12ld\n", cubeBarriers);
+			printf("cube barrier wait     : %-12.2f   (%.2f %% of worker time)\n", barrierTime, pct);
+		}
+	}
+	if (!checkpointPath.empty()) {
+		printf("checkpoints           : %-12ld\n", checkpoints);
+	}
+	if (proof != NULL) {
+		printf("proof                 : %.2f MB   (%ld stalls)\n", proof->bytes() / (1024.0 * 1024.0), proof->stalls());
+	}
+
+#ifdef CS_PERF_COUNTERS
+	if (!perf.available()) {
+		printf("perf counters         : unavailable\n");
+		return;
+	}
+
+	printf("perf counters         :");
+	for (int e = 0; e < PerfCounters::NumEvents; ++e) {
+		printf(" %14s", PerfCounters::name(e));
+	}
+	printf("\n");
+	for (int p = 0; p < NumPerfPhases; ++p) {
+		printf("  %-20s:", perfPhaseNames[p]);
+		for (int e = 0; e < PerfCounters::NumEvents; ++e) {
+			if (perf.available(e)) {
+				printf(" %14" PRIu64, perfTotals[p].counts[e]);
+			}
+			else {
+				printf(" %14s", "-");
+			}
+		}
+		printf("\n");
+	}
+#endif
+}
+
+void CubifyingSolverBase::writeStepStats(FILE* f) const
+{
+	uint64_t exported = 0;
+	uint64_t imported = cubeClausesImported;
+	uint64_t dropped = cubeClausesDropped;
+	double runTime = 0.0;
+	double barrierTime = 0.0;
+	for (const auto& w : cubeWorkers) {
+		exported += w->clausesExported;
+		imported += w->clausesImported;
+		dropped += w->clausesDropped;
+		runTime += w->runTime;
+		barrierTime += w->barrierTime;
+	}
+
+	fprintf(f,
+		"\"conflicts\":%" PRIu64 ",\"decisions\":%" PRIu64 ",\"propagations\":%" PRIu64 ",\"restarts\":%" PRIu64
+		",\"search_time\":%.6f,\"cubify_time\":%.6f,\"cube_time\":%.6f,\"simplify_time\":%.6f,\"exit\":%d"
+		",\"cubifications\":%" PRIu64 ",\"cubify_propagations\":%" PRIu64
+		",\"cube_searches\":%" PRIu64 ",\"cube_refutations\":%" PRIu64 ",\"cube_models\":%" PRIu64
+		",\"clauses_dropped\":%" PRIu64 ",\"cube_levels_kept\":%" PRIu64 ",\"cube_worker_conflicts\":%" PRIu64
+		",\"cube_clauses_exported\":%" PRIu64 ",\"cube_clauses_imported\":%" PRIu64 ",\"cube_clauses_dropped\":%" PRIu64
+		",\"cube_barriers\":%" PRIu64 ",\"cube_barrier_wait\":%.6f,\"cube_worker_time\":%.6f"
+		",\"checkpoints\":%" PRIu64 ",\"proof_bytes\":%" PRIu64 ",\"proof_stalls\":%" PRIu64,
+		conflicts, decisions, propagations, starts,
+		totalTimeSearch, totalTimeCubify, totalTimeSearchCube, totalTimeEndSimplify, exitPoint,
+		cubifications, cubifyPropagations,
+		cubeSearches, cubeRefutations, cubeModels,
+		refutedClausesDropped, cubeLevelsKept, cubeWorkerConflicts,
+		exported, imported, dropped,
+		cubeBarriers, barrierTime, runTime,
+		checkpoints, (proof != NULL) ? proof->bytes() : 0, (proof != NULL) ? proof->stalls() : 0);
+
+#ifdef CS_PERF_COUNTERS
+	// As in the telemetry records, but the totals of the run.
+	if (perf.available()) {
+		fprintf(f, ",\"perf\":{");
+		for (int p = 0; p < NumPerfPhases; ++p) {
+			fprintf(f, "%s\"%s\":{", (p > 0) ? "," : "", perfPhaseNames[p]);
+			bool first = true;
+			for (int e = 0; e < PerfCounters::NumEvents; ++e) {
+				if (!perf.available(e)) continue;
+				fprintf(f, "%s\"%s\":%" PRIu64, first ? "" : ",", PerfCounters::name(e), perfTotals[p].counts[e]);
+				first = false;
+			}
+			fprintf(f, "}");
+		}
+		fprintf(f, "}");
+	}
+#endif
 }
 
 } // namespace Minisat
@@ -20,10 +20,17 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef CubifyingSolverBaseH
 #define CubifyingSolverBaseH
 
+#include <cstdio>
 #include <unordered_set>
+#include <memory>
+#include <vector>
 
 #include "InterleavedSolver.h"
+#include "CubeWorker.h"
 #include "Cube.h"
+#ifdef CS_PERF_COUNTERS
+#include "PerfCounters.h"
+#endif
 
 namespace Minisat
 {
@@ -45,7 +52,7 @@ namespace Minisat
 //   1. Run a standard search for X conflicts
 //   2. Mark as P the number of propagations spent in step 1
 //   3. Spend k_c * P propagations on cubifying enqueued clauses, if any
-//   4. Spend at most X conflicts on searching in the best-scored cube(s)
+//   4. Spend at most k_q * X conflicts on searching in the best-scored cube(s)
 //   5. Simplify
 // 
 // In step 4, a search within a cube C may terminate with a result. Then:
@@ -60,62 +67,283 @@ namespace Minisat
 //     - otherwise, we can replace the originating clause with ~D, and also
 //       enqueue ~D for cubification
 //
+// Under assumptions of the caller, C is assumed after them, and D may also
+// contain some of them. If D contains nothing but assumptions, the call is
+// answered (UNSAT under the assumptions); if D contains both, C is set aside
+// until the next call (see deferCube()).
+//
+// Step 4 may also run on several threads (see cubeThreads). Then, the best
+// cubes are searched at the same time by CubeWorker clones of the solver,
+// and the results are handled as above, but only once all of the workers
+// have finished. Short clauses learnt by the workers are passed on to the
+// master and the other workers while they run (see ClauseRing).
+//
+// On one thread, step 4 may also search the cubes in batches (see cubeBatch).
+// Then, the best cubes are searched one after another in lexicographic order,
+// and between two cubes, the solver only backtracks to the first assumption
+// where they differ. The results are handled as above, once the batch is done.
+//
 // Configuration:
 //  - Step 4 can be delayed until the cubification queue is empty.
+//  - Step 4 can be run on several threads, or in batches.
 //  - k_c can be adjusted to tune the time spend cubifying.
+//  - k_q can be adjusted to tune the time spent searching in cubes.
 //  - override canCubify() to indicate if there are enqueued clauses.
 //  - override cubifyOne() to define the cubification of one clause.
 //  - override pickCube() to define which cube is next in line to search.
+//  - override pickCubes() to define which cubes are searched in parallel.
 //  - override refuteCube() to define handling for a cube refuted in step 4.
 class CubifyingSolverBase : public InterleavedSolver
 {
 public:
     CubifyingSolverBase() {}
-    ~CubifyingSolverBase() {}
+    ~CubifyingSolverBase();
 
     virtual lbool interleavedSolveStep(double budget, int curr_restarts) override;
 
 	// Push ~cube as a new clause. Does not check whether it exists already.
+	// The caller writes it to the proof first (see proofNegationOf()).
 	bool learnNegationOf(const Cube& cube);
 
+	// Write ~cube to the proof, if any, as an added clause. This is to be
+	// done before deleting the clauses it was derived with, e.g. the ones it
+	// subsumes.
+	void proofNegationOf(const Cube& cube);
+
 	void printStepStats() const;
 
+	// Write the statistics of printStepStats(), and the search counters, as
+	// the members of a JSON object (without the braces).
+	void writeStepStats(FILE* f) const;
+
+	// Write one telemetry record per step (i.e. per interleavedSolveStep())
+	// to the file, as a line of JSON. Returns false if the file could not be
+	// opened.
+	bool openTelemetry(const char* path);
+
+	// Also restores the counters, the phase times and k_q.
+	bool loadCheckpoint(SnapshotReader& in) override;
+
 public:
     // Multiplier that adjusts the time spend cubifying.
 	double k_c = 2.0;
 
+    // Multiplier that adjusts the conflict budget of step 4, relative to
+    // that of step 1.
+	double k_q = 1.0;
+
     // If set to false, step 4 only runs once cubifiable clauses have been
     // exhausted.
 	bool alwaysSearchCube = true;
 
+    // Number of threads used in step 4. If greater than one, this many cubes
+    // are searched at the same time, by as many CubeWorker threads.
+	int cubeThreads = 1;
+
+    // If greater than one (and on one thread), step 4 searches this many
+    // cubes at a time, keeping the assumption levels that consecutive cubes
+    // share.
+	int cubeBatch = 1;
+
+    // Learnt clauses of at most this size, or of at most this LBD, are
+    // passed from each cube worker to the master and the other workers.
+	int cubeShareSize = 2;
+	int cubeShareLbd = 2;
+
+    // If set, the cube workers stop every cubeEpoch conflicts and wait for
+    // each other, and clauses are only relayed then, so that runs with the
+    // same random seed and the same number of threads give the same results.
+	bool deterministic = false;
+	int cubeEpoch = 1000;
+
     // Counter: how many clauses have been cubified?
 	uint64_t cubifications = 0;
 
+    // Counter: how many propagations have been used for cubification?
+	uint64_t cubifyPropagations = 0;
+
+    // Counter: how many cube searches have been started?
+	uint64_t cubeSearches = 0;
+
     // Counter: how many cubes have been refuted?
 	uint64_t cubeRefutations = 0;
 
+    // Counter: how many cube searches have found a model?
+	uint64_t cubeModels = 0;
+
+    // Counter: how many clauses have been dropped, as subsumed by the
+    // negation of a refuted cube?
+	uint64_t refutedClausesDropped = 0;
+
+    // Counter: how many assumption levels have been kept between cubes of a
+    // batch, instead of being assumed and propagated again?
+	uint64_t cubeLevelsKept = 0;
+
+    // Counter: how many conflicts have the cube workers used in total?
+	uint64_t cubeWorkerConflicts = 0;
+
+    // Counter: how many clauses exported by the cube workers have been
+    // learnt by the master?
+	uint64_t cubeClausesImported = 0;
+
+    // Counter: how many clauses could not be relayed to a cube worker, due
+    // to its inbox being full?
+	uint64_t cubeClausesDropped = 0;
+
+    // Counter: how many times have the cube workers waited for each other,
+    // in the deterministic mode?
+	uint64_t cubeBarriers = 0;
+
 protected:
     // Choose a cube to search on in step 4. Returns true if one was
     // available. The cube is received in the argument.
 	virtual bool pickCube(Cube&);
 
+    // Choose at most n cubes to search on in parallel in step 4. Returns the
+    // number of cubes received in the argument. By default, defers to
+    // pickCube().
+	virtual int pickCubes(std::vector<Cube>&, int n);
+
     // Handle when the cube "base" was picked for search in step 4, and the
     // search indicated a conflict caused by the cube "reduced" (which is
     // necessarily either "base" or a subcube).
 	virtual lbool refuteCube(const Cube& base, const Cube& reduced);
 
+    // Handle when the cube was picked for search in step 4, and the search
+    // indicated a conflict caused by the cube together with some of the
+    // assumptions of the caller. The cube is to be left alone until the
+    // next call. Does nothing by default.
+	virtual void deferCube(const Cube&);
+
+    // Simplify the problem further at the end of a step, after simplify(),
+    // at level 0. Returns l_False if the problem turned out to be UNSAT.
+    // Does nothing by default.
+	virtual lbool inprocess();
+
 	virtual bool canCubify() const;
 	virtual lbool cubifyOne();
 
+	// State of the cube queue, for the telemetry records.
+	struct QueueStats
+	{
+		size_t cubes = 0;
+		double bestScore = 0.0;
+		double meanScore = 0.0;
+
+		// Clauses in the cubification queue.
+		size_t cubifyQueue = 0;
+
+		// Minimum density for searching in a cube, if any.
+		double threshold = 0.0;
+	};
+
+	// Describe the cube queue. By default, there is none.
+	virtual void getQueueStats(QueueStats&) const;
+
 protected:
 	lbool searchCubeBranch(const Cube&, int budget);
 
+	// Handle the final conflict of a search in the cube: refute the cube, set
+	// it aside, or answer the call. Returns l_False if the call is answered,
+	// and l_Undef otherwise. Must be at decision level 0.
+	lbool handleCubeConflict(const Cube&);
+
+	// Step 4 in batches of cubeBatch cubes, for at most budget conflicts.
+	lbool searchCubeBatches(int budget);
+
+	// Search in each of the cubes in turn (sorting them first), and handle
+	// the results.
+	lbool searchCubeBatch(std::vector<Cube>&, int budget);
+
+	// Step 4 on cubeThreads threads, for at most budget conflicts.
+	lbool searchCubesParallel(int budget);
+
+	// Search in each of the cubes at the same time (one worker per cube), and
+	// handle the results.
+	lbool searchCubeBranches(const std::vector<Cube>&, int budget);
+
+	// Move the clauses in the outbox of each worker to the master and to the
+	// inboxes of the other workers. Safe to call while the workers run.
+	void relayWorkerClauses();
+
+	// Does the model (e.g. of a worker) satisfy the units and the clauses of
+	// the master?
+	bool isModel(const Minisat::vec<lbool>& m) const;
+
 	bool rootOf(const Clause&, Cube&);
 	bool isConflicted(const Cube&);
 
 	// Remove the clause with transient index i.
 	void dropClause(const int i);
 
+protected:
+	// What happened during one step.
+	struct StepStats
+	{
+		int restart;
+		int budget;
+		lbool status;
+
+		// Spent in default search, cubification and cube search.
+		uint64_t searchProps;
+		uint64_t cubifyProps;
+		uint64_t cubeProps;
+		uint64_t searchConflicts;
+		uint64_t cubeConflicts;
+		double searchTime;
+		double cubifyTime;
+		double cubeTime;
+		double simplifyTime;
+
+		// Results.
+		uint64_t cubifications;
+		uint64_t cubeSearches;
+		uint64_t cubeRefutations;
+		uint64_t cubeModels;
+		uint64_t clausesDropped;
+		int newUnits;
+
+#ifdef CS_PERF_COUNTERS
+		// Hardware counters, per phase (see PerfPhase).
+		PerfCounters::Sample perf[4];
+#endif
+	};
+
+	void saveCheckpoint(SnapshotWriter& out) override;
+
+	// Called at the end of every step. Does nothing by default.
+	virtual void onStep(const StepStats&);
+
+	void writeTelemetry(const StepStats&);
+
+	// Telemetry stream, if any (see openTelemetry()).
+	FILE* telemetry = nullptr;
+	uint64_t telemetrySteps = 0;
+
+protected:
+	// Solver clones for parallel cube search, created as needed.
+	std::vector<std::unique_ptr<CubeWorker>> cubeWorkers;
+
+	// Clauses learnt by the master that the workers have not seen yet.
+	std::vector<std::vector<Lit>> workerBroadcast;
+
+	// Persistent ids given out by the end of the last step. Clauses added
+	// after it, between two calls, have not reached the workers.
+	int stepIds = 0;
+
+	// Set when a worker returns a model that misses clauses of the master;
+	// the workers are then loaded again before the next search.
+	bool reloadWorkers = false;
+
+	// Scratch space for relaying.
+	std::vector<Lit> relayBuffer;
+
+	// Where the workers wait for each other, in the deterministic mode.
+	CubeBarrier cubeBarrier;
+
+	// What wakes the master while the workers run, otherwise.
+	CubeSignal cubeSignal;
+
 protected:
 	int exitPoint = 0;
 	double stepTime0;
@@ -127,6 +355,26 @@ protected:
 	double totalTimeCubify = 0.0;
 	double totalTimeSearchCube = 0.0;
 	double totalTimeEndSimplify = 0.0;
+
+#ifdef CS_PERF_COUNTERS
+protected:
+	// The phases of a step, in order.
+	enum PerfPhase
+	{
+		PerfSearch,
+		PerfCubify,
+		PerfCube,
+		PerfSimplify,
+		NumPerfPhases
+	};
+
+	// Attribute the counts since the previous call to the phase.
+	void perfPhase(StepStats& step, int phase);
+
+	PerfCounters perf;
+	PerfCounters::Sample perfLast;
+	PerfCounters::Sample perfTotals[NumPerfPhases];
+#endif
 };
 
 } // namespace Minisat
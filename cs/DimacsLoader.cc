@@ -0,0 +1,416 @@
+/********************************************************************************[DimacsLoader.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <algorithm>
+#include <condition_variable>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "minisat/core/Dimacs.h"
+#include "DimacsLoader.h"
+
+namespace Minisat
+{
+//=================================================================================================
+// Gzipped input: decompression on a separate thread.
+
+// A character stream like StreamBuffer, except that the input is read and
+// decompressed by a thread of its own, a few blocks ahead of the parser.
+class AsyncStreamBuffer
+{
+public:
+	explicit AsyncStreamBuffer(gzFile in);
+	~AsyncStreamBuffer();
+
+	int  operator *  () const { return (pos >= size) ? EOF : buf[pos]; }
+	void operator ++ ()       { pos++; if (pos >= size) nextBlock(); }
+
+private:
+	enum { block_size = 1024 * 1024, num_blocks = 4 };
+
+	// Reader thread: fill blocks until the input ends.
+	void readAll();
+
+	// Parser thread: release the current block and wait for the next one.
+	void nextBlock();
+
+	gzFile in;
+	std::thread reader;
+
+	// Ring of blocks. The reader fills blocks [tail, head + num_blocks), the
+	// parser reads block head, once head < tail.
+	std::vector<unsigned char> blocks[num_blocks];
+	int lengths[num_blocks];
+	size_t head = 0;
+	size_t tail = 0;
+	bool done = false;
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	// Current block.
+	const unsigned char* buf = nullptr;
+	int pos = 0;
+	int size = 0;
+	bool holding = false;
+};
+
+static inline bool isEof(AsyncStreamBuffer& in) { return *in == EOF; }
+
+AsyncStreamBuffer::AsyncStreamBuffer(gzFile in) : in(in)
+{
+	for (auto& block : blocks) {
+		block.resize(block_size);
+	}
+	reader = std::thread([this]() { readAll(); });
+	nextBlock();
+}
+
+AsyncStreamBuffer::~AsyncStreamBuffer()
+{
+	// Let the reader run to completion, if the parser stopped early.
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		head = tail;
+		done = true;
+	}
+	cv.notify_all();
+	reader.join();
+}
+
+void AsyncStreamBuffer::readAll()
+{
+	for (;;) {
+		size_t slot;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this]() { return done || (tail < head + num_blocks); });
+			if (done) return;
+			slot = tail % num_blocks;
+		}
+
+		int n = gzread(in, blocks[slot].data(), block_size);
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (n <= 0) {
+				done = true;
+			}
+			else {
+				lengths[slot] = n;
+				tail++;
+			}
+		}
+		cv.notify_all();
+
+		if (n <= 0) return;
+	}
+}
+
+void AsyncStreamBuffer::nextBlock()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (holding) {
+		head++;
+		holding = false;
+		cv.notify_all();
+	}
+
+	cv.wait(lock, [this]() { return done || (head < tail); });
+
+	pos = 0;
+	if (head < tail) {
+		buf = blocks[head % num_blocks].data();
+		size = lengths[head % num_blocks];
+		holding = true;
+	}
+	else {
+		buf = nullptr;
+		size = 0;
+	}
+}
+
+static bool loadDimacsStream(gzFile in, SimpSolver& S, bool strictp)
+{
+	if (in == NULL) return false;
+
+	{
+		AsyncStreamBuffer buf(in);
+		parse_DIMACS_main(buf, S, strictp);
+	}
+
+	gzclose(in);
+	return true;
+}
+
+//=================================================================================================
+// Plain input: memory-mapped, tokenised in parallel.
+
+// A part of the input, cut at line boundaries, and its tokens.
+struct DimacsChunk
+{
+	const char* begin;
+	const char* end;
+
+	// The literals, in order; 0 ends a clause. A clause may continue into the
+	// next chunk.
+	std::vector<int> tokens;
+	int maxVar = 0;
+
+	// The header, if the chunk has one.
+	int headerClauses = -1;
+
+	// The first parse error in the chunk, if any.
+	bool failed = false;
+	bool failedHeader = false;
+	int failedChar = 0;
+};
+
+static inline bool isSpace(char c)
+{
+	return (c >= 9 && c <= 13) || c == 32;
+}
+
+// Same grammar as parse_DIMACS_main(), except that a comment may also start
+// in the middle of a clause (any line starting with 'c').
+static void tokenize(DimacsChunk& chunk, const char* fileEnd)
+{
+	const char* p = chunk.begin;
+	const char* const end = chunk.end;
+
+	auto fail = [&](bool header) {
+		chunk.failed = true;
+		chunk.failedHeader = header;
+		chunk.failedChar = (p < fileEnd) ? (unsigned char)*p : EOF;
+	};
+
+	auto readInt = [&](int& val) {
+		while (p < fileEnd && isSpace(*p)) ++p;
+
+		bool neg = false;
+		if (p < fileEnd && *p == '-') neg = true, ++p;
+		else if (p < fileEnd && *p == '+') ++p;
+
+		if (p >= fileEnd || *p < '0' || *p > '9') {
+			fail(false);
+			return false;
+		}
+
+		val = 0;
+		while (p < fileEnd && *p >= '0' && *p <= '9') {
+			val = val * 10 + (*p - '0');
+			++p;
+		}
+		if (neg) val = -val;
+		return true;
+	};
+
+	// Rough guess: one literal per four bytes.
+	chunk.tokens.reserve((end - p) / 4);
+
+	while (p < end) {
+		if (isSpace(*p)) {
+			++p;
+		}
+		else if (*p == 'c') {
+			while (p < end && *p != '\n') ++p;
+		}
+		else if (*p == 'p') {
+			const char* pattern = "p cnf";
+			for (; *pattern != '\0'; ++pattern, ++p) {
+				if (p >= fileEnd || *p != *pattern) {
+					fail(true);
+					return;
+				}
+			}
+
+			int vars, clauses;
+			if (!readInt(vars) || !readInt(clauses)) return;
+			chunk.headerClauses = clauses;
+		}
+		else {
+			int lit;
+			if (!readInt(lit)) return;
+			chunk.tokens.push_back(lit);
+			chunk.maxVar = std::max(chunk.maxVar, abs(lit));
+		}
+	}
+}
+
+// Tokenise the text in parallel, and add the clauses in order. On a parse
+// error, the message is written to error, if given; otherwise the program
+// terminates, as in parse_DIMACS().
+static bool loadDimacsChunks(const char* data, size_t n, SimpSolver& S, bool strictp, int threads, std::string* error)
+{
+	// Cut the text into chunks of at least 1 MB, at line boundaries.
+	if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	const size_t minChunk = 1024 * 1024;
+	const size_t numChunks = std::max((size_t)1, std::min((size_t)threads, n / minChunk));
+
+	std::vector<DimacsChunk> chunks(numChunks);
+	const char* const end = data + n;
+	const char* p = data;
+	for (size_t k = 0; k < numChunks; ++k) {
+		const char* q = (k + 1 == numChunks) ? end : data + (k + 1) * (n / numChunks);
+		while (q < end && q[-1] != '\n') ++q;
+		if (q < p) q = p;
+
+		chunks[k].begin = p;
+		chunks[k].end = q;
+		p = q;
+	}
+
+	std::vector<std::thread> workers;
+	for (size_t k = 1; k < numChunks; ++k) {
+		workers.emplace_back([&chunks, k, end]() { tokenize(chunks[k], end); });
+	}
+	tokenize(chunks[0], end);
+
+	// Add the clauses in file order, while the later chunks are still being
+	// tokenised.
+	vec<Lit> lits;
+	int clauses = -1;
+	int cnt = 0;
+	for (size_t k = 0; k < numChunks; ++k) {
+		if (k > 0) workers[k - 1].join();
+
+		auto& chunk = chunks[k];
+		while (S.nVars() < chunk.maxVar) S.newVar();
+		if (chunk.headerClauses >= 0) clauses = chunk.headerClauses;
+
+		for (auto x : chunk.tokens) {
+			if (x == 0) {
+				cnt++;
+				S.addClause_(lits);
+				lits.clear();
+			}
+			else {
+				int var = abs(x) - 1;
+				lits.push((x > 0) ? mkLit(var) : ~mkLit(var));
+			}
+		}
+		std::vector<int>().swap(chunk.tokens);
+
+		if (chunk.failed) {
+			for (size_t l = k; l < workers.size(); ++l) workers[l].join();
+			if (error) {
+				*error = "PARSE ERROR! Unexpected char: " + std::string(1, (char)chunk.failedChar);
+				return false;
+			}
+			if (chunk.failedHeader) printf("PARSE ERROR! Unexpected char: %c\n", chunk.failedChar), exit(3);
+			else fprintf(stderr, "PARSE ERROR! Unexpected char: %c\n", chunk.failedChar), exit(3);
+		}
+	}
+
+	// A clause without the terminating zero.
+	if (lits.size() > 0) {
+		if (error) {
+			*error = "PARSE ERROR! Unexpected end of input";
+			return false;
+		}
+		fprintf(stderr, "PARSE ERROR! Unexpected char: %c\n", EOF), exit(3);
+	}
+	if (strictp && cnt != clauses) {
+		if (error) {
+			*error = "PARSE ERROR! DIMACS header mismatch: wrong number of clauses";
+			return false;
+		}
+		printf("PARSE ERROR! DIMACS header mismatch: wrong number of clauses\n");
+	}
+	return true;
+}
+
+#ifndef _WIN32
+
+// Returns false if the file cannot be mapped (e.g. it is a pipe) or is
+// compressed; in that case, nothing has been read into the solver.
+static bool loadDimacsMapped(const char* path, SimpSolver& S, bool strictp, int threads)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < 2) {
+		close(fd);
+		return false;
+	}
+
+	const size_t n = st.st_size;
+	void* map = mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) return false;
+
+	const char* data = (const char*)map;
+	if ((unsigned char)data[0] == 0x1f && (unsigned char)data[1] == 0x8b) {
+		munmap(map, n);
+		return false;
+	}
+	madvise(map, n, MADV_SEQUENTIAL);
+
+	loadDimacsChunks(data, n, S, strictp, threads, NULL);
+	munmap(map, n);
+	return true;
+}
+
+#endif
+
+//=================================================================================================
+
+bool loadDimacs(const char* path, SimpSolver& S, bool strictp, int threads)
+{
+#ifndef _WIN32
+	if (path != NULL && loadDimacsMapped(path, S, strictp, threads)) {
+		return true;
+	}
+#endif
+
+	gzFile in = (path == NULL) ? gzdopen(0, "rb") : gzopen(path, "rb");
+	return loadDimacsStream(in, S, strictp);
+}
+
+bool loadDimacsText(const char* data, size_t n, SimpSolver& S, bool strictp, int threads, std::string& error)
+{
+	return loadDimacsChunks(data, n, S, strictp, threads, &error);
+}
+
+bool readInput(const char* path, std::string& text)
+{
+	gzFile in = gzopen(path, "rb");
+	if (in == NULL) return false;
+
+	char block[65536];
+	int n;
+	while ((n = gzread(in, block, sizeof(block))) > 0) {
+		text.append(block, n);
+	}
+	gzclose(in);
+	return n == 0;
+}
+
+} // namespace Minisat
@@ -0,0 +1,52 @@
+/*********************************************************************************[DimacsLoader.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef DimacsLoaderH
+#define DimacsLoaderH
+
+#include <string>
+
+#include "minisat/simp/SimpSolver.h"
+
+namespace Minisat
+{
+// Read a DIMACS problem into the solver, as parse_DIMACS() does, but faster
+// for big inputs:
+//   - A plain (uncompressed) file is memory-mapped and cut into chunks at
+//     line boundaries. The chunks are tokenised on up to `threads` threads
+//     (0 = one per core), and the clauses are then added in file order.
+//   - Gzipped input, standard input, and anything that cannot be mapped is
+//     decompressed by a separate thread, while this thread parses.
+//
+// If path is NULL, standard input is read. Returns false if the input could
+// not be opened. Parse errors terminate the program, as in parse_DIMACS().
+bool loadDimacs(const char* path, SimpSolver& S, bool strictp, int threads);
+
+// Read a DIMACS problem from the text, as the memory-mapped files above.
+// A parse error does not terminate the program: the message is written to
+// error, and false is returned (with part of the problem read).
+bool loadDimacsText(const char* data, size_t n, SimpSolver& S, bool strictp, int threads, std::string& error);
+
+// Read the whole file, plain or gzipped, into text. Returns false if it
+// could not be read.
+bool readInput(const char* path, std::string& text);
+
+} // namespace Minisat
+
+#endif
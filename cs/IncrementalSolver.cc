@@ -0,0 +1,120 @@
+/***************************************************************************[IncrementalSolver.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include "IncrementalSolver.h"
+
+namespace Minisat
+{
+IncrementalSolver::IncrementalSolver()
+{
+	S.verbosity = 0;
+}
+
+Var IncrementalSolver::newVar()
+{
+	return S.newVar();
+}
+
+int IncrementalSolver::nVars() const
+{
+	return S.nVars();
+}
+
+bool IncrementalSolver::addClause(const vec<Lit>& lits)
+{
+	return S.addClause(lits);
+}
+
+void IncrementalSolver::setFrozen(Var v, bool b)
+{
+	S.setFrozen(v, b);
+}
+
+void IncrementalSolver::disableElimination()
+{
+	// With no clauses yet, this only frees the elimination state.
+	S.eliminate(true);
+}
+
+lbool IncrementalSolver::solve(const vec<Lit>& assumps)
+{
+	return S.interleavedSolve(assumps);
+}
+
+lbool IncrementalSolver::solve()
+{
+	return S.interleavedSolve();
+}
+
+lbool IncrementalSolver::modelValue(Var v) const
+{
+	return S.modelValue(v);
+}
+
+lbool IncrementalSolver::modelValue(Lit L) const
+{
+	return S.modelValue(L);
+}
+
+const LSet& IncrementalSolver::conflict() const
+{
+	return S.conflict;
+}
+
+bool IncrementalSolver::failed(Lit L)
+{
+	return S.conflict.has(~L);
+}
+
+bool IncrementalSolver::okay() const
+{
+	return S.okay();
+}
+
+void IncrementalSolver::setConfBudget(int64_t x)
+{
+	S.setConfBudget(x);
+}
+
+void IncrementalSolver::budgetOff()
+{
+	S.budgetOff();
+}
+
+void IncrementalSolver::interrupt()
+{
+	S.interrupt();
+}
+
+void IncrementalSolver::clearInterrupt()
+{
+	S.clearInterrupt();
+}
+
+CubifyingSolver& IncrementalSolver::solver()
+{
+	return S;
+}
+
+const CubifyingSolver& IncrementalSolver::solver() const
+{
+	return S;
+}
+
+} // namespace Minisat
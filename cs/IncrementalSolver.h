@@ -0,0 +1,94 @@
+/****************************************************************************[IncrementalSolver.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef IncrementalSolverH
+#define IncrementalSolverH
+
+#include "CubifyingSolver.h"
+
+namespace Minisat
+{
+// The library interface (libminisat_cubing): a cubifying solver for many
+// related queries, as in bounded model checking. Add clauses, solve under
+// assumptions, and read the model or the final conflict.
+//
+// All of the queries go to the same CubifyingSolver, so the cube queue, the
+// index of refuted cubes, the literal difficulties and the clause indices
+// carry over: the cubes scored for one query are searched in the next one.
+//
+// As with SimpSolver, variables are eliminated when solving, unless
+// elimination is turned off (disableElimination()). A variable that is to be
+// used in later clauses or assumptions must be frozen first (setFrozen()).
+//
+// The parameters are those of the command line defaults; they can be tuned
+// through solver().
+class IncrementalSolver
+{
+public:
+	IncrementalSolver();
+
+	Var newVar();
+	int nVars() const;
+
+	// Returns false if the problem is UNSAT already.
+	bool addClause(const vec<Lit>&);
+
+	void setFrozen(Var, bool);
+
+	// Turn variable elimination off for good. Call before adding clauses.
+	void disableElimination();
+
+	// Solve under the assumptions. Returns l_Undef if the budget ran out or
+	// the solver was interrupted.
+	lbool solve(const vec<Lit>& assumps);
+	lbool solve();
+
+	// The model of the last query, if it was SAT.
+	lbool modelValue(Var) const;
+	lbool modelValue(Lit) const;
+
+	// The final conflict of the last query, if it was UNSAT: a clause of
+	// negated assumptions. Empty if the problem is UNSAT by itself.
+	const LSet& conflict() const;
+
+	// Is the assumption part of the final conflict?
+	bool failed(Lit);
+
+	// Is the problem still satisfiable, as far as is known?
+	bool okay() const;
+
+	// Limit the conflicts of the next queries, or lift the limit.
+	void setConfBudget(int64_t);
+	void budgetOff();
+
+	// Make the current query return l_Undef soon. Safe to call from another
+	// thread. The flag stays set until clearInterrupt().
+	void interrupt();
+	void clearInterrupt();
+
+	CubifyingSolver& solver();
+	const CubifyingSolver& solver() const;
+
+protected:
+	CubifyingSolver S;
+};
+
+} // namespace Minisat
+
+#endif
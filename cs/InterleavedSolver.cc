@@ -20,18 +20,65 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 **************************************************************************************************/
 
 #include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include "InterleavedSolver.h"
+#include "Snapshot.h"
 
 namespace Minisat
 {
+namespace
+{
+double wallTime()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+}
 
 lbool InterleavedSolver::interleavedSolve()
+{
+    assumptions.clear();
+    return interleavedSolve_();
+}
+
+lbool InterleavedSolver::interleavedSolve(const vec<Lit>& assumps)
+{
+    assumps.copyTo(assumptions);
+    return interleavedSolve_();
+}
+
+lbool InterleavedSolver::interleavedSolve_()
 {
     vec<Var> extra_frozen;
     lbool result = l_True;
 
     if (use_simplification) {
+        // Assumptions must be temporarily frozen to run variable elimination.
+        for (int i = 0; i < assumptions.size(); i++) {
+            Var v = var(assumptions[i]);
+            assert(!isEliminated(v));
+
+            if (!frozen[v]) {
+                setFrozen(v, true);
+                extra_frozen.push(v);
+            }
+        }
+
         result = lbool(eliminate(false));
+
+        // The clauses removed by elimination stay in the clause vector until
+        // the next garbage collection; the steps should only see live ones.
+        if (result == l_True && ca.wasted() > 0) {
+            garbageCollect();
+        }
     }
 
     if (result == l_True) {
@@ -45,6 +92,10 @@ lbool InterleavedSolver::interleavedSolve()
         extendModel();
     }
 
+    for (int i = 0; i < extra_frozen.size(); i++) {
+        setFrozen(extra_frozen[i], false);
+    }
+
     return result;
 }
 
@@ -82,10 +133,17 @@ lbool InterleavedSolver::interleavedSolveInternal()
     if (!ok) return l_False;
 
     // Set the initial learnt clause budget, as well as the schedule
-    // for increasing it.
-    max_learnts = std::max(int(nClauses() * learntsize_factor), min_learnts_lim);
-    learntsize_adjust_confl = learntsize_adjust_start_confl;
-    learntsize_adjust_cnt = (int)learntsize_adjust_confl;
+    // for increasing it. A resumed run has them from the checkpoint.
+    int first_restart = 0;
+    if (resumeRestart >= 0) {
+        first_restart = resumeRestart;
+        resumeRestart = -1;
+    }
+    else {
+        max_learnts = std::max(int(nClauses() * learntsize_factor), min_learnts_lim);
+        learntsize_adjust_confl = learntsize_adjust_start_confl;
+        learntsize_adjust_cnt = (int)learntsize_adjust_confl;
+    }
 
     // Print the head of the solving statistics table.
     if (verbosity >= 1) printStatTableHead();
@@ -95,7 +153,8 @@ lbool InterleavedSolver::interleavedSolveInternal()
 
     // Run the solver under the current restart policy.
     lbool status = l_Undef;
-    for (int curr_restarts = 0; status == l_Undef; curr_restarts++) {
+    checkpointTime = wallTime();
+    for (int curr_restarts = first_restart; status == l_Undef; curr_restarts++) {
         // Find the budget for this solver run.
         double budget;
         if (luby_restart) {
@@ -114,15 +173,19 @@ lbool InterleavedSolver::interleavedSolveInternal()
         //  - out of allowed conflicts
         //  - out of allowed propagations
         if (!withinBudget()) break;
+
+        if (status == l_Undef) maybeCheckpoint(curr_restarts + 1);
     }
+    finishCheckpoint(true);
 
     // Print the end of the solving statistics table.
     if (verbosity >= 1) printStatTableEnd();
 
     // If solving succeeded, update the internal state:
-    //  - If a satisfying assignment was found, extend the model.
+    //  - If a satisfying assignment was found, extend the model (unless the
+    //    step already provided one, e.g. from a cube worker).
     //  - If unsatisfiability was detected, mark us UNSAT.
-    if (status == l_True) {
+    if (status == l_True && model.size() == 0) {
         model.growTo(nVars());
         for (int i = 0; i < nVars(); i++) model[i] = value(i);
     }
@@ -134,6 +197,92 @@ lbool InterleavedSolver::interleavedSolveInternal()
     return status;
 }
 
+void InterleavedSolver::saveCheckpoint(SnapshotWriter& out)
+{
+    saveSnapshot(out);
+
+    out.putValue(checkpointRestart);
+    out.putValue(max_learnts);
+    out.putValue(learntsize_adjust_confl);
+    out.putValue(learntsize_adjust_cnt);
+    out.putValue(random_seed);
+}
+
+bool InterleavedSolver::loadCheckpoint(SnapshotReader& in)
+{
+    if (!loadSnapshot(in)) return false;
+
+    in.getValue(resumeRestart);
+    in.getValue(max_learnts);
+    in.getValue(learntsize_adjust_confl);
+    in.getValue(learntsize_adjust_cnt);
+    in.getValue(random_seed);
+
+    return in.ok() && resumeRestart >= 0;
+}
+
+void InterleavedSolver::maybeCheckpoint(int nextRestart)
+{
+    if (checkpointPath.empty() || use_simplification || assumptions.size() > 0 || decisionLevel() > 0) {
+        return;
+    }
+
+    // Do not start another writer while the last one runs.
+    finishCheckpoint(false);
+    if (checkpointWriter != 0 || wallTime() - checkpointTime < checkpointInterval) return;
+
+    checkpointTime = wallTime();
+    checkpointRestart = nextRestart;
+    const std::string tmp = checkpointPath + ".tmp";
+
+#ifndef _WIN32
+    // The child has a copy-on-write image of the solver as it is now, and
+    // only this thread; it must not return into the search, nor run exit
+    // handlers that flush the buffers of the parent.
+    const pid_t pid = fork();
+    if (pid == 0) {
+        SnapshotWriter out(tmp.c_str());
+        saveCheckpoint(out);
+        const bool written = out.close() && rename(tmp.c_str(), checkpointPath.c_str()) == 0;
+        _exit(written ? 0 : 1);
+    }
+    else if (pid > 0) {
+        checkpointWriter = pid;
+        return;
+    }
+#endif
+
+    // No fork: write it here, stalling the search.
+    SnapshotWriter out(tmp.c_str());
+    saveCheckpoint(out);
+    if (out.close() && rename(tmp.c_str(), checkpointPath.c_str()) == 0) {
+        checkpoints++;
+    }
+    else {
+        printf("WARNING! Could not write checkpoint: %s\n", checkpointPath.c_str());
+    }
+}
+
+void InterleavedSolver::finishCheckpoint(bool wait)
+{
+#ifndef _WIN32
+    if (checkpointWriter == 0) return;
+
+    int status = 0;
+    pid_t pid;
+    while ((pid = waitpid(checkpointWriter, &status, wait ? 0 : WNOHANG)) < 0 && errno == EINTR);
+    if (pid == 0) return;
+
+    checkpointWriter = 0;
+    if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        checkpoints++;
+    }
+    else {
+        printf("WARNING! Could not write checkpoint: %s\n", checkpointPath.c_str());
+    }
+#endif
+}
+
 int InterleavedSolver::luby(int x) const
 {
     int size = 1;
@@ -20,12 +20,14 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef InterleavedSolverH
 #define InterleavedSolverH
 
+#include <string>
+
 #include "minisat/simp/SimpSolver.h"
 
 namespace Minisat
 {
-// This class generalizes the solving procedure of SimpSolver (in the
-//no-assumptions case). The original procedure is as follows:
+// This class generalizes the solving procedure of SimpSolver. The original
+// procedure is as follows:
 //
 //   1. Run elimination (unless disabled)
 //   2. Solver loop:
@@ -41,6 +43,11 @@ namespace Minisat
 // The name "interleaved" refers to the use case of doing something in
 // addition to the search() call, rather than instead of it. The result is
 // that the search() calls are "interleaved" with this other code.
+//
+// As with SimpSolver::solve(), the solver can be used incrementally: clauses
+// may be added between the calls, and each call may have assumptions. The
+// state of the inheriting class survives from one call to the next, except
+// that bootstrap() runs again at the start of each.
 class InterleavedSolver : public SimpSolver
 {
 public:
@@ -50,6 +57,33 @@ public:
     // Call this instead of solve() in order to use the interleaved procedure
     lbool interleavedSolve();
 
+    // The same, under assumptions. If the result is l_False, conflict holds
+    // the final conflict clause, expressed in the assumptions (as in
+    // Solver::solve()).
+    lbool interleavedSolve(const vec<Lit>& assumps);
+
+    // Continue from a checkpoint (see checkpointPath), instead of reading a
+    // problem: the next call to interleavedSolve() picks up the run at the
+    // step after the one that wrote it. Requires a solver without variables.
+    // Inheriting classes read their own state after that of this class.
+    virtual bool loadCheckpoint(SnapshotReader& in);
+
+    // If set, the state of the run is written to this file every
+    // checkpointInterval seconds, between two steps, at decision level 0. It
+    // is a snapshot of the solver (see Solver::saveSnapshot()), followed by
+    // the state of the restart loop and that of the inheriting classes.
+    //
+    // The file is written by a forked copy of the process, so the search
+    // goes on meanwhile; it is written under a temporary name, and renamed
+    // once complete. If the previous checkpoint is still being written, the
+    // next one is skipped. Only calls without assumptions and with
+    // simplification turned off write checkpoints.
+    std::string checkpointPath;
+    double checkpointInterval = 300.0;
+
+    // Counter: how many checkpoints have been written?
+    uint64_t checkpoints = 0;
+
 protected:
     // This function is executed before the solver loop.
     virtual void bootstrap();
@@ -64,7 +98,14 @@ protected:
     virtual void printStatTableHead() const;
     virtual void printStatTableEnd() const;
 
+    // Write the state for loadCheckpoint(). Inheriting classes write their
+    // own state after that of this class.
+    virtual void saveCheckpoint(SnapshotWriter& out);
+
 protected:
+    // Main procedure (assumptions given in 'assumptions').
+    lbool interleavedSolve_();
+
     lbool interleavedSolveInternal();
 
     // Returns the x:th element of the Luby sequence.
@@ -76,6 +117,22 @@ protected:
     int toDimacsInt(Lit L) const;
 
 	void checkSane();
+
+    // Write a checkpoint, if one is due (see checkpointPath). The run is to
+    // go on at step nextRestart.
+    void maybeCheckpoint(int nextRestart);
+
+    // Wait for the checkpoint being written, if any, and count it.
+    void finishCheckpoint(bool wait);
+
+    // Step that the run goes on at: from the checkpoint being written, and
+    // in the next call, if loadCheckpoint() was called (-1 otherwise).
+    int checkpointRestart = 0;
+    int resumeRestart = -1;
+
+    // Time of the last checkpoint, and the process writing the current one.
+    double checkpointTime = 0.0;
+    int checkpointWriter = 0;
 };
 
 } // namespace Minisat
@@ -0,0 +1,139 @@
+/********************************************************************************[PerfCounters.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Minisat
+{
+PerfCounters::Sample PerfCounters::Sample::operator-(const Sample& other) const
+{
+	Sample s;
+	for (int e = 0; e < NumEvents; ++e) {
+		s.counts[e] = counts[e] - other.counts[e];
+	}
+	return s;
+}
+
+PerfCounters::Sample& PerfCounters::Sample::operator+=(const Sample& other)
+{
+	for (int e = 0; e < NumEvents; ++e) {
+		counts[e] += other.counts[e];
+	}
+	return *this;
+}
+
+#ifdef __linux__
+PerfCounters::PerfCounters()
+{
+	const uint32_t types[NumEvents] = {
+		PERF_TYPE_HARDWARE,
+		PERF_TYPE_HARDWARE,
+		PERF_TYPE_HW_CACHE,
+		PERF_TYPE_HARDWARE,
+		PERF_TYPE_HARDWARE,
+	};
+	const uint64_t configs[NumEvents] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_L1D
+			| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES,
+	};
+
+	for (int e = 0; e < NumEvents; ++e) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = types[e];
+		attr.config = configs[e];
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.inherit = 1;
+
+		fds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+	for (int e = 0; e < NumEvents; ++e) {
+		if (fds[e] >= 0) close(fds[e]);
+	}
+}
+
+PerfCounters::Sample PerfCounters::read() const
+{
+	Sample s;
+	for (int e = 0; e < NumEvents; ++e) {
+		uint64_t count;
+		if (fds[e] >= 0 && ::read(fds[e], &count, sizeof(count)) == sizeof(count)) {
+			s.counts[e] = count;
+		}
+	}
+	return s;
+}
+#else
+PerfCounters::PerfCounters()
+{
+	for (int e = 0; e < NumEvents; ++e) {
+		fds[e] = -1;
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+PerfCounters::Sample PerfCounters::read() const
+{
+	return Sample();
+}
+#endif
+
+bool PerfCounters::available(int event) const
+{
+	return fds[event] >= 0;
+}
+
+bool PerfCounters::available() const
+{
+	for (int e = 0; e < NumEvents; ++e) {
+		if (available(e)) return true;
+	}
+	return false;
+}
+
+const char* PerfCounters::name(int event)
+{
+	static const char* names[NumEvents] = {
+		"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+	};
+	return names[event];
+}
+
+} // namespace Minisat
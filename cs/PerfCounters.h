@@ -0,0 +1,79 @@
+/*********************************************************************************[PerfCounters.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef PerfCountersH
+#define PerfCountersH
+
+#include <cstdint>
+
+namespace Minisat
+{
+// Hardware performance counters of the calling thread, and of the threads it
+// starts afterwards (counted once they have finished), in user space.
+//
+// Uses perf_event_open, so only Linux is supported; elsewhere, or where the
+// kernel does not allow it, no counter is available and they all read 0.
+//
+// Only compiled in with CS_PERF_COUNTERS (e.g. make CXX_EXTRA=-DCS_PERF_COUNTERS).
+class PerfCounters
+{
+public:
+	enum Event
+	{
+		Cycles,
+		Instructions,
+		L1dMisses,
+		LlcMisses,
+		BranchMisses,
+		NumEvents
+	};
+
+	// A reading of every event.
+	struct Sample
+	{
+		uint64_t counts[NumEvents] = {};
+
+		Sample operator-(const Sample&) const;
+		Sample& operator+=(const Sample&);
+	};
+
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// Is the counter for the event open?
+	bool available(int event) const;
+
+	// Is any counter open?
+	bool available() const;
+
+	Sample read() const;
+
+	// Short name of the event, e.g. for JSON keys.
+	static const char* name(int event);
+
+private:
+	int fds[NumEvents];
+};
+
+} // namespace Minisat
+
+#endif
@@ -0,0 +1,126 @@
+/**********************************************************************************[PhaseBandit.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef PhaseBanditH
+#define PhaseBanditH
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Multi-armed bandit for choosing between a fixed set of configurations,
+// when the payoff of each one drifts over time.
+//
+// This is discounted UCB1: each arm keeps a count and a sum of the rewards
+// it got, and on every update, all of the counts and sums are multiplied by
+// gamma, so that old observations fade away. The arm played next is one
+// that has not been played yet, or else the one with the greatest
+//   mean reward + c * sqrt(log(total count) / count).
+//
+// Rewards can be on any non-negative scale; they are divided by the largest
+// reward seen so far.
+class PhaseBandit
+{
+public:
+	PhaseBandit(int arms, double gamma=0.95, double c=0.5);
+
+	// The arm to play next.
+	int choose() const;
+
+	// Record the reward for playing the arm.
+	void update(int arm, double reward);
+
+	int arms() const;
+
+	// How many times has the arm been played (not discounted)?
+	uint64_t plays(int arm) const;
+
+private:
+	double gamma;
+	double c;
+	double maxReward = 0.0;
+
+	// Discounted count and reward sum, by arm.
+	std::vector<double> counts;
+	std::vector<double> sums;
+	std::vector<uint64_t> played;
+};
+
+// Implementation below
+
+inline PhaseBandit::PhaseBandit(int arms, double gamma, double c) :
+	gamma(gamma),
+	c(c),
+	counts(arms, 0.0),
+	sums(arms, 0.0),
+	played(arms, 0)
+{
+}
+
+inline int PhaseBandit::choose() const
+{
+	double total = 0.0;
+	for (int i = 0; i < arms(); ++i) {
+		if (played[i] == 0) return i;
+		total += counts[i];
+	}
+
+	int best = 0;
+	double bestIndex = -HUGE_VAL;
+	for (int i = 0; i < arms(); ++i) {
+		double mean = (maxReward > 0.0) ? sums[i] / (counts[i] * maxReward) : 0.0;
+		double index = mean + c * std::sqrt(std::log(total) / counts[i]);
+		if (index > bestIndex) {
+			best = i;
+			bestIndex = index;
+		}
+	}
+	return best;
+}
+
+inline void PhaseBandit::update(int arm, double reward)
+{
+#ifndef NO_CS_ASSERTS
+	assert(arm >= 0 && arm < arms());
+	assert(reward >= 0.0);
+#endif
+
+	for (int i = 0; i < arms(); ++i) {
+		counts[i] *= gamma;
+		sums[i] *= gamma;
+	}
+
+	counts[arm] += 1.0;
+	sums[arm] += reward;
+	played[arm]++;
+	if (reward > maxReward) maxReward = reward;
+}
+
+inline int PhaseBandit::arms() const
+{
+	return counts.size();
+}
+
+inline uint64_t PhaseBandit::plays(int arm) const
+{
+	return played[arm];
+}
+
+#endif
@@ -0,0 +1,154 @@
+/*********************************************************************************[ProofWriter.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <cstring>
+#include <zlib.h>
+
+#include "ProofWriter.h"
+
+namespace Minisat
+{
+
+ProofWriter::ProofWriter(const char* path, size_t chunkSize, int chunks) :
+	chunkSize(chunkSize),
+	chunks(chunks),
+	buffer(chunkSize * chunks),
+	fill(chunks, 0)
+{
+	const size_t n = strlen(path);
+	if (n > 3 && strcmp(path + n - 3, ".gz") == 0) {
+		gz = gzopen(path, "wb1");
+	}
+	else {
+		file = fopen(path, "wb");
+	}
+	failed = (file == nullptr && gz == nullptr);
+
+	pos = buffer.data();
+	end = pos + chunkSize;
+	if (!failed) {
+		writer = std::thread(&ProofWriter::run, this);
+	}
+}
+
+ProofWriter::~ProofWriter()
+{
+	close();
+}
+
+bool ProofWriter::ok() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return !failed;
+}
+
+void ProofWriter::addEmpty()
+{
+	put('a');
+	put(0);
+}
+
+uint64_t ProofWriter::bytes() const
+{
+	return totalBytes + (pos - (buffer.data() + current * chunkSize));
+}
+
+uint64_t ProofWriter::stalls() const
+{
+	return waits;
+}
+
+void ProofWriter::submit()
+{
+	uint8_t* begin = buffer.data() + current * chunkSize;
+	const size_t n = pos - begin;
+	totalBytes += n;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	fill[current] = n;
+	submitted++;
+	cv.notify_all();
+
+	// Without a writer, the chunk is just dropped.
+	if (writer.joinable() && submitted - written == (uint64_t)chunks) {
+		waits++;
+		cv.wait(lock, [this]() { return submitted - written < (uint64_t)chunks; });
+	}
+	lock.unlock();
+
+	current = (current + 1) % chunks;
+	pos = buffer.data() + current * chunkSize;
+	end = pos + chunkSize;
+}
+
+void ProofWriter::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		cv.wait(lock, [this]() { return written < submitted || closing; });
+		if (written == submitted) break;
+
+		// The chunk is not touched by the solver until it is counted as
+		// written.
+		const int k = written % chunks;
+		const uint8_t* data = buffer.data() + k * chunkSize;
+		const size_t n = fill[k];
+		lock.unlock();
+
+		bool good = true;
+		if (gz != nullptr) {
+			good = n == 0 || gzwrite(gz, data, (unsigned)n) == (int)n;
+		}
+		else {
+			good = n == 0 || fwrite(data, n, 1, file) == 1;
+		}
+
+		lock.lock();
+		failed |= !good;
+		written++;
+		cv.notify_all();
+	}
+}
+
+bool ProofWriter::close()
+{
+	if (file == nullptr && gz == nullptr) return !failed;
+
+	if (writer.joinable()) {
+		submit();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+			cv.notify_all();
+		}
+		writer.join();
+	}
+
+	if (gz != nullptr) {
+		failed |= gzclose(gz) != Z_OK;
+		gz = nullptr;
+	}
+	if (file != nullptr) {
+		failed |= fclose(file) != 0;
+		file = nullptr;
+	}
+	return !failed;
+}
+
+} // namespace Minisat
@@ -0,0 +1,158 @@
+/**********************************************************************************[ProofWriter.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef ProofWriterH
+#define ProofWriterH
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "minisat/core/SolverTypes.h"
+
+struct gzFile_s;
+
+namespace Minisat
+{
+// Binary DRAT proof output (see Solver::proof).
+//
+// Each step is 'a' for an added clause or 'd' for a deleted one, followed by
+// the literals, each as the unsigned number 2 * (var + 1) + sign in seven-bit
+// groups, low ones first, and a zero byte.
+//
+// The steps are appended to a ring of chunks. Once a chunk is full, it is
+// handed to a thread that writes it out (through gzip, if the path ends in
+// ".gz") while the solver goes on with the next chunk. The solver only waits
+// if every chunk is waiting to be written.
+class ProofWriter
+{
+public:
+	explicit ProofWriter(const char* path, size_t chunkSize = 1 << 20, int chunks = 16);
+	~ProofWriter();
+
+	// Was the file opened, and has everything been written so far?
+	bool ok() const;
+
+	// Any sequence of literals with size() and operator[], e.g. a Clause.
+	template<class Lits>
+	void add(const Lits& c);
+	template<class Lits>
+	void remove(const Lits& c);
+
+	// The empty clause, at the end of a refutation.
+	void addEmpty();
+
+	// Write out the rest, and close the file. Returns false if anything could
+	// not be written.
+	bool close();
+
+	// Bytes of proof so far (before compression), and how many times the
+	// solver had to wait for a chunk.
+	uint64_t bytes() const;
+	uint64_t stalls() const;
+
+private:
+	template<class Lits>
+	void step(uint8_t kind, const Lits& c);
+
+	void put(uint8_t b);
+	void putLit(Lit p);
+
+	// Hand the current chunk to the writer, and wait for the next one to be
+	// free.
+	void submit();
+
+	// Body of the writer thread.
+	void run();
+
+	// The output: a plain file or a gzip stream.
+	FILE* file = nullptr;
+	gzFile_s* gz = nullptr;
+
+	// The ring: chunks of chunkSize bytes, back to back, and the number of
+	// bytes in each.
+	size_t chunkSize;
+	int chunks;
+	std::vector<uint8_t> buffer;
+	std::vector<size_t> fill;
+
+	// The chunk being filled, and its write position.
+	int current = 0;
+	uint8_t* pos;
+	uint8_t* end;
+
+	// Chunks handed to the writer, and written by it, so far.
+	mutable std::mutex mutex;
+	std::condition_variable cv;
+	uint64_t submitted = 0;
+	uint64_t written = 0;
+	bool closing = false;
+	bool failed = false;
+
+	uint64_t totalBytes = 0;
+	uint64_t waits = 0;
+	std::thread writer;
+};
+
+// Implementation below
+
+template<class Lits>
+inline void ProofWriter::add(const Lits& c)
+{
+	step('a', c);
+}
+
+template<class Lits>
+inline void ProofWriter::remove(const Lits& c)
+{
+	step('d', c);
+}
+
+template<class Lits>
+inline void ProofWriter::step(uint8_t kind, const Lits& c)
+{
+	put(kind);
+	for (int i = 0; i < c.size(); ++i) {
+		putLit(c[i]);
+	}
+	put(0);
+}
+
+inline void ProofWriter::put(uint8_t b)
+{
+	if (pos == end) submit();
+	*pos++ = b;
+}
+
+inline void ProofWriter::putLit(Lit p)
+{
+	uint32_t x = 2 * (var(p) + 1) + sign(p);
+	while (x > 127) {
+		put(uint8_t(x | 128));
+		x >>= 7;
+	}
+	put(uint8_t(x));
+}
+
+} // namespace Minisat
+
+#endif
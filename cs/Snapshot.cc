@@ -0,0 +1,180 @@
+/************************************************************************************[Snapshot.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Snapshot.h"
+
+namespace Minisat
+{
+
+namespace
+{
+// File header: magic, format version, and a byte order mark.
+const char Magic[8] = { 'M', 'C', 'S', 'N', 'A', 'P', '\0', '\0' };
+const uint32_t Version = 4;
+const uint32_t ByteOrder = 0x01020304;
+
+struct BlockHeader
+{
+	uint64_t n;
+	uint32_t elemSize;
+	uint32_t reserved;
+};
+
+inline size_t padded(size_t bytes)
+{
+	return (bytes + 7) & ~(size_t)7;
+}
+}
+
+SnapshotWriter::SnapshotWriter(const char* path) : failed(false)
+{
+	f = fopen(path, "wb");
+	if (f == NULL) {
+		failed = true;
+		return;
+	}
+
+	const uint32_t header[2] = { Version, ByteOrder };
+	failed |= fwrite(Magic, sizeof(Magic), 1, f) != 1;
+	failed |= fwrite(header, sizeof(header), 1, f) != 1;
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+	close();
+}
+
+void SnapshotWriter::putBytes(const void* data, size_t elemSize, size_t n)
+{
+	if (failed) return;
+
+	const BlockHeader header = { n, (uint32_t)elemSize, 0 };
+	const size_t bytes = elemSize * n;
+	static const char zeros[8] = { 0 };
+
+	failed |= fwrite(&header, sizeof(header), 1, f) != 1;
+	if (bytes > 0) {
+		failed |= fwrite(data, bytes, 1, f) != 1;
+	}
+	if (padded(bytes) > bytes) {
+		failed |= fwrite(zeros, padded(bytes) - bytes, 1, f) != 1;
+	}
+}
+
+bool SnapshotWriter::close()
+{
+	if (f != NULL) {
+		failed |= fclose(f) != 0;
+		f = NULL;
+	}
+	return !failed;
+}
+
+SnapshotReader::SnapshotReader(const char* path)
+{
+#ifndef _WIN32
+	int fd = open(path, O_RDONLY);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED) {
+				data = (const char*)map;
+				size = st.st_size;
+				mapped = true;
+			}
+		}
+		close(fd);
+	}
+#endif
+
+	if (!mapped) {
+		FILE* f = fopen(path, "rb");
+		if (f != NULL) {
+			char chunk[65536];
+			size_t n;
+			while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+				buffer.insert(buffer.end(), chunk, chunk + n);
+			}
+			fclose(f);
+		}
+		data = buffer.data();
+		size = buffer.size();
+	}
+
+	uint32_t header[2];
+	if (size < sizeof(Magic) + sizeof(header) || memcmp(data, Magic, sizeof(Magic)) != 0) {
+		failed = true;
+		return;
+	}
+
+	memcpy(header, data + sizeof(Magic), sizeof(header));
+	if (header[0] != Version || header[1] != ByteOrder) {
+		failed = true;
+		return;
+	}
+
+	pos = sizeof(Magic) + sizeof(header);
+}
+
+SnapshotReader::~SnapshotReader()
+{
+#ifndef _WIN32
+	if (mapped) {
+		munmap((void*)data, size);
+	}
+#endif
+}
+
+const void* SnapshotReader::getBytes(size_t elemSize, size_t& n)
+{
+	n = 0;
+	if (failed) return nullptr;
+
+	BlockHeader header;
+	if (size - pos < sizeof(header)) {
+		failed = true;
+		return nullptr;
+	}
+	memcpy(&header, data + pos, sizeof(header));
+	pos += sizeof(header);
+
+	if (header.elemSize != elemSize || header.n > (size - pos) / elemSize) {
+		failed = true;
+		return nullptr;
+	}
+
+	const size_t bytes = elemSize * header.n;
+	const char* p = data + pos;
+	pos += std::min(padded(bytes), size - pos);
+
+	n = header.n;
+	return p;
+}
+
+} // namespace Minisat
@@ -0,0 +1,190 @@
+/*************************************************************************************[Snapshot.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef SnapshotH
+#define SnapshotH
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "minisat/mtl/Vec.h"
+#include "minisat/mtl/IntMap.h"
+
+namespace Minisat
+{
+// Binary snapshot of a solver, e.g. right after preprocessing; see
+// Solver::saveSnapshot().
+//
+// The file is a short header followed by blocks, each an array of plain
+// values. A block starts with its length and element size, and is padded to
+// 8 bytes, so that the reader can use it in place in the memory-mapped file.
+// Blocks must be read in the order they were written.
+//
+// Snapshots are only meant to be read by the same build on the same kind of
+// machine; there is no attempt at portability.
+class SnapshotWriter
+{
+public:
+	explicit SnapshotWriter(const char* path);
+	~SnapshotWriter();
+
+	void putBytes(const void* data, size_t elemSize, size_t n);
+
+	template<class T>
+	void putArray(const T* data, size_t n);
+
+	template<class T>
+	void putValue(const T& x);
+
+	template<class T>
+	void putVec(const vec<T>& v);
+
+	// The first n entries of the map.
+	template<class V>
+	void putMap(const IntMap<int, V>& m, int n);
+
+	// Flush the file. Returns false if anything could not be written.
+	bool close();
+
+private:
+	FILE* f;
+	bool failed;
+};
+
+class SnapshotReader
+{
+public:
+	explicit SnapshotReader(const char* path);
+	~SnapshotReader();
+
+	// Was the file read, and has everything read so far matched what was
+	// asked for? Once false, all reads fail.
+	bool ok() const;
+
+	// The next block, in place. Fails if the element size does not match.
+	const void* getBytes(size_t elemSize, size_t& n);
+
+	template<class T>
+	bool getArray(const T*& data, size_t& n);
+
+	template<class T>
+	bool getValue(T& x);
+
+	template<class T>
+	bool getVec(vec<T>& v);
+
+	// Fill the first n entries of the map (reserving them, if needed). Fails
+	// if the block does not have exactly n entries.
+	template<class V>
+	bool getMap(IntMap<int, V>& m, int n);
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+	size_t pos = 0;
+	bool failed = false;
+
+	// Either the file is mapped, or it is read into the buffer.
+	bool mapped = false;
+	std::vector<char> buffer;
+};
+
+// Implementation below
+
+template<class T>
+inline void SnapshotWriter::putArray(const T* data, size_t n)
+{
+	putBytes(data, sizeof(T), n);
+}
+
+template<class T>
+inline void SnapshotWriter::putValue(const T& x)
+{
+	putBytes(&x, sizeof(T), 1);
+}
+
+template<class T>
+inline void SnapshotWriter::putVec(const vec<T>& v)
+{
+	putBytes((v.size() > 0) ? &v[0] : nullptr, sizeof(T), v.size());
+}
+
+template<class V>
+inline void SnapshotWriter::putMap(const IntMap<int, V>& m, int n)
+{
+	putBytes((n > 0) ? m.begin() : nullptr, sizeof(V), n);
+}
+
+inline bool SnapshotReader::ok() const
+{
+	return !failed;
+}
+
+template<class T>
+inline bool SnapshotReader::getArray(const T*& data, size_t& n)
+{
+	data = (const T*)getBytes(sizeof(T), n);
+	return !failed;
+}
+
+template<class T>
+inline bool SnapshotReader::getValue(T& x)
+{
+	size_t n;
+	const T* p;
+	if (!getArray(p, n) || n != 1) return failed = true, false;
+
+	memcpy(&x, p, sizeof(T));
+	return true;
+}
+
+template<class T>
+inline bool SnapshotReader::getVec(vec<T>& v)
+{
+	size_t n;
+	const T* p;
+	if (!getArray(p, n)) return false;
+
+	v.clear();
+	if (n > 0) {
+		v.growTo(n, p[0]);
+		memcpy((T*)v, p, n * sizeof(T));
+	}
+	return true;
+}
+
+template<class V>
+inline bool SnapshotReader::getMap(IntMap<int, V>& m, int n)
+{
+	size_t k;
+	const V* p;
+	if (!getArray(p, k) || k != (size_t)n) return failed = true, false;
+
+	if (n > 0) {
+		m.reserve(n - 1, p[0]);
+		memcpy(m.begin(), p, n * sizeof(V));
+	}
+	return true;
+}
+
+} // namespace Minisat
+
+#endif
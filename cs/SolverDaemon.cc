@@ -0,0 +1,192 @@
+/********************************************************************************[SolverDaemon.cc]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "DimacsLoader.h"
+#include "SolverDaemon.h"
+
+namespace Minisat
+{
+SolverDaemon::SolverDaemon(const std::string& path, int threads, MakeSolver make, Payload solve)
+	: path(path), threads(threads), make(make), solve(solve)
+{
+}
+
+#ifndef _WIN32
+
+bool SolverDaemon::run()
+{
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		printf("ERROR! Socket path is too long: %s\n", path.c_str());
+		return false;
+	}
+	path.copy(addr.sun_path, path.size());
+
+	int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(path.c_str());
+	if (server < 0 || bind(server, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(server, 64) != 0) {
+		printf("ERROR! Could not listen on socket %s\n", path.c_str());
+		if (server >= 0) close(server);
+		return false;
+	}
+
+	if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	printf("Serving on %s with %d threads\n", path.c_str(), threads);
+	fflush(stdout);
+
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; ++t) {
+		pool.emplace_back([this]() { serve(); });
+	}
+
+	for (;;) {
+		int fd = accept(server, NULL, NULL);
+		if (fd < 0) continue;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back(fd);
+		cv.notify_one();
+	}
+}
+
+void SolverDaemon::serve()
+{
+	// Kept from one solver to the next.
+	ClauseAllocator arena;
+
+	for (;;) {
+		int fd;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this]() { return !pending.empty(); });
+			fd = pending.front();
+			pending.pop_front();
+		}
+
+		LineSocket socket(fd);
+		std::string line, reply;
+		while (socket.readLine(line)) {
+			reply.clear();
+			if (!query(socket, line, arena, reply)) break;
+			if (!socket.send(reply)) break;
+		}
+	}
+}
+
+bool SolverDaemon::query(LineSocket& socket, const std::string& line, ClauseAllocator& arena, std::string& reply)
+{
+	if (line == "QUIT") {
+		return false;
+	}
+	else if (line.compare(0, 6, "SOLVE ") == 0) {
+		std::string text;
+		if (!readInput(line.c_str() + 6, text)) {
+			reply = "ERROR Could not open file: " + line.substr(6) + "\n";
+			return true;
+		}
+		solveText(text, arena, reply);
+		return true;
+	}
+	else if (line.compare(0, 7, "DIMACS ") == 0) {
+		char* end;
+		unsigned long long n = strtoull(line.c_str() + 7, &end, 10);
+		if (*end != '\0' || end == line.c_str() + 7) {
+			reply = "ERROR Bad length: " + line.substr(7) + "\n";
+			return true;
+		}
+
+		std::string text;
+		if (!socket.readBytes(n, text)) return false;
+		solveText(text, arena, reply);
+		return true;
+	}
+
+	reply = "ERROR Unknown query: " + line + "\n";
+	return true;
+}
+
+void SolverDaemon::solveText(const std::string& text, ClauseAllocator& arena, std::string& reply)
+{
+	std::unique_ptr<SimpSolver> S(make());
+	S->verbosity = 0;
+	S->reuseClauseMemory(arena);
+
+	lbool ret = l_Undef;
+	try {
+		if (!pre) S->eliminate(true);
+
+		std::string error;
+		if (!loadDimacsText(text.data(), text.size(), *S, strict, parseThreads, error)) {
+			reply = "ERROR " + error + "\n";
+			arena.reuse(S->ca);
+			return;
+		}
+
+		S->eliminate(true);
+		ret = S->okay() ? solve(S.get()) : l_False;
+	}
+	catch (OutOfMemoryException&) {
+		ret = l_Undef;
+	}
+	catch (std::bad_alloc&) {
+		ret = l_Undef;
+	}
+
+	// As Main.cc writes the result file.
+	if (ret == l_True) {
+		reply = "SAT\n";
+		bool first = true;
+		for (int i = 0; i < S->nVars(); i++) {
+			if (S->model[i] == l_Undef) continue;
+			if (!first) reply += ' ';
+			if (S->model[i] == l_False) reply += '-';
+			reply += std::to_string(i + 1);
+			first = false;
+		}
+		reply += " 0\n";
+	}
+	else {
+		reply = (ret == l_False) ? "UNSAT\n" : "INDET\n";
+	}
+
+	arena.reuse(S->ca);
+}
+
+#else
+
+bool SolverDaemon::run()
+{
+	printf("ERROR! The solver daemon is not supported on this platform\n");
+	return false;
+}
+
+#endif
+
+} // namespace Minisat
@@ -0,0 +1,94 @@
+/*********************************************************************************[SolverDaemon.h]
+Copyright (c) 2019, Joonas Lipping
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#ifndef SolverDaemonH
+#define SolverDaemonH
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "minisat/simp/SimpSolver.h"
+#include "CubeConquer.h"
+
+namespace Minisat
+{
+// A long-lived solver process, answering SAT queries on a Unix socket.
+//
+// Run as a process of its own, each query pays for starting the process,
+// parsing the options, and growing the clause memory from empty. The daemon
+// does the first two once. It solves the queries on a pool of threads, each
+// of which builds a new solver for every query (with the options given to
+// the daemon), but hands it the clause memory of the previous one, emptied.
+//
+// The protocol is line-based text, one query at a time on a connection:
+//   client: SOLVE <path>            (plain or gzipped DIMACS file)
+//   client: DIMACS <n>              followed by n bytes of DIMACS text
+//   daemon: SAT, then <model> 0 on a line of its own
+//         | UNSAT | INDET           as in the result file of minisat_cubing
+//         | ERROR <message>
+//   client: QUIT
+//
+// Only available on POSIX systems.
+class SolverDaemon
+{
+public:
+	typedef SimpSolver* (*MakeSolver)();
+	typedef lbool (*Payload)(Solver*);
+
+	// The solvers are created by make, and solved by solve, as in Main.cc.
+	// threads = 0 means one per core.
+	SolverDaemon(const std::string& path, int threads, MakeSolver make, Payload solve);
+
+	// Serve queries until the process is terminated. Returns false if the
+	// socket could not be set up.
+	bool run();
+
+	// Preprocess the problems? Validate the DIMACS headers? Threads for
+	// parsing each problem.
+	bool pre = true;
+	bool strict = false;
+	int parseThreads = 1;
+
+protected:
+	// A thread of the pool: serve connections, one at a time.
+	void serve();
+
+	// Answer the query that starts with the line; the reply is written to
+	// reply. Returns false if the connection is to be closed.
+	bool query(LineSocket& socket, const std::string& line, ClauseAllocator& arena, std::string& reply);
+
+	// Solve the problem in the text with a new solver.
+	void solveText(const std::string& text, ClauseAllocator& arena, std::string& reply);
+
+	std::string path;
+	int threads;
+	MakeSolver make;
+	Payload solve;
+
+	// Connections waiting for a thread.
+	std::deque<int> pending;
+	std::mutex mutex;
+	std::condition_variable cv;
+};
+
+} // namespace Minisat
+
+#endif
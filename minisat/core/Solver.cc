@@ -21,11 +21,13 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 // NOTE: This file was modified as part of minisat-cubing.
 
 #include <math.h>
+#include <algorithm>
 
 #include "minisat/mtl/Alg.h"
 #include "minisat/mtl/Sort.h"
 #include "minisat/utils/System.h"
 #include "minisat/core/Solver.h"
+#include "cs/Snapshot.h"
 
 using namespace Minisat;
 
@@ -47,6 +49,10 @@ static IntOption     opt_restart_first     (_cat, "rfirst",      "The base resta
 static DoubleOption  opt_restart_inc       (_cat, "rinc",        "Restart interval increase factor", 2, DoubleRange(1, false, HUGE_VAL, false));
 static DoubleOption  opt_garbage_frac      (_cat, "gc-frac",     "The fraction of wasted memory allowed before a garbage collection is triggered",  0.20, DoubleRange(0, false, HUGE_VAL, false));
 static IntOption     opt_min_learnts_lim   (_cat, "min-learnts", "Minimum learnt clause limit",  0, IntRange(0, INT32_MAX));
+static IntOption     opt_gc_regions        (_cat, "gc-regions",  "Collect garbage incrementally, up to this many fragmented regions at a time (0=off)", 0, IntRange(0, INT32_MAX));
+static BoolOption    opt_lbd_tiers         (_cat, "lbd-tiers",   "Keep learnt clauses in tiers by LBD", true);
+static IntOption     opt_core_lbd          (_cat, "core-lbd",    "Keep learnt clauses of at most this LBD for good", 2, IntRange(0, INT32_MAX));
+static IntOption     opt_tier2_lbd         (_cat, "tier2-lbd",   "Keep learnt clauses of at most this LBD while they are used", 6, IntRange(0, INT32_MAX));
 
 
 //=================================================================================================
@@ -69,6 +75,12 @@ Solver::Solver() :
   , rnd_init_act     (opt_rnd_init_act)
   , garbage_frac     (opt_garbage_frac)
   , min_learnts_lim  (opt_min_learnts_lim)
+  , gc_regions       (opt_gc_regions)
+  , lbd_tiers        (opt_lbd_tiers)
+  , core_lbd         (opt_core_lbd)
+  , tier2_lbd        (opt_tier2_lbd)
+  , learnt_in_cube   (false)
+  , proof            (NULL)
   , restart_first    (opt_restart_first)
   , restart_inc      (opt_restart_inc)
 
@@ -85,8 +97,11 @@ Solver::Solver() :
     //
   , solves(0), starts(0), decisions(0), rnd_decisions(0), propagations(0), conflicts(0)
   , dec_vars(0), num_clauses(0), num_learnts(0), clauses_literals(0), learnts_literals(0), max_literals(0), tot_literals(0)
+  , num_core(0), num_tier2(0)
 
   , watches            (WatcherDeleted(ca))
+  , bin_watches        (WatcherDeleted(ca))
+  , tern_watches       (WatcherDeleted(ca))
   , order_heap         (VarOrderLt(activity))
   , ok                 (true)
   , cla_inc            (1)
@@ -97,6 +112,7 @@ Solver::Solver() :
   , progress_estimate  (0)
   , remove_satisfied   (true)
   , next_var           (0)
+  , lbd_stamp          (0)
 
     // Resource constraints:
     //
@@ -129,6 +145,10 @@ Var Solver::newVar(lbool upol, bool dvar)
 
     watches  .init(mkLit(v, false));
     watches  .init(mkLit(v, true ));
+    bin_watches.init(mkLit(v, false));
+    bin_watches.init(mkLit(v, true ));
+    tern_watches.init(mkLit(v, false));
+    tern_watches.init(mkLit(v, true ));
     assigns  .insert(v, l_Undef);
     vardata  .insert(v, mkVarData(CRef_Undef, 0));
     activity .insert(v, rnd_init_act ? drand(random_seed) * 0.00001 : 0);
@@ -160,6 +180,7 @@ bool Solver::addClause_(vec<Lit>& ps)
 
     // Check if clause is satisfied and remove false/duplicate literals:
     sort(ps);
+    if (proof != NULL) ps.copyTo(proof_tmp);
     Lit p; int i, j;
     for (i = j = 0, p = lit_Undef; i < ps.size(); i++)
         if (value(ps[i]) == l_True || ps[i] == ~p)
@@ -168,6 +189,12 @@ bool Solver::addClause_(vec<Lit>& ps)
             ps[j++] = p = ps[i];
     ps.shrink(i - j);
 
+    // The clause as given is in the proof already (an input clause, or one written by the caller):
+    if (proof != NULL && i != j){
+        proof->add(ps);
+        proof->remove(proof_tmp);
+    }
+
     if (ps.size() == 0)
         return ok = false;
     else if (ps.size() == 1){
@@ -184,12 +211,60 @@ bool Solver::addClause_(vec<Lit>& ps)
 }
 
 
+bool Solver::addLearnt_(vec<Lit>& ps)
+{
+    assert(decisionLevel() == 0);
+    if (!ok) return false;
+
+    // As in 'addClause_()':
+    sort(ps);
+    if (proof != NULL) ps.copyTo(proof_tmp);
+    Lit p; int i, j;
+    for (i = j = 0, p = lit_Undef; i < ps.size(); i++)
+        if (value(ps[i]) == l_True || ps[i] == ~p)
+            return true;
+        else if (value(ps[i]) != l_False && ps[i] != p)
+            ps[j++] = p = ps[i];
+    ps.shrink(i - j);
+
+    if (proof != NULL && i != j){
+        proof->add(ps);
+        proof->remove(proof_tmp);
+    }
+
+    if (ps.size() == 0)
+        return ok = false;
+    else if (ps.size() == 1){
+        uncheckedEnqueue(ps[0]);
+        return ok = (propagate() == CRef_Undef);
+    }
+
+    // The LBD is not known at level 0; the size bounds it, and conflict analysis lowers it. The clause
+    // is ranked with the ones learnt in cube branches until the search uses it:
+    CRef cr = ca.alloc(ps, true);
+    Clause& c = ca[cr];
+    c.lbd(ps.size());
+    c.tier(tierOfLBD(ps.size()));
+    c.cube(true);
+    learnts.push(cr);
+    attachClause(cr);
+    claBumpActivity(ca[cr]);
+    return true;
+}
+
+
 void Solver::attachClause(CRef cr){
     const Clause& c = ca[cr];
     assert(c.size() > 1);
-    watches[~c[0]].push(Watcher(cr, c[1]));
-    watches[~c[1]].push(Watcher(cr, c[0]));
-    if (c.learnt()) num_learnts++, learnts_literals += c.size();
+    if (isTernary(c)){
+        tern_watches[~c[0]].push(TernaryWatcher(cr, c[1], c[2]));
+        tern_watches[~c[1]].push(TernaryWatcher(cr, c[0], c[2]));
+    }else{
+        OccLists<Lit, vec<Watcher>, WatcherDeleted, MkIndexLit>& ws = (c.size() == 2) ? bin_watches : watches;
+        ws[~c[0]].push(Watcher(cr, c[1]));
+        ws[~c[1]].push(Watcher(cr, c[0]));
+    }
+    if (c.learnt()) num_learnts++, learnts_literals += c.size(), countTier(c.tier(), 1);
     else            num_clauses++, clauses_literals += c.size();
 }
 
@@ -199,15 +274,26 @@ void Solver::detachClause(CRef cr, bool strict){
     assert(c.size() > 1);
     
     // Strict or lazy detaching:
-    if (strict){
-        remove(watches[~c[0]], Watcher(cr, c[1]));
-        remove(watches[~c[1]], Watcher(cr, c[0]));
+    if (isTernary(c)){
+        if (strict){
+            remove(tern_watches[~c[0]], TernaryWatcher(cr, c[1], c[2]));
+            remove(tern_watches[~c[1]], TernaryWatcher(cr, c[0], c[2]));
+        }else{
+            tern_watches.smudge(~c[0]);
+            tern_watches.smudge(~c[1]);
+        }
     }else{
-        watches.smudge(~c[0]);
-        watches.smudge(~c[1]);
+        OccLists<Lit, vec<Watcher>, WatcherDeleted, MkIndexLit>& ws = (c.size() == 2) ? bin_watches : watches;
+        if (strict){
+            remove(ws[~c[0]], Watcher(cr, c[1]));
+            remove(ws[~c[1]], Watcher(cr, c[0]));
+        }else{
+            ws.smudge(~c[0]);
+            ws.smudge(~c[1]);
+        }
     }
 
-    if (c.learnt()) num_learnts--, learnts_literals -= c.size();
+    if (c.learnt()) num_learnts--, learnts_literals -= c.size(), countTier(c.tier(), -1);
     else            num_clauses--, clauses_literals -= c.size();
 }
 
@@ -215,9 +301,10 @@ void Solver::detachClause(CRef cr, bool strict){
 void Solver::removeClause(CRef cr) {
     Clause& c = ca[cr];
     assert (c.mark() == 0);
+    if (proof != NULL) proof->remove(c);
     detachClause(cr);
     // Don't leave pointers to free'd memory!
-    if (locked(c)) vardata[var(c[0])].reason = CRef_Undef;
+    if (locked(c)) vardata[var(c[impliedIndex(c)])].reason = CRef_Undef;
     c.mark(1); 
     ca.free(cr);
 }
@@ -246,6 +333,22 @@ void Solver::cancelUntil(int level) {
     } }
 
 
+// Revert a probe (see 'newProbeLevel()') to the state at given level. Probing happens between the
+// calls to 'search()', when every unassigned decision variable is in the order heap already, and
+// its assignments are not worth saving the phase of.
+//
+void Solver::cancelProbe(int level) {
+    if (decisionLevel() > level){
+        for (int c = trail.size()-1; c >= trail_lim[level]; c--){
+            Var x = var(trail[c]);
+            assigns[x] = l_Undef;
+            assert(!decision[x] || order_heap.inHeap(x)); }
+        qhead = trail_lim[level];
+        trail.shrink(trail.size() - trail_lim[level]);
+        trail_lim.shrink(trail_lim.size() - level);
+    } }
+
+
 //=================================================================================================
 // Major methods:
 
@@ -309,10 +412,10 @@ void Solver::analyze(CRef confl, vec<Lit>& out_learnt, int& out_btlevel)
 
     do{
         assert(confl != CRef_Undef); // (otherwise should be UIP)
-        Clause& c = ca[confl];
+        Clause& c = (p == lit_Undef) ? ca[confl] : reasonClause(var(p));
 
         if (c.learnt())
-            claBumpActivity(c);
+            claUseLearnt(c);
 
         for (int j = (p == lit_Undef) ? 0 : 1; j < c.size(); j++){
             Lit q = c[j];
@@ -353,7 +456,7 @@ void Solver::analyze(CRef confl, vec<Lit>& out_learnt, int& out_btlevel)
             if (reason(x) == CRef_Undef)
                 out_learnt[j++] = out_learnt[i];
             else{
-                Clause& c = ca[reason(var(out_learnt[i]))];
+                Clause& c = reasonClause(x);
                 for (int k = 1; k < c.size(); k++)
                     if (!seen[var(c[k])] && level(var(c[k])) > 0){
                         out_learnt[j++] = out_learnt[i];
@@ -395,7 +498,7 @@ bool Solver::litRedundant(Lit p)
     assert(seen[var(p)] == seen_undef || seen[var(p)] == seen_source);
     assert(reason(var(p)) != CRef_Undef);
 
-    Clause*               c     = &ca[reason(var(p))];
+    Clause*               c     = &reasonClause(var(p));
     vec<ShrinkStackElem>& stack = analyze_stack;
     stack.clear();
 
@@ -424,7 +527,7 @@ bool Solver::litRedundant(Lit p)
             stack.push(ShrinkStackElem(i, p));
             i  = 0;
             p  = l;
-            c  = &ca[reason(var(p))];
+            c  = &reasonClause(var(p));
         }else{
             // Finished with current element 'p' and reason 'c':
             if (seen[var(p)] == seen_undef){
@@ -438,7 +541,7 @@ bool Solver::litRedundant(Lit p)
             // Continue with top element on stack:
             i  = stack.last().i;
             p  = stack.last().l;
-            c  = &ca[reason(var(p))];
+            c  = &reasonClause(var(p));
 
             stack.pop();
         }
@@ -474,7 +577,7 @@ void Solver::analyzeFinal(Lit p, LSet& out_conflict)
                 assert(level(x) > 0);
                 out_conflict.insert(~trail[i]);
             }else{
-                Clause& c = ca[reason(x)];
+                Clause& c = reasonClause(x);
                 for (int j = 1; j < c.size(); j++)
                     if (level(var(c[j])) > 0)
                         seen[var(c[j])] = 1;
@@ -518,6 +621,57 @@ CRef Solver::propagate()
         Watcher        *i, *j, *end;
         num_props++;
 
+        // Binary clauses first; the other literal is the blocker, so the clause need not be read:
+        vec<Watcher>&  bws = bin_watches.lookup(p);
+        for (i = (Watcher*)bws, end = i + bws.size(); i != end; i++){
+            Lit imp = i->blocker;
+            if (value(imp) == l_False){
+                confl = i->cref;
+                qhead = trail.size();
+                break;
+            }else if (value(imp) == l_Undef)
+                uncheckedEnqueue(imp, i->cref);
+        }
+        if (confl != CRef_Undef) break;
+
+        // Then ternary clauses; both other literals are inline, so the clause is only read to move
+        // the watch or to propagate:
+        vec<TernaryWatcher>& tws = tern_watches.lookup(p);
+        TernaryWatcher *t, *u, *tend;
+        for (t = u = (TernaryWatcher*)tws, tend = t + tws.size(); t != tend;){
+            lbool va = value(t->a);
+            lbool vb = value(t->b);
+            if (va == l_True || vb == l_True){
+                *u++ = *t++; continue; }
+
+            if (va == l_False && vb == l_False){
+                confl = t->cref;
+                qhead = trail.size();
+                while (t < tend)
+                    *u++ = *t++;
+                break; }
+
+            // Make sure the false literal is data[1]:
+            CRef     cr        = t->cref;
+            Clause&  c         = ca[cr];
+            Lit      false_lit = ~p;
+            if (c[0] == false_lit)
+                c[0] = c[1], c[1] = false_lit;
+            assert(c[1] == false_lit);
+
+            if (value(c[2]) != l_False){
+                c[1] = c[2]; c[2] = false_lit;
+                tern_watches[~c[1]].push(TernaryWatcher(cr, c[0], c[2]));
+                t++;
+            }else{
+                // Unit under assignment (the other watch is unassigned):
+                *u++ = *t++;
+                uncheckedEnqueue(c[0], cr);
+            }
+        }
+        tws.shrink(t - u);
+        if (confl != CRef_Undef) break;
+
         for (i = j = (Watcher*)ws, end = i + ws.size();  i != end;){
             // Try to avoid inspecting the clause:
             Lit blocker = i->blocker;
@@ -573,8 +727,11 @@ CRef Solver::propagate()
 |  reduceDB : ()  ->  [void]
 |  
 |  Description:
-|    Remove half of the learnt clauses, minus the clauses locked by the current assignment. Locked
-|    clauses are clauses that are reason to some assignment. Binary clauses are never removed.
+|    Remove half of the learnt clauses of the local tier, minus the clauses locked by the current
+|    assignment. Locked clauses are clauses that are reason to some assignment. Binary clauses are
+|    never removed, nor are core clauses. Tier-2 clauses that have not been used in conflict
+|    analysis since the previous call drop to the local tier. Clauses learnt in the search of cube
+|    branches are ranked by activity separately from the others.
 |________________________________________________________________________________________________@*/
 struct reduceDB_lt { 
     ClauseAllocator& ca;
@@ -587,16 +744,46 @@ void Solver::reduceDB()
     int     i, j;
     double  extra_lim = cla_inc / learnts.size();    // Remove any clause below this activity
 
-    sort(learnts, reduceDB_lt(ca));
-    // Don't delete binary or locked clauses. From the rest, delete clauses from the first half
-    // and clauses with activity smaller than 'extra_lim':
-    for (i = j = 0; i < learnts.size(); i++){
+    if (!lbd_tiers){
+        // The policy of MiniSat: sort all learnt clauses. Don't delete binary or locked clauses. From the
+        // rest, delete clauses from the first half and clauses with activity smaller than 'extra_lim':
+        sort(learnts, reduceDB_lt(ca));
+        for (i = j = 0; i < learnts.size(); i++){
+            Clause& c = ca[learnts[i]];
+            if (c.size() > 2 && !locked(c) && (i < learnts.size() / 2 || c.activity() < extra_lim))
+                removeClause(learnts[i]);
+            else
+                learnts[j++] = learnts[i];
+        }
+        learnts.shrink(i - j);
+        checkGarbage();
+        return;
+    }
+
+    reduce_cands[0].clear();
+    reduce_cands[1].clear();
+    for (i = 0; i < learnts.size(); i++){
         Clause& c = ca[learnts[i]];
-        if (c.size() > 2 && !locked(c) && (i < learnts.size() / 2 || c.activity() < extra_lim))
-            removeClause(learnts[i]);
-        else
-            learnts[j++] = learnts[i];
+        if (c.tier() == Tier_Two){
+            if (!c.used()) setTier(c, Tier_Local);
+            c.used(false);
+        }else if (c.tier() == Tier_Local && c.size() > 2 && !locked(c))
+            reduce_cands[c.cube()].push(learnts[i]);
+    }
+
+    // Delete the first half of each group by activity (no need to sort it), and the clauses with
+    // activity smaller than 'extra_lim':
+    for (int k = 0; k < 2; k++){
+        vec<CRef>& cs   = reduce_cands[k];
+        int        half = cs.size() / 2;
+        std::nth_element((CRef*)cs, (CRef*)cs + half, (CRef*)cs + cs.size(), reduceDB_lt(ca));
+        for (i = 0; i < cs.size(); i++)
+            if (i < half || ca[cs[i]].activity() < extra_lim)
+                removeClause(cs[i]);
     }
+    for (i = j = 0; i < learnts.size(); i++)
+        if (!isRemoved(learnts[i]))
+            learnts[j++] = learnts[i];
     learnts.shrink(i - j);
     checkGarbage();
 }
@@ -607,22 +794,41 @@ void Solver::removeSatisfied(vec<CRef>& cs, bool is_primary)
     int i, j;
     for (i = j = 0; i < cs.size(); i++){
         Clause& c = ca[cs[i]];
-        if (satisfied(c))
+        if (satisfied(c)){
             removeClause(cs[i]);
-        else{
-            // Trim clause:
+            if (is_primary) bi.remove(i);
+        }else{
+            // Trim clause (if only two or three literals are left, it moves to the binary or ternary
+            // watcher lists):
             assert(value(c[0]) == l_Undef && value(c[1]) == l_Undef);
+            int n_false = 0;
+            for (int k = 2; k < c.size(); k++)
+                if (value(c[k]) == l_False)
+                    n_false++;
+            const int new_size = c.size() - n_false;
+            bool relist = n_false > 0 && (new_size == 2 || (new_size == 3 && ternary_lists));
+            if (relist) detachClause(cs[i], true);
+            if (proof != NULL && n_false > 0){
+                proof_tmp.clear();
+                for (int k = 0; k < c.size(); k++)
+                    proof_tmp.push(c[k]);
+            }
             for (int k = 2; k < c.size(); k++)
                 if (value(c[k]) == l_False){
                     c[k--] = c[c.size()-1];
                     c.pop();
                 }
-			if (is_primary) bi.will_move(i, j);
+            if (proof != NULL && n_false > 0){
+                proof->add(c);
+                proof->remove(proof_tmp);
+            }
+            if (relist) attachClause(cs[i]);
+			if (is_primary) bi.move(i, j);
             cs[j++] = cs[i];
         }
     }
     cs.shrink(i - j);
-	if (is_primary) bi.flip_buffer();
+	if (is_primary) bi.truncate(j);
 }
 
 
@@ -722,12 +928,19 @@ lbool Solver::search(int nof_conflicts)
 
             learnt_clause.clear();
             analyze(confl, learnt_clause, backtrack_level);
+            int lbd = computeLBD(learnt_clause);
+            if (proof != NULL) proof->add(learnt_clause);
             cancelUntil(backtrack_level);
+            onLearnt(learnt_clause);
 
             if (learnt_clause.size() == 1){
                 uncheckedEnqueue(learnt_clause[0]);
             }else{
                 CRef cr = ca.alloc(learnt_clause, true);
+                Clause& c = ca[cr];
+                c.lbd(lbd);
+                c.tier(tierOfLBD(lbd));
+                c.cube(learnt_in_cube);
                 learnts.push(cr);
                 attachClause(cr);
                 claBumpActivity(ca[cr]);
@@ -761,7 +974,7 @@ lbool Solver::search(int nof_conflicts)
             if (decisionLevel() == 0 && !simplify())
                 return l_False;
 
-            if (learnts.size()-nAssigns() >= max_learnts)
+            if (learnts.size()-nAssigns()-(int)(num_core+num_tier2) >= max_learnts)
                 // Reduce the set of learnt clauses:
                 reduceDB();
 
@@ -825,7 +1038,7 @@ double Solver::progressEstimate() const
 
  */
 
-static double luby(double y, int x){
+double Solver::luby(double y, int x){
 
     // Find the finite subsequence that contains index 'x', and the
     // size of that subsequence:
@@ -1003,6 +1216,7 @@ void Solver::printStats() const
     printf("decisions             : %-12" PRIu64 "   (%4.2f %% random) (%.0f /sec)\n", decisions, (float)rnd_decisions*100 / (float)decisions, decisions   /cpu_time);
     printf("propagations          : %-12" PRIu64 "   (%.0f /sec)\n", propagations, propagations/cpu_time);
     printf("conflict literals     : %-12" PRIu64 "   (%4.2f %% deleted)\n", tot_literals, (max_literals - tot_literals)*100 / (double)max_literals);
+    printf("learnts               : %-12" PRIu64 "   (%" PRIu64 " core, %" PRIu64 " tier-2)\n", num_learnts, num_core, num_tier2);
     if (mem_used != 0) printf("Memory used           : %.2f MB\n", mem_used);
     printf("CPU time              : %g s\n", cpu_time);
 }
@@ -1016,13 +1230,39 @@ void Solver::relocAll(ClauseAllocator& to)
     // All watchers:
     //
     watches.cleanAll();
+    bin_watches.cleanAll();
+    tern_watches.cleanAll();
+#ifdef CS_PLAIN_WATCHERS
     for (int v = 0; v < nVars(); v++)
         for (int s = 0; s < 2; s++){
             Lit p = mkLit(v, s);
             vec<Watcher>& ws = watches[p];
             for (int j = 0; j < ws.size(); j++)
                 ca.reloc(ws[j].cref, to);
+            vec<Watcher>& bws = bin_watches[p];
+            for (int j = 0; j < bws.size(); j++)
+                ca.reloc(bws[j].cref, to);
         }
+#else
+    // Longer clauses first, so that the ones watched by the same literal end up next to each other;
+    // 'propagate()' reads binary and ternary clauses seldom, if at all, so they go after all of them:
+    for (int v = 0; v < nVars(); v++)
+        for (int s = 0; s < 2; s++){
+            vec<Watcher>& ws = watches[mkLit(v, s)];
+            for (int j = 0; j < ws.size(); j++)
+                ca.reloc(ws[j].cref, to);
+        }
+    for (int v = 0; v < nVars(); v++)
+        for (int s = 0; s < 2; s++){
+            Lit p = mkLit(v, s);
+            vec<TernaryWatcher>& tws = tern_watches[p];
+            for (int j = 0; j < tws.size(); j++)
+                ca.reloc(tws[j].cref, to);
+            vec<Watcher>& bws = bin_watches[p];
+            for (int j = 0; j < bws.size(); j++)
+                ca.reloc(bws[j].cref, to);
+        }
+#endif
 
     // All reasons:
     //
@@ -1052,11 +1292,12 @@ void Solver::relocAll(ClauseAllocator& to)
     for (i = j = 0; i < clauses.size(); i++)
         if (!isRemoved(clauses[i])){
             ca.reloc(clauses[i], to);
-			bi.will_move(i, j);
+			bi.move(i, j);
             clauses[j++] = clauses[i];
-        }
+        }else
+            bi.remove(i);
     clauses.shrink(i - j);
-	bi.flip_buffer();
+	bi.truncate(j);
 }
 
 
@@ -1072,3 +1313,259 @@ void Solver::garbageCollect()
                ca.size()*ClauseAllocator::Unit_Size, to.size()*ClauseAllocator::Unit_Size);
     to.moveTo(ca);
 }
+
+
+void Solver::reuseClauseMemory(ClauseAllocator& from)
+{
+    ca.reuse(from);
+}
+
+
+void Solver::collectRegions(int n)
+{
+    // The n regions with the most waste, if at least 'garbage_frac' of each is wasted:
+    vec<uint32_t> picked;
+    for (int r = 0; r < ca.nRegions(); r++)
+        if (ca.collectable(r) && ca.regionWasted(r) > ClauseAllocator::Region_Units * garbage_frac)
+            picked.push(r);
+    if (picked.size() == 0) return;
+    sort(picked, RegionWasteGt(ca));
+    if (picked.size() > n) picked.shrink(picked.size() - n);
+
+    vec<char> in_picked(ca.nRegions(), 0);
+    for (int i = 0; i < picked.size(); i++)
+        in_picked[picked[i]] = 1;
+    // No watcher may refer to a removed clause, as its memory is about to be used again:
+    watches.cleanAll();
+    bin_watches.cleanAll();
+    tern_watches.cleanAll();
+
+    // Move the clauses out of the regions, remembering the literals they are watched by. Removed
+    // clauses that are still listed are dropped; the others keep their indices, so that 'bi' only
+    // sees the dropped ones:
+    vec<Lit> touched;
+    int      n_moved = 0;
+    for (int k = 0; k < 2; k++){
+        vec<CRef>& cs = k ? clauses : learnts;
+        for (int i = 0; i < cs.size(); i++){
+            if (!in_picked[ca.region(cs[i])]) continue;
+            if (isRemoved(cs[i])){
+                int last = cs.size() - 1;
+                if (k) { bi.remove(i); bi.move(last, i); }
+                cs[i--] = cs[last];
+                cs.pop();
+                continue; }
+            ca.move(cs[i]);
+            n_moved++;
+            const Clause& c = ca[cs[i]];
+            for (int l = 0; l < 2; l++)
+                if (!seen[var(c[l])]){
+                    seen[var(c[l])] = 1;
+                    touched.push(c[l]); }
+        }
+    }
+    bi.truncate(clauses.size());
+
+    // Redirect their watchers and reasons (the trail covers every clause that may be a reason):
+    for (int i = 0; i < touched.size(); i++){
+        seen[var(touched[i])] = 0;
+        for (int s = 0; s < 2; s++){
+            Lit p = mkLit(var(touched[i]), s);
+            vec<Watcher>& ws = watches[p];
+            for (int j = 0; j < ws.size(); j++)
+                if (in_picked[ca.region(ws[j].cref)]) { assert(ca[ws[j].cref].reloced()); ws[j].cref = ca[ws[j].cref].relocation(); }
+            vec<Watcher>& bws = bin_watches[p];
+            for (int j = 0; j < bws.size(); j++)
+                if (in_picked[ca.region(bws[j].cref)]) { assert(ca[bws[j].cref].reloced()); bws[j].cref = ca[bws[j].cref].relocation(); }
+            vec<TernaryWatcher>& tws = tern_watches[p];
+            for (int j = 0; j < tws.size(); j++)
+                if (in_picked[ca.region(tws[j].cref)]) { assert(ca[tws[j].cref].reloced()); tws[j].cref = ca[tws[j].cref].relocation(); }
+        }
+    }
+    for (int i = 0; i < trail.size(); i++){
+        CRef& r = vardata[var(trail[i])].reason;
+        if (r != CRef_Undef && in_picked[ca.region(r)])
+            r = ca[r].reloced() ? ca[r].relocation() : CRef_Undef;
+    }
+
+    for (int i = 0; i < picked.size(); i++)
+        ca.freeRegion(picked[i]);
+
+    if (verbosity >= 2)
+        printf("|  Region collection:    %5d regions, %10d clauses moved                          |\n",
+               picked.size(), n_moved);
+}
+
+
+//=================================================================================================
+// Snapshots:
+
+
+template<class W>
+static void putWatchLists(SnapshotWriter& out, OccLists<Lit, vec<W>, Solver::WatcherDeleted, MkIndexLit>& lists, int n)
+{
+    vec<int> sizes;
+    vec<W>   ws;
+    for (int i = 0; i < 2 * n; i++){
+        const vec<W>& w = lists[toLit(i)];
+        sizes.push(w.size());
+        for (int k = 0; k < w.size(); k++)
+            ws.push(w[k]); }
+    out.putVec(sizes);
+    out.putVec(ws);
+}
+
+
+template<class W>
+static bool getWatchLists(SnapshotReader& in, OccLists<Lit, vec<W>, Solver::WatcherDeleted, MkIndexLit>& lists, int n)
+{
+    const int* sizes;
+    const W*   ws;
+    size_t     n_sizes, n_ws;
+    if (!in.getArray(sizes, n_sizes) || n_sizes != (size_t)2 * n) return false;
+    if (!in.getArray(ws, n_ws)) return false;
+    size_t k = 0;
+    for (int i = 0; i < 2 * n; i++){
+        if (sizes[i] < 0 || n_ws - k < (size_t)sizes[i]) return false;
+        vec<W>& w = lists[toLit(i)];
+        w.clear();
+        w.capacity(sizes[i]);
+        for (int l = 0; l < sizes[i]; l++)
+            w.push(ws[k++]); }
+    return true;
+}
+
+
+void Solver::saveSnapshot(SnapshotWriter& out)
+{
+    assert(decisionLevel() == 0);
+
+    // Make the watcher lists exact, so that they can be stored as they are:
+    watches.cleanAll();
+    bin_watches.cleanAll();
+    tern_watches.cleanAll();
+
+    const int n = nVars();
+    out.putValue(n);
+    out.putValue(ok);
+    out.putValue(cla_inc);
+    out.putValue(var_inc);
+    out.putValue(qhead);
+    out.putValue(simpDB_assigns);
+    out.putValue(simpDB_props);
+    out.putValue(progress_estimate);
+    out.putValue(remove_satisfied);
+
+    const uint64_t stats[] = { solves, starts, decisions, rnd_decisions, propagations, conflicts,
+                               dec_vars, num_clauses, num_learnts, clauses_literals, learnts_literals,
+                               max_literals, tot_literals, num_core, num_tier2 };
+    out.putArray(stats, sizeof(stats) / sizeof(stats[0]));
+
+    out.putMap(activity, n);
+    out.putMap(assigns, n);
+    out.putMap(polarity, n);
+    out.putMap(user_pol, n);
+    out.putMap(decision, n);
+    out.putMap(vardata, n);
+
+    // All watcher lists back to back, and their sizes; then the same for the binary and the ternary
+    // ones:
+    putWatchLists(out, watches, n);
+    putWatchLists(out, bin_watches, n);
+    putWatchLists(out, tern_watches, n);
+
+    out.putVec(trail);
+    out.putVec(clauses);
+    out.putVec(learnts);
+    out.putVec(released_vars);
+    out.putVec(free_vars);
+
+    out.putValue(ca.extra_clause_field);
+    out.putValue(ca.wasted());
+    out.putArray(ca.data(), ca.size());
+
+    std::vector<int> bw(clauses.size());
+    for (int i = 0; i < clauses.size(); i++)
+        bw[i] = bi.bw(i);
+    out.putValue(bi.size());
+    out.putArray(bw.data(), bw.size());
+}
+
+
+bool Solver::loadSnapshot(SnapshotReader& in)
+{
+    assert(nVars() == 0);
+
+    int n;
+    if (!in.getValue(n) || n < 0) return false;
+
+    // Sizes all the per-variable structures (and draws the same random initial activities as
+    // creating the variables when parsing would):
+    while (nVars() < n)
+        newVar();
+
+    in.getValue(ok);
+    in.getValue(cla_inc);
+    in.getValue(var_inc);
+    in.getValue(qhead);
+    in.getValue(simpDB_assigns);
+    in.getValue(simpDB_props);
+    in.getValue(progress_estimate);
+    in.getValue(remove_satisfied);
+
+    const uint64_t* stats;
+    size_t          n_stats;
+    if (!in.getArray(stats, n_stats) || n_stats != 15) return false;
+    solves           = stats[0];
+    starts           = stats[1];
+    decisions        = stats[2];
+    rnd_decisions    = stats[3];
+    propagations     = stats[4];
+    conflicts        = stats[5];
+    dec_vars         = stats[6];
+    num_clauses      = stats[7];
+    num_learnts      = stats[8];
+    clauses_literals = stats[9];
+    learnts_literals = stats[10];
+    max_literals     = stats[11];
+    tot_literals     = stats[12];
+    num_core         = stats[13];
+    num_tier2        = stats[14];
+
+    in.getMap(activity, n);
+    in.getMap(assigns, n);
+    in.getMap(polarity, n);
+    in.getMap(user_pol, n);
+    in.getMap(decision, n);
+    in.getMap(vardata, n);
+
+    if (!getWatchLists(in, watches, n) || !getWatchLists(in, bin_watches, n) || !getWatchLists(in, tern_watches, n))
+        return false;
+
+    in.getVec(trail);
+    in.getVec(clauses);
+    in.getVec(learnts);
+    in.getVec(released_vars);
+    in.getVec(free_vars);
+
+    uint32_t        wasted = 0;
+    const uint32_t* memory;
+    size_t          n_memory;
+    in.getValue(ca.extra_clause_field);
+    in.getValue(wasted);
+    if (!in.ok() || !in.getArray(memory, n_memory) || n_memory > UINT32_MAX || wasted > n_memory) return false;
+    ca.assign(memory, n_memory, wasted);
+    ca.countRegions(clauses, learnts);
+
+    int        n_indices = 0;
+    const int* bw;
+    size_t     n_bw;
+    in.getValue(n_indices);
+    if (!in.ok() || !in.getArray(bw, n_bw) || n_bw != (size_t)clauses.size()) return false;
+    bi.assign(std::vector<int>(bw, bw + n_bw), n_indices);
+
+    if (!in.ok() || trail.size() > n || qhead > trail.size()) return false;
+
+    rebuildOrderHeap();
+    return true;
+}
@@ -30,10 +30,16 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "minisat/utils/Options.h"
 #include "minisat/core/SolverTypes.h"
 #include "cs/Bimap.h"
+#include "cs/ProofWriter.h"
+
+#include <atomic>
 
 
 namespace Minisat {
 
+class SnapshotWriter;
+class SnapshotReader;
+
 //=================================================================================================
 // Solver -- the main class:
 
@@ -58,6 +64,8 @@ public:
     bool    addClause (Lit p, Lit q, Lit r, Lit s);             // Add a quaternary clause to the solver. 
     bool    addClause_(      vec<Lit>& ps);                     // Add a clause to the solver without making superflous internal copy. Will
                                                                 // change the passed vector 'ps'.
+    bool    addLearnt_(      vec<Lit>& ps);                     // Add a clause learnt elsewhere (e.g. by another solver) as a learnt clause,
+                                                                // at decision level 0. Will change the passed vector 'ps'.
 
     // Solving:
     //
@@ -87,6 +95,10 @@ public:
     void    toDimacs     (const char* file, Lit p);
     void    toDimacs     (const char* file, Lit p, Lit q);
     void    toDimacs     (const char* file, Lit p, Lit q, Lit r);
+
+    // Snapshots of the solver state at decision level 0 (see 'cs/Snapshot.h'):
+    virtual void saveSnapshot (SnapshotWriter& out);                    // Write the state (e.g. right after preprocessing).
+    virtual bool loadSnapshot (SnapshotReader& in);                     // Read a state written by 'saveSnapshot()'. Requires a solver without variables.
     
     // Variable mode:
     // 
@@ -119,6 +131,9 @@ public:
     virtual void garbageCollect();
     void    checkGarbage(double gf);
     void    checkGarbage();
+    virtual void collectRegions(int n);   // Collect up to 'n' fragmented regions of the clause memory.
+    virtual bool canCollectRegions() const { return true; } // Are all references to clauses known to 'collectRegions()'?
+    virtual void reuseClauseMemory(ClauseAllocator& from); // Take over the emptied memory of 'from'; only before any clause is added.
 
     // Extra results: (read-only member variable)
     //
@@ -140,6 +155,12 @@ public:
     bool      rnd_init_act;       // Initialize variable activities with a small random value.
     double    garbage_frac;       // The fraction of wasted memory allowed before a garbage collection is triggered.
     int       min_learnts_lim;    // Minimum number to set the learnts limit to.
+    int       gc_regions;         // If positive, 'checkGarbage()' collects up to this many regions at a time; see 'collectRegions()'.
+    bool      lbd_tiers;          // Keep learnt clauses in tiers by LBD; otherwise, all are reduced by activity.
+    int       core_lbd;           // Learnt clauses of at most this LBD are kept for good.
+    int       tier2_lbd;          // Learnt clauses of at most this LBD are kept as long as they are used.
+    bool      learnt_in_cube;     // Tag new learnt clauses as learnt in the search of a cube branch.
+    ProofWriter* proof;           // If not NULL, every clause added or deleted is written to this DRAT proof (not owned).
 
     int       restart_first;      // The initial restart limit.                                                                (default 100)
     double    restart_inc;        // The factor with which the restart limit is multiplied in each restart.                    (default 1.5)
@@ -153,6 +174,7 @@ public:
     //
     uint64_t solves, starts, decisions, rnd_decisions, propagations, conflicts;
     uint64_t dec_vars, num_clauses, num_learnts, clauses_literals, learnts_literals, max_literals, tot_literals;
+    uint64_t num_core, num_tier2;     // Learnt clauses in the core and tier-2 tiers.
 
     // Helper structures:
     //
@@ -167,11 +189,35 @@ public:
         bool operator!=(const Watcher& w) const { return cref != w.cref; }
     };
 
+    // Ternary clauses are watched in lists of their own, with the two other literals inline:
+    struct TernaryWatcher {
+        CRef cref;
+        Lit  a, b;
+        TernaryWatcher(CRef cr, Lit p, Lit q) : cref(cr), a(p), b(q) {}
+        bool operator==(const TernaryWatcher& w) const { return cref == w.cref; }
+        bool operator!=(const TernaryWatcher& w) const { return cref != w.cref; }
+    };
+
     struct WatcherDeleted
     {
         const ClauseAllocator& ca;
         WatcherDeleted(const ClauseAllocator& _ca) : ca(_ca) {}
-        bool operator()(const Watcher& w) const { return ca[w.cref].mark() == 1; }
+        template<class W>
+        bool operator()(const W& w) const { return ca[w.cref].mark() == 1; }
+    };
+
+    // With CS_PLAIN_WATCHERS, ternary clauses are watched as the longer ones are, and the clauses
+    // keep the arena order of MiniSat:
+#ifdef CS_PLAIN_WATCHERS
+    static const bool ternary_lists = false;
+#else
+    static const bool ternary_lists = true;
+#endif
+
+    struct RegionWasteGt {
+        const ClauseAllocator& ca;
+        RegionWasteGt(const ClauseAllocator& ca_) : ca(ca_) {}
+        bool operator () (uint32_t x, uint32_t y) const { return ca.regionWasted(x) > ca.regionWasted(y); }
     };
 
     struct VarOrderLt {
@@ -202,6 +248,10 @@ public:
     VMap<VarData>       vardata;          // Stores reason and level for each variable.
     OccLists<Lit, vec<Watcher>, WatcherDeleted, MkIndexLit>
                         watches;          // 'watches[lit]' is a list of constraints watching 'lit' (will go there if literal becomes true).
+    OccLists<Lit, vec<Watcher>, WatcherDeleted, MkIndexLit>
+                        bin_watches;      // As 'watches', but only for binary clauses. The blocker of each watcher is the other literal of the clause.
+    OccLists<Lit, vec<TernaryWatcher>, WatcherDeleted, MkIndexLit>
+                        tern_watches;     // As 'watches', but only for ternary clauses (none with CS_PLAIN_WATCHERS).
 
     Heap<Var,VarOrderLt>order_heap;       // A priority queue of variables ordered with respect to the variable activity.
 
@@ -227,6 +277,10 @@ public:
     vec<ShrinkStackElem>analyze_stack;
     vec<Lit>            analyze_toclear;
     vec<Lit>            add_tmp;
+    vec<Lit>            proof_tmp;        // A clause as it was before being shortened, for the proof.
+    vec<uint64_t>       lbd_seen;         // The last stamp given to each decision level by 'computeLBD()'.
+    uint64_t            lbd_stamp;
+    vec<CRef>           reduce_cands[2];  // Local learnt clauses that 'reduceDB()' may remove, not learnt or learnt in cube branches.
 
     double              max_learnts;
     double              learntsize_adjust_confl;
@@ -236,7 +290,7 @@ public:
     //
     int64_t             conflict_budget;    // -1 means no budget.
     int64_t             propagation_budget; // -1 means no budget.
-    bool                asynch_interrupt;
+    std::atomic<bool>   asynch_interrupt;   // Atomic, since other threads may interrupt the solver.
 
     // Main internal methods:
     //
@@ -247,6 +301,8 @@ public:
     bool     enqueue          (Lit p, CRef from = CRef_Undef);                         // Test if fact 'p' contradicts current state, enqueue otherwise.
     CRef     propagate        ();                                                      // Perform unit propagation. Returns possibly conflicting clause.
     void     cancelUntil      (int level);                                             // Backtrack until a certain level.
+    void     newProbeLevel    ();                                                      // Begins a new decision level for probing, i.e. for propagation outside of search.
+    void     cancelProbe      (int level);                                             // Backtrack a probe until a certain level. As 'cancelUntil()', but without phase saving or order heap updates.
     void     analyze          (CRef confl, vec<Lit>& out_learnt, int& out_btlevel);    // (bt = backtrack)
     void     analyzeFinal     (Lit p, LSet& out_conflict);                             // COULD THIS BE IMPLEMENTED BY THE ORDINARIY "analyze" BY SOME REASONABLE GENERALIZATION?
     bool     litRedundant     (Lit p);                                                 // (helper method for 'analyze()')
@@ -255,6 +311,7 @@ public:
     void     reduceDB         ();                                                      // Reduce the set of learnt clauses.
     void     removeSatisfied  (vec<CRef>& cs, bool is_primary=false);                  // Shrink 'cs' to contain only non-satisfied clauses.
     void     rebuildOrderHeap ();
+    virtual void onLearnt     (const vec<Lit>& learnt) {}                          // Called by 'search()' for every learnt clause, before it is stored.
 
     // Maintaining Variable/Clause activity:
     //
@@ -263,6 +320,15 @@ public:
     void     varBumpActivity  (Var v);                 // Increase a variable with the current 'bump' value.
     void     claDecayActivity ();                      // Decay all clauses with the specified factor. Implemented by increasing the 'bump' value instead.
     void     claBumpActivity  (Clause& c);             // Increase a clause with the current 'bump' value.
+    void     claUseLearnt     (Clause& c);             // Bump a learnt clause used in conflict analysis, and update its LBD and tier.
+
+    // Tiers of learnt clauses:
+    //
+    template<class C>
+    int      computeLBD       (const C& lits, int max = INT32_MAX); // Number of distinct decision levels in 'lits' (counted up to 'max' + 1).
+    int      tierOfLBD        (int lbd) const;         // The tier that a learnt clause of this LBD belongs to.
+    void     setTier          (Clause& c, int tier);   // Move an attached learnt clause to another tier.
+    void     countTier        (int tier, int d);       // Add 'd' to the number of learnt clauses in the tier.
 
     // Operations on clauses:
     //
@@ -271,6 +337,9 @@ public:
     void     removeClause     (CRef cr);               // Detach and free a clause.
     bool     isRemoved        (CRef cr) const;         // Test if a clause has been removed.
     bool     locked           (const Clause& c) const; // Returns TRUE if a clause is a reason for some implication in the current state.
+    int      impliedIndex     (const Clause& c) const; // Index of the literal that the clause may be the reason of (0, except for binary clauses).
+    bool     isTernary        (const Clause& c) const; // Is the clause watched in the ternary lists?
+    Clause&  reasonClause     (Var x);                 // The reason of 'x', with the implied literal first.
     bool     satisfied        (const Clause& c) const; // Returns TRUE if a clause is satisfied in the current state.
 
     // Misc:
@@ -296,6 +365,9 @@ public:
     // Returns a random integer 0 <= x < size. Seed must never be 0.
     static inline int irand(double& seed, int size) {
         return (int)(drand(seed) * size); }
+
+    // Finite subsequences of the Luby-sequence (see Solver.cc).
+    static double luby(double y, int x);
 };
 
 
@@ -328,9 +400,42 @@ inline void Solver::claBumpActivity (Clause& c) {
             for (int i = 0; i < learnts.size(); i++)
                 ca[learnts[i]].activity() *= 1e-20;
             cla_inc *= 1e-20; } }
+inline void Solver::claUseLearnt(Clause& c) {
+    claBumpActivity(c);
+    if (!lbd_tiers || c.tier() == Tier_Core) return;
+    c.used(true);
+    if (!learnt_in_cube) c.cube(false);
+
+    // Only a lower LBD matters, so counting stops at the current one:
+    int lbd = computeLBD(c, c.lbd() - 1);
+    if (lbd < c.lbd()){
+        c.lbd(lbd);
+        if (tierOfLBD(lbd) < c.tier()) setTier(c, tierOfLBD(lbd)); } }
+
+template<class C>
+inline int Solver::computeLBD(const C& lits, int max) {
+    lbd_stamp++;
+    int lbd = 0;
+    for (int i = 0; i < lits.size() && lbd <= max; i++){
+        int l = level(var(lits[i]));
+        if (l >= lbd_seen.size()) lbd_seen.growTo(2 * (l + 1), 0);
+        if (lbd_seen[l] != lbd_stamp){
+            lbd_seen[l] = lbd_stamp;
+            lbd++; } }
+    return lbd; }
+
+inline int  Solver::tierOfLBD(int lbd) const { return !lbd_tiers ? Tier_Local : lbd <= core_lbd ? Tier_Core : lbd <= tier2_lbd ? Tier_Two : Tier_Local; }
+inline void Solver::setTier  (Clause& c, int tier) { countTier(c.tier(), -1); c.tier(tier); countTier(tier, 1); }
+inline void Solver::countTier(int tier, int d) {
+    if      (tier == Tier_Core) num_core  += d;
+    else if (tier == Tier_Two)  num_tier2 += d; }
 
 inline void Solver::checkGarbage(void){ return checkGarbage(garbage_frac); }
 inline void Solver::checkGarbage(double gf){
+    // When the regions are collected incrementally, a full collection is a last resort:
+    if (gc_regions > 0 && canCollectRegions()){
+        collectRegions(gc_regions);
+        if (gf < 0.5) gf = 0.5; }
     if (ca.wasted() > ca.size() * gf)
         garbageCollect(); }
 
@@ -344,8 +449,19 @@ inline bool     Solver::addClause       (Lit p, Lit q, Lit r)   { add_tmp.clear(
 inline bool     Solver::addClause       (Lit p, Lit q, Lit r, Lit s){ add_tmp.clear(); add_tmp.push(p); add_tmp.push(q); add_tmp.push(r); add_tmp.push(s); return addClause_(add_tmp); }
 
 inline bool     Solver::isRemoved       (CRef cr)         const { return ca[cr].mark() == 1; }
-inline bool     Solver::locked          (const Clause& c) const { return value(c[0]) == l_True && reason(var(c[0])) != CRef_Undef && ca.lea(reason(var(c[0]))) == &c; }
+inline bool     Solver::locked          (const Clause& c) const { Lit p = c[impliedIndex(c)]; return value(p) == l_True && reason(var(p)) != CRef_Undef && ca.lea(reason(var(p))) == &c; }
+
+inline bool     Solver::isTernary       (const Clause& c) const { return ternary_lists && c.size() == 3; }
+
+// Binary clauses are propagated without looking at the clause, so either literal may be the implied
+// one; if it is the second, the literals are swapped before the clause is used as a reason.
+inline int      Solver::impliedIndex    (const Clause& c) const { return (c.size() == 2 && value(c[0]) != l_True) ? 1 : 0; }
+inline Clause&  Solver::reasonClause    (Var x)                 {
+    Clause& c = ca[reason(x)];
+    if (c.size() == 2 && var(c[0]) != x){ Lit p = c[0]; c[0] = c[1]; c[1] = p; }
+    return c; }
 inline void     Solver::newDecisionLevel()                      { trail_lim.push(trail.size()); }
+inline void     Solver::newProbeLevel   ()                      { trail_lim.push(trail.size()); }
 
 inline int      Solver::decisionLevel ()      const   { return trail_lim.size(); }
 inline uint32_t Solver::abstractLevel (Var x) const   { return 1 << (level(x) & 31); }
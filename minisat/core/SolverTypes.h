@@ -18,11 +18,16 @@ DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
 OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **************************************************************************************************/
 
+// NOTE: This file was modified as part of minisat-cubing.
 
 #ifndef Minisat_SolverTypes_h
 #define Minisat_SolverTypes_h
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 
 #include "minisat/mtl/IntTypes.h"
 #include "minisat/mtl/Alg.h"
@@ -52,7 +57,7 @@ struct Lit {
     int     x;
 
     // Use this as a constructor:
-    friend Lit mkLit(Var var, bool sign = false);
+    friend Lit mkLit(Var var, bool sign);
 
     bool operator == (Lit p) const { return x == p.x; }
     bool operator != (Lit p) const { return x != p.x; }
@@ -60,7 +65,7 @@ struct Lit {
 };
 
 
-inline  Lit  mkLit     (Var var, bool sign) { Lit p; p.x = var + var + (int)sign; return p; }
+inline  Lit  mkLit     (Var var, bool sign = false) { Lit p; p.x = var + var + (int)sign; return p; }
 inline  Lit  operator ~(Lit p)              { Lit q; q.x = p.x ^ 1; return q; }
 inline  Lit  operator ^(Lit p, bool b)      { Lit q; q.x = p.x ^ (unsigned int)b; return q; }
 inline  bool sign      (Lit p)              { return p.x & 1; }
@@ -137,6 +142,10 @@ inline lbool toLbool(int   v) { return lbool((uint8_t)v);  }
 class Clause;
 typedef RegionAllocator<uint32_t>::Ref CRef;
 
+// Tiers of the learnt clause database: core clauses are kept for good, tier-2 clauses until they
+// go unused, local clauses are reduced by activity.
+enum { Tier_Core = 0, Tier_Two = 1, Tier_Local = 2 };
+
 class Clause {
     struct {
         unsigned mark      : 2;
@@ -144,7 +153,12 @@ class Clause {
         unsigned has_extra : 1;
         unsigned reloced   : 1;
         unsigned size      : 27; }                        header;
-    union { Lit lit; float act; uint32_t abs; CRef rel; } data[0];
+    struct Meta {
+        unsigned lbd       : 27;
+        unsigned tier      : 2;
+        unsigned cube      : 1;
+        unsigned used      : 1; };
+    union { Lit lit; float act; uint32_t abs; CRef rel; Meta meta; } data[0];
 
     friend class ClauseAllocator;
 
@@ -160,9 +174,11 @@ class Clause {
             data[i].lit = ps[i];
 
         if (header.has_extra){
-            if (header.learnt)
+            if (header.learnt){
                 data[header.size].act = 0;
-            else
+                data[header.size + 1].meta = Meta();
+                data[header.size + 1].meta.tier = Tier_Local;
+            }else
                 calcAbstraction();
     }
     }
@@ -176,9 +192,10 @@ class Clause {
             data[i].lit = from[i];
 
         if (header.has_extra){
-            if (header.learnt)
-                data[header.size].act = from.data[header.size].act;
-            else 
+            if (header.learnt){
+                data[header.size].act      = from.data[header.size].act;
+                data[header.size + 1].meta = from.data[header.size + 1].meta;
+            }else 
                 data[header.size].abs = from.data[header.size].abs;
     }
     }
@@ -193,10 +210,11 @@ public:
 
 
     int          size        ()      const   { return header.size; }
-    void         shrink      (int i)         { assert(i <= size()); if (header.has_extra) data[header.size-i] = data[header.size]; header.size -= i; }
+    void         shrink      (int i)         { assert(i <= size()); for (int k = 0; k < extras(); k++) data[header.size-i+k] = data[header.size+k]; header.size -= i; }
     void         pop         ()              { shrink(1); }
     bool         learnt      ()      const   { return header.learnt; }
     bool         has_extra   ()      const   { return header.has_extra; }
+    int          extras      ()      const   { return header.has_extra + (header.has_extra & header.learnt); }
     uint32_t     mark        ()      const   { return header.mark; }
     void         mark        (uint32_t m)    { header.mark = m; }
     const Lit&   last        ()      const   { return data[header.size-1].lit; }
@@ -214,6 +232,18 @@ public:
     float&       activity    ()              { assert(header.has_extra); return data[header.size].act; }
     uint32_t     abstraction () const        { assert(header.has_extra); return data[header.size].abs; }
 
+    // Learnt clauses only: the LBD (number of distinct decision levels) when learnt, or the lowest
+    // seen since; the tier of the learnt clause database; whether the clause was learnt during the
+    // search of a cube branch; and whether it has been used in conflict analysis lately.
+    int          lbd         () const        { assert(header.learnt); return data[header.size + 1].meta.lbd; }
+    void         lbd         (int l)         { assert(header.learnt); data[header.size + 1].meta.lbd = l; }
+    int          tier        () const        { assert(header.learnt); return data[header.size + 1].meta.tier; }
+    void         tier        (int t)         { assert(header.learnt); data[header.size + 1].meta.tier = t; }
+    bool         cube        () const        { assert(header.learnt); return data[header.size + 1].meta.cube; }
+    void         cube        (bool b)        { assert(header.learnt); data[header.size + 1].meta.cube = b; }
+    bool         used        () const        { assert(header.learnt); return data[header.size + 1].meta.used; }
+    void         used        (bool b)        { assert(header.learnt); data[header.size + 1].meta.used = b; }
+
     Lit          subsumes    (const Clause& other) const;
     void         strengthen  (Lit p);
 };
@@ -227,27 +257,111 @@ class ClauseAllocator
 {
     RegionAllocator<uint32_t> ra;
 
-    static uint32_t clauseWord32Size(int size, bool has_extra){
-        return (sizeof(Clause) + (sizeof(Lit) * (size + (int)has_extra))) / sizeof(uint32_t); }
+    // The memory is divided into regions of 'Region_Units' units, which can be collected one at a
+    // time (see 'Solver::collectRegions()'). A clause does not cross the end of a region, unless
+    // it is larger than a region, in which case the regions it covers are pinned: never collected.
+    // Collected regions are allocated into again before the memory grows.
+    vec<uint32_t> region_fill;       // Units allocated in the region (including those since freed).
+    vec<uint32_t> region_live;       // Units of the region in clauses that have not been freed.
+    vec<char>     region_pinned;
+    vec<uint32_t> free_regions;      // Collected regions, not allocated into yet.
+    int           current_region;    // Region being allocated into, if a collected one, or -1.
+
+    // Learnt clauses have two extra words (the activity, and the LBD and tier), others at most one:
+    static uint32_t clauseWord32Size(int size, int extras){
+        return (sizeof(Clause) + (sizeof(Lit) * (size + extras))) / sizeof(uint32_t); }
+
+    void addRegions(uint32_t end){
+        while ((uint32_t)region_fill.size() * Region_Units < end){
+            region_fill.push(0);
+            region_live.push(0);
+            region_pinned.push(0); } }
+
+    uint32_t allocUnits(uint32_t units){
+        if (units > Region_Units){
+            // Too large for a region; start it at the end of the memory, pinning what it covers:
+            CRef cid = ra.alloc(units);
+            addRegions(ra.size());
+            for (uint32_t r = region(cid); r <= region(ra.size() - 1); r++){
+                uint32_t from = std::max(cid, r * Region_Units), to = std::min(ra.size(), (r + 1) * Region_Units);
+                region_fill[r] += to - from;
+                region_live[r] += to - from;
+                region_pinned[r] = 1; }
+            return cid; }
+
+        // Into a collected region, if there is room left in one:
+        while (current_region >= 0 || free_regions.size() > 0){
+            if (current_region < 0){
+                current_region = free_regions.last();
+                free_regions.pop(); }
+            uint32_t r = current_region;
+            if (region_fill[r] + units <= Region_Units){
+                CRef cid = r * Region_Units + region_fill[r];
+                region_fill[r] += units;
+                region_live[r] += units;
+                return cid; }
+            // The rest of the region is lost until it is collected again:
+            ra.free(Region_Units - region_fill[r]);
+            region_fill[r] = Region_Units;
+            current_region = -1; }
+
+        // Otherwise at the end of the memory, skipping the rest of the last region if it is too short:
+        uint32_t rest = Region_Units - ra.size() % Region_Units;
+        if (rest < units){
+            ra.free(rest);
+            CRef pad = ra.alloc(rest);
+            addRegions(ra.size());
+            region_fill[region(pad)] += rest; }
+        CRef cid = ra.alloc(units);
+        addRegions(ra.size());
+        region_fill[region(cid)] += units;
+        region_live[region(cid)] += units;
+        return cid; }
 
  public:
     enum { Unit_Size = RegionAllocator<uint32_t>::Unit_Size };
+    enum { Region_Units = 1 << 16 };
 
     bool extra_clause_field;
 
-    ClauseAllocator(uint32_t start_cap) : ra(start_cap), extra_clause_field(false){}
-    ClauseAllocator() : extra_clause_field(false){}
+    ClauseAllocator(uint32_t start_cap) : ra(start_cap), current_region(-1), extra_clause_field(false){}
+    ClauseAllocator() : current_region(-1), extra_clause_field(false){}
 
     void moveTo(ClauseAllocator& to){
         to.extra_clause_field = extra_clause_field;
-        ra.moveTo(to.ra); }
+        ra.moveTo(to.ra);
+        region_fill.moveTo(to.region_fill);
+        region_live.moveTo(to.region_live);
+        region_pinned.moveTo(to.region_pinned);
+        free_regions.moveTo(to.free_regions);
+        to.current_region = current_region;
+        current_region = -1; }
+
+    // Take over the memory of 'from' (e.g. of a solver that is done with it), emptied, so that it
+    // need not be grown again. This allocator must not hold any clauses yet (see 'Solver::reuseClauseMemory()'):
+    void reuse(ClauseAllocator& from){
+        if (ra.size() != 0){
+            fprintf(stderr, "ClauseAllocator::reuse(): the allocator already holds clauses\n");
+            abort(); }
+        from.ra.clear();
+        from.ra.moveTo(ra);
+        region_fill.clear();
+        region_live.clear();
+        region_pinned.clear();
+        free_regions.clear();
+        current_region = -1;
+        from.region_fill.clear();
+        from.region_live.clear();
+        from.region_pinned.clear();
+        from.free_regions.clear();
+        from.current_region = -1; }
 
     CRef alloc(const vec<Lit>& ps, bool learnt = false)
     {
         assert(sizeof(Lit)      == sizeof(uint32_t));
         assert(sizeof(float)    == sizeof(uint32_t));
         bool use_extra = learnt | extra_clause_field;
-        CRef cid       = ra.alloc(clauseWord32Size(ps.size(), use_extra));
+        CRef cid       = allocUnits(clauseWord32Size(ps.size(), use_extra + learnt));
         new (lea(cid)) Clause(ps, use_extra, learnt);
 
         return cid;
@@ -256,13 +370,72 @@ class ClauseAllocator
     CRef alloc(const Clause& from)
     {
         bool use_extra = from.learnt() | extra_clause_field;
-        CRef cid       = ra.alloc(clauseWord32Size(from.size(), use_extra));
+        CRef cid       = allocUnits(clauseWord32Size(from.size(), use_extra + from.learnt()));
         new (lea(cid)) Clause(from, use_extra);
         return cid; }
 
     uint32_t size      () const      { return ra.size(); }
     uint32_t wasted    () const      { return ra.wasted(); }
 
+    // Regions:
+    uint32_t region    (CRef r) const { return r / Region_Units; }
+    int      nRegions  () const       { return region_fill.size(); }
+    uint32_t regionWasted(uint32_t r) const { return region_fill[r] - region_live[r]; }
+
+    // Can the region be collected? Not if it is pinned, or still being allocated into:
+    bool     collectable(uint32_t r) const {
+        return !region_pinned[r] && (int)r != current_region && (ra.size() % Region_Units == 0 || r != region(ra.size() - 1)); }
+
+    // The region no longer holds any clause that is referred to; its memory is used again:
+    void     freeRegion(uint32_t r){
+        assert(collectable(r));
+        ra.reclaim(region_fill[r] - region_live[r]);
+        region_fill[r] = region_live[r] = 0;
+        free_regions.push(r); }
+
+    // Copy a clause within this allocator, leaving a forwarding reference in the original, as
+    // 'reloc()' does. The original is freed:
+    void move(CRef& cr){
+        bool use_extra = operator[](cr).learnt() | extra_clause_field;
+        CRef to        = allocUnits(clauseWord32Size(operator[](cr).size(), use_extra + operator[](cr).learnt()));
+        new (lea(to)) Clause(operator[](cr), use_extra);
+        free(cr);
+        operator[](cr).relocate(to);
+        cr = to; }
+
+    // Raw contents of the region (e.g. for snapshots). 'assign()' replaces all clauses; the clauses
+    // that are in use must then be given to 'countRegions()', which also recounts the waste:
+    const uint32_t* data  () const   { return (ra.size() > 0) ? ra.lea(0) : NULL; }
+    void     assign    (const uint32_t* from, uint32_t size, uint32_t wasted){
+        RegionAllocator<uint32_t> to(size);
+        if (size > 0) memcpy(to.lea(to.alloc(size)), from, size * sizeof(uint32_t));
+        to.free(wasted);
+        to.moveTo(ra);
+        region_fill.clear();
+        region_live.clear();
+        region_pinned.clear();
+        free_regions.clear();
+        current_region = -1;
+        addRegions(ra.size());
+        for (int r = 0; r < region_fill.size(); r++)
+            region_fill[r] = std::min((uint32_t)Region_Units, ra.size() - r * Region_Units); }
+
+    void     countRegions(const vec<CRef>& cs, const vec<CRef>& ls){
+        for (int k = 0; k < 2; k++){
+            const vec<CRef>& v = k ? ls : cs;
+            for (int i = 0; i < v.size(); i++){
+                const Clause& c    = operator[](v[i]);
+                if (c.mark() == 1) continue;
+                uint32_t      from = v[i], to = from + clauseWord32Size(c.size(), c.extras());
+                for (uint32_t r = region(from); r <= region(to - 1); r++){
+                    region_live[r] += std::min(to, (r + 1) * Region_Units) - std::max(from, r * Region_Units);
+                    if (r != region(from)) region_pinned[r] = region_pinned[region(from)] = 1; } } }
+        uint32_t wasted = 0;
+        for (int r = 0; r < region_fill.size(); r++)
+            wasted += regionWasted(r);
+        ra.reclaim(ra.wasted());
+        ra.free(wasted); }
+
     // Deref, Load Effective Address (LEA), Inverse of LEA (AEL):
     Clause&       operator[](CRef r)         { return (Clause&)ra[r]; }
     const Clause& operator[](CRef r) const   { return (Clause&)ra[r]; }
@@ -273,7 +446,12 @@ class ClauseAllocator
     void free(CRef cid)
     {
         Clause& c = operator[](cid);
-        ra.free(clauseWord32Size(c.size(), c.has_extra()));
+        uint32_t units = clauseWord32Size(c.size(), c.extras());
+        ra.free(units);
+        for (uint32_t r = region(cid); units > 0; r++){
+            uint32_t k = std::min(units, (r + 1) * Region_Units - std::max(cid, r * Region_Units));
+            region_live[r] -= std::min(k, region_live[r]);
+            units -= k; }
     }
 
     void reloc(CRef& cr, ClauseAllocator& to)
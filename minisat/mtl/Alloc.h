@@ -58,6 +58,8 @@ class RegionAllocator
 
     Ref      alloc     (int size); 
     void     free      (int size)    { wasted_ += size; }
+    void     reclaim   (int size)    { assert((uint32_t)size <= wasted_); wasted_ -= size; } // Wasted memory that is in use again.
+    void     clear     ()            { sz = wasted_ = 0; }  // Forget all allocations, but keep the memory.
 
     // Deref, Load Effective Address (LEA), Inverse of LEA (AEL):
     T&       operator[](Ref r)       { assert(r < sz); return memory[r]; }
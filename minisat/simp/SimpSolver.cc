@@ -18,9 +18,12 @@ DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
 OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **************************************************************************************************/
 
+// NOTE: This file was modified as part of minisat-cubing.
+
 #include "minisat/mtl/Sort.h"
 #include "minisat/simp/SimpSolver.h"
 #include "minisat/utils/System.h"
+#include "cs/Snapshot.h"
 
 using namespace Minisat;
 
@@ -74,6 +77,21 @@ SimpSolver::~SimpSolver()
 }
 
 
+void SimpSolver::reuseClauseMemory(ClauseAllocator& from)
+{
+    // Only the dummy clause of the constructor is allocated yet; it is allocated again in the
+    // memory taken over:
+    assert(nClauses() == 0 && nLearnts() == 0);
+    ClauseAllocator to(0);
+    to.extra_clause_field = ca.extra_clause_field;
+    to.reuse(from);
+    to.moveTo(ca);
+
+    vec<Lit> dummy(1,lit_Undef);
+    bwdsub_tmpunit = ca.alloc(dummy);
+}
+
+
 Var SimpSolver::newVar(lbool upol, bool dvar) {
     Var v = Solver::newVar(upol, dvar);
 
@@ -210,6 +228,16 @@ bool SimpSolver::strengthenClause(CRef cr, Lit l)
     // if (!find(subsumption_queue, &c))
     subsumption_queue.insert(cr);
 
+    // The strengthened clause goes into the proof before the original leaves it:
+    if (proof != NULL){
+        proof_tmp.clear();
+        for (int i = 0; i < c.size(); i++)
+            if (c[i] != l)
+                proof_tmp.push(c[i]);
+        proof->add(proof_tmp);
+        proof_tmp.push(l);
+    }
+
     if (c.size() == 2){
         removeClause(cr);
         c.strengthen(l);
@@ -220,6 +248,7 @@ bool SimpSolver::strengthenClause(CRef cr, Lit l)
         remove(occurs[var(l)], cr);
         n_occ[l]--;
         updateElimHeap(var(l));
+        if (proof != NULL) proof->remove(proof_tmp);
     }
 
     return c.size() == 1 ? enqueue(c[0]) && propagate() == CRef_Undef : true;
@@ -522,11 +551,18 @@ bool SimpSolver::eliminateVar(Var v)
         mkElimClause(elimclauses, ~mkLit(v));
     }
 
+    // The resolvents go into the proof before the clauses they are resolved from leave it:
+    vec<Lit>& resolvent = add_tmp;
+    if (proof != NULL)
+        for (int i = 0; i < pos.size(); i++)
+            for (int j = 0; j < neg.size(); j++)
+                if (merge(ca[pos[i]], ca[neg[j]], v, resolvent))
+                    proof->add(resolvent);
+
     for (int i = 0; i < cls.size(); i++)
         removeClause(cls[i]); 
 
     // Produce clauses in cross product:
-    vec<Lit>& resolvent = add_tmp;
     for (int i = 0; i < pos.size(); i++)
         for (int j = 0; j < neg.size(); j++)
             if (merge(ca[pos[i]], ca[neg[j]], v, resolvent) && !addClause_(resolvent))
@@ -538,6 +574,10 @@ bool SimpSolver::eliminateVar(Var v)
     // Free watchers lists for this variable, if possible:
     if (watches[ mkLit(v)].size() == 0) watches[ mkLit(v)].clear(true);
     if (watches[~mkLit(v)].size() == 0) watches[~mkLit(v)].clear(true);
+    if (bin_watches[ mkLit(v)].size() == 0) bin_watches[ mkLit(v)].clear(true);
+    if (bin_watches[~mkLit(v)].size() == 0) bin_watches[~mkLit(v)].clear(true);
+    if (tern_watches[ mkLit(v)].size() == 0) tern_watches[ mkLit(v)].clear(true);
+    if (tern_watches[~mkLit(v)].size() == 0) tern_watches[~mkLit(v)].clear(true);
 
     return backwardSubsumptionCheck();
 }
@@ -677,6 +717,43 @@ bool SimpSolver::eliminate(bool turn_off_elim)
 }
 
 
+void SimpSolver::resumeElimination()
+{
+    assert(decisionLevel() == 0);
+    if (use_simplification) return;
+
+    // As in the constructor and 'newVar()', but for the variables and clauses there are now:
+    use_simplification    = true;
+    remove_satisfied      = false;
+    ca.extra_clause_field = true;
+    vec<Lit> dummy(1,lit_Undef);
+    bwdsub_tmpunit        = ca.alloc(dummy);
+    bwdsub_assigns        = 0;
+    n_touched             = 0;
+    for (Var v = 0; v < nVars(); v++){
+        n_occ  .insert( mkLit(v), 0);
+        n_occ  .insert(~mkLit(v), 0);
+        occurs .init  (v);
+        touched.insert(v, 0);
+    }
+
+    // Copying gives each problem clause room for its abstraction:
+    garbageCollect();
+    for (int i = 0; i < clauses.size(); i++){
+        Clause& c = ca[clauses[i]];
+        c.calcAbstraction();
+        subsumption_queue.insert(clauses[i]);
+        for (int k = 0; k < c.size(); k++){
+            occurs[var(c[k])].push(clauses[i]);
+            n_occ[c[k]]++;
+        }
+    }
+    for (Var v = 0; v < nVars(); v++)
+        if (!frozen[v] && !isEliminated(v) && value(v) == l_Undef)
+            elim_heap.insert(v);
+}
+
+
 //=================================================================================================
 // Garbage Collection methods:
 
@@ -723,3 +800,56 @@ void SimpSolver::garbageCollect()
                ca.size()*ClauseAllocator::Unit_Size, to.size()*ClauseAllocator::Unit_Size);
     to.moveTo(ca);
 }
+
+
+//=================================================================================================
+// Snapshots:
+
+
+void SimpSolver::saveSnapshot(SnapshotWriter& out)
+{
+    assert(!use_simplification);
+
+    Solver::saveSnapshot(out);
+
+    out.putValue(elimorder);
+    out.putValue(max_simp_var);
+    out.putValue(bwdsub_assigns);
+    out.putValue(bwdsub_tmpunit);
+    out.putValue(merges);
+    out.putValue(asymm_lits);
+    out.putValue(eliminated_vars);
+    out.putVec(elimclauses);
+    out.putMap(frozen, nVars());
+    out.putVec(frozen_vars);
+    out.putMap(eliminated, nVars());
+}
+
+
+bool SimpSolver::loadSnapshot(SnapshotReader& in)
+{
+    if (!Solver::loadSnapshot(in))
+        return false;
+
+    // As when turning off elimination in 'eliminate()':
+    touched  .clear(true);
+    occurs   .clear(true);
+    n_occ    .clear(true);
+    elim_heap.clear(true);
+    subsumption_queue.clear(true);
+    use_simplification = false;
+
+    in.getValue(elimorder);
+    in.getValue(max_simp_var);
+    in.getValue(bwdsub_assigns);
+    in.getValue(bwdsub_tmpunit);
+    in.getValue(merges);
+    in.getValue(asymm_lits);
+    in.getValue(eliminated_vars);
+    in.getVec(elimclauses);
+    in.getMap(frozen, nVars());
+    in.getVec(frozen_vars);
+    in.getMap(eliminated, nVars());
+
+    return in.ok();
+}
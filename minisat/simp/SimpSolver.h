@@ -18,6 +18,8 @@ DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
 OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **************************************************************************************************/
 
+// NOTE: This file was modified as part of minisat-cubing.
+
 #ifndef Minisat_SimpSolver_h
 #define Minisat_SimpSolver_h
 
@@ -69,10 +71,18 @@ class SimpSolver : public Solver {
     bool    solve       (Lit p, Lit q,        bool do_simp = true, bool turn_off_simp = false);
     bool    solve       (Lit p, Lit q, Lit r, bool do_simp = true, bool turn_off_simp = false);
     bool    eliminate   (bool turn_off_elim = false);  // Perform variable elimination based simplification. 
+    void    resumeElimination();                        // Turn simplification on again after 'eliminate(true)', for the clauses there are now.
 
     // Memory managment:
     //
     virtual void garbageCollect();
+    virtual bool canCollectRegions() const { return !use_simplification; } // The occurrence lists are not redirected.
+    virtual void reuseClauseMemory(ClauseAllocator& from);
+
+    // Snapshots (see 'Solver::saveSnapshot()'). Only supported once simplification is turned off:
+    //
+    virtual void saveSnapshot(SnapshotWriter& out);
+    virtual bool loadSnapshot(SnapshotReader& in);
 
 
     // Generate a (possibly simplified) DIMACS file:
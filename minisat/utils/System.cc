@@ -128,6 +128,22 @@ void Minisat::limitMemory(uint64_t max_mem_mb)
         }
     }
 
+#if defined(__OpenBSD__)
+#undef RLIMIT_AS
+#endif
+}
+
+uint64_t Minisat::memoryLimit()
+{
+#if defined(__OpenBSD__)
+#define RLIMIT_AS RLIMIT_DATA
+#endif
+
+    rlimit rl;
+    if (getrlimit(RLIMIT_AS, &rl) == -1 || rl.rlim_cur == RLIM_INFINITY)
+        return 0;
+    return (uint64_t)rl.rlim_cur / (1024*1024);
+
 #if defined(__OpenBSD__)
 #undef RLIMIT_AS
 #endif
@@ -137,6 +153,11 @@ void Minisat::limitMemory(uint64_t /*max_mem_mb*/)
 {
     printf("WARNING! Memory limit not supported on this architecture.\n");
 }
+
+uint64_t Minisat::memoryLimit()
+{
+    return 0;
+}
 #endif
 
 
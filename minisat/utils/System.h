@@ -42,6 +42,9 @@ extern void   setX86FPUPrecision(); // Make sure double's are represented with t
 extern void   limitMemory(uint64_t max_mem_mb); // Set a limit on total memory usage. The exact
                                                 // semantics varies depending on architecture.
 
+extern uint64_t memoryLimit();                  // The limit on total memory usage in mega bytes
+                                                // (returns 0 if there is none, or if unsupported).
+
 extern void   limitTime(uint32_t max_cpu_time); // Set a limit on maximum CPU time. The exact
                                                 // semantics varies depending on architecture.
 